@@ -0,0 +1,77 @@
+#include "assets.hpp"
+
+#include "encoder.hpp"
+#include "filehelpers.hpp"
+#include "ssi.hpp"
+
+#include <iostream>
+
+namespace dice {
+
+namespace {
+
+bool compressible(const std::string& contentType)
+{
+    return contentType.compare(0, 5, "text/") == 0 ||
+        contentType == "application/javascript" ||
+        contentType == "application/json" ||
+        contentType == "image/svg+xml";
+}
+
+std::unique_ptr<Asset> load(const std::string& base, const std::string& name)
+{
+    auto asset = std::make_unique<Asset>();
+    asset->contentType = getContentType(name);
+    auto& data = asset->variants[static_cast<std::size_t>(Encoding::IDENTITY)];
+    if (asset->contentType.find("text/html") != std::string::npos)
+    {
+        data = readHtml(name, base);
+    }
+    else
+    {
+        const auto path = base + "/" + name;
+        std::cout << "Slurping " << path << std::endl;
+        data = slurp(path);
+    }
+    if (data.empty()) return nullptr;
+    asset->available = encodingBit(Encoding::IDENTITY);
+
+    if (compressible(asset->contentType))
+    {
+        for (const auto e : {Encoding::BR, Encoding::GZIP, Encoding::ZSTD})
+        {
+            auto compressed = getEncoder(e)->compress(data, Profile::STATIC);
+            // Not worth it for tiny files
+            if (compressed.size() < data.size())
+            {
+                asset->variants[static_cast<std::size_t>(e)] = std::move(compressed);
+                asset->available |= encodingBit(e);
+            }
+        }
+    }
+    return asset;
+}
+
+} // unnamed namespace
+
+AssetStore::AssetStore(std::string base)
+  : base_{std::move(base)}
+{
+}
+
+const Asset* AssetStore::get(const std::string& name)
+{
+    {
+        std::lock_guard<std::mutex> lock{mutex_};
+        const auto it = assets_.find(name);
+        if (it != assets_.end()) return it->second.get();
+    }
+    // Loaded without the lock. If two threads load the same file, the first
+    // one is kept.
+    auto asset = load(base_, name);
+    if (!asset) return nullptr;
+    std::lock_guard<std::mutex> lock{mutex_};
+    return assets_.emplace(name, std::move(asset)).first->second.get();
+}
+
+} // namespace dice
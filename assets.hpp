@@ -0,0 +1,49 @@
+#pragma once
+
+#include "httphelpers.hpp"
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace dice {
+
+/// Static file served as is or compressed
+struct Asset
+{
+    std::string contentType;
+    /// Bits of the encodings in variants
+    unsigned available;
+    /// Contents in each Encoding, empty if the encoding is not available
+    std::string variants[ENCODINGS];
+
+    /// @return contents in the encoding
+    const std::string& variant(Encoding e) const
+    {
+        return variants[static_cast<std::size_t>(e)];
+    }
+};
+
+/// Cache of the static files. Each file is read and compressed with every
+/// encoder at the static profile when it is first requested so that the
+/// requests only select the variant. Html files
+/// have their includes replaced. Thread-safe.
+class AssetStore
+{
+    const std::string base_;
+    std::mutex mutex_;
+    std::unordered_map<std::string, std::unique_ptr<const Asset>> assets_;
+public:
+    /// Construct AssetStore
+    /// @param base [in] directory of the files
+    explicit AssetStore(std::string base);
+
+    /// Get the file. Missing files are not cached.
+    /// @param name [in] path of the file relative to the base directory
+    /// @return the file or nullptr if there is no such file. The pointer is
+    ///     valid as long as the store.
+    const Asset* get(const std::string& name);
+};
+
+} // namespace dice
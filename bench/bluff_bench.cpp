@@ -0,0 +1,362 @@
+// Microbenchmarks for the hot paths of the server. Run from the build
+// directory like the unit tests, e.g.,
+//   ./bluff_bench --benchmark_out=bench.json --benchmark_out_format=json
+// and compare the json files of two commits with benchmark's compare.py.
+
+#include "bid.hpp"
+#include "encoder.hpp"
+#include "engine.hpp"
+#include "filehelpers.hpp"
+#include "game.hpp"
+#include "helpers.hpp"
+#include "json.hpp"
+#include "msgpack.hpp"
+#include "playerid.hpp"
+#include "request.hpp"
+#include "rng.hpp"
+#include "rules.hpp"
+#include "sim.hpp"
+#include "ssi.hpp"
+#include "threadpool.hpp"
+#include "tokenizer.hpp"
+#include "test/test_helpers.hpp"
+
+#include <benchmark/benchmark.h>
+
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+constexpr auto PLAYER = R"#({"id": "00000000-0000-0000-0000-000000000001"})#";
+
+void BM_BidScore(benchmark::State& state)
+{
+    int sum = 0;
+    for (auto _ : state)
+    {
+        for (int n = 1; n <= 40; ++n)
+        {
+            for (int face = 1; face <= 6; ++face) sum += dice::Bid{n, face}.score();
+        }
+    }
+    benchmark::DoNotOptimize(sum);
+    state.SetItemsProcessed(state.iterations() * 40 * 6);
+}
+BENCHMARK(BM_BidScore);
+
+void BM_BidChallenge(benchmark::State& state)
+{
+    dice::Xoshiro256 rng{1};
+    std::vector<int> hand(static_cast<std::size_t>(state.range(0)));
+    for (auto& d : hand) d = static_cast<int>(rng() % 6) + 1;
+    const dice::Bid bid{static_cast<int>(hand.size() / 3), 4};
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(bid.challenge(hand));
+    }
+}
+BENCHMARK(BM_BidChallenge)->Arg(2)->Arg(10)->Arg(40);
+
+void BM_GameSerialize(benchmark::State& state)
+{
+    dice::Game g{"game", "p0", 1};
+    for (int i = 1; i < state.range(0); ++i) g.addPlayer("p" + std::to_string(i));
+    g.startGame();
+    for (auto _ : state)
+    {
+        rapidjson::StringBuffer s;
+        json::Writer w{s};
+        g.serialize(w, "p0");
+        benchmark::DoNotOptimize(s.GetString());
+    }
+}
+BENCHMARK(BM_GameSerialize)->Arg(2)->Arg(8);
+
+// Dice rolled per second with the standard library as the baseline
+void BM_DefaultRandomEngine(benchmark::State& state)
+{
+    std::default_random_engine rng{1};
+    std::uniform_int_distribution<int> face{1, 6};
+    int sum = 0;
+    for (auto _ : state)
+    {
+        sum += face(rng);
+    }
+    benchmark::DoNotOptimize(sum);
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_DefaultRandomEngine);
+
+// Dice rolled per second by xoshiro256** a table at a time. Arg is the
+// number of dice.
+void BM_FillDice(benchmark::State& state)
+{
+    std::vector<int> table(static_cast<std::size_t>(state.range(0)));
+    for (auto _ : state)
+    {
+        dice::fillDice(dice::threadRng(), table.data(), table.size());
+        benchmark::DoNotOptimize(table.data());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_FillDice)->Arg(5)->Arg(40);
+
+// Rounds started with all the players in the game
+void BM_GameStartRound(benchmark::State& state)
+{
+    constexpr std::size_t GAMES = 1000;
+    std::vector<std::unique_ptr<dice::Game>> games;
+    std::size_t next = GAMES;
+    for (auto _ : state)
+    {
+        if (next == GAMES)
+        {
+            state.PauseTiming();
+            games.clear();
+            for (std::size_t i = 0; i < GAMES; ++i)
+            {
+                games.push_back(std::make_unique<dice::Game>("g", "p0", i));
+                for (int p = 1; p < dice::MAX_PLAYERS; ++p) games.back()->addPlayer("p" + std::to_string(p));
+                games.back()->startGame();
+            }
+            next = 0;
+            state.ResumeTiming();
+        }
+        benchmark::DoNotOptimize(games[next++]->startRound());
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_GameStartRound);
+
+// Bodies of the routes, decoded by the schema of the route
+const char* const ROUTES[] = {"login", "create", "bid", "challenge", "status"};
+const char* const BODIES[] = {
+    R"({"name": "Alice"})",
+    R"({"id": "6a4bd0c5-7a4c-4b0c-9d8e-2f6e0b7c1d3a", "game": "Game 1"})",
+    R"({"id": "6a4bd0c5-7a4c-4b0c-9d8e-2f6e0b7c1d3a", "n": 4, "face": 5})",
+    R"({"id": "6a4bd0c5-7a4c-4b0c-9d8e-2f6e0b7c1d3a"})",
+    R"({"id": "6a4bd0c5-7a4c-4b0c-9d8e-2f6e0b7c1d3a", "hash": 123456})"};
+
+// Document based decoding like json::getString and json::getInt as the
+// baseline. Arg is the route.
+void BM_DecodeDocument(benchmark::State& state)
+{
+    const auto route = static_cast<std::size_t>(state.range(0));
+    const std::string body = BODIES[route];
+    std::size_t sum = 0;
+    for (auto _ : state)
+    {
+        const auto doc = dice::parse(body);
+        for (const char* k : {"id", "game", "name", "n", "face", "hash"})
+        {
+            if (doc.HasMember(k)) sum += doc[k].IsString() ? doc[k].GetStringLength() : 1;
+        }
+    }
+    benchmark::DoNotOptimize(sum);
+    state.SetLabel(ROUTES[route]);
+}
+BENCHMARK(BM_DecodeDocument)->DenseRange(0, 4);
+
+// Decoding with the SAX handler of the schema. Arg is the route.
+void BM_DecodeRequest(benchmark::State& state)
+{
+    using dice::Request;
+    const auto route = static_cast<std::size_t>(state.range(0));
+    const std::string body = BODIES[route];
+    const auto decode = [route](const std::string& b)
+    {
+        switch (route)
+        {
+        case 0: return dice::decodeRequest<Request::LOGIN>(b);
+        case 1: return dice::decodeRequest<Request::JOIN>(b);
+        case 2: return dice::decodeRequest<Request::BID>(b);
+        case 3: return dice::decodeRequest<Request::PLAYER>(b);
+        default: return dice::decodeRequest<Request::STATUS>(b);
+        }
+    };
+    unsigned sum = 0;
+    for (auto _ : state)
+    {
+        sum += decode(body).fields;
+    }
+    benchmark::DoNotOptimize(sum);
+    state.SetLabel(ROUTES[route]);
+}
+BENCHMARK(BM_DecodeRequest)->DenseRange(0, 4);
+
+void BM_EngineStatus(benchmark::State& state)
+{
+    auto tmp = tmpCopy("../test-game.json", "./.json");
+    dice::Engine e{tmp.str()};
+    e.startGame(PLAYER);
+    const auto format = state.range(0) ? dice::Format::MSGPACK : dice::Format::JSON;
+    const auto body = format == dice::Format::MSGPACK ? msgpack::fromJson(PLAYER) : std::string{PLAYER};
+    std::size_t bytes = 0;
+    for (auto _ : state)
+    {
+        bytes += e.status(body, format).size();
+    }
+    state.SetBytesProcessed(static_cast<std::int64_t>(bytes));
+    state.SetLabel(format == dice::Format::MSGPACK ? "msgpack" : "json");
+}
+BENCHMARK(BM_EngineStatus)->Arg(0)->Arg(1);
+
+void BM_Compress(benchmark::State& state)
+{
+    const auto orig = dice::slurp("../final.json");
+    const auto encoding = static_cast<dice::Encoding>(state.range(0));
+    const auto profile = state.range(1) ? dice::Profile::STATIC : dice::Profile::DYNAMIC;
+    const auto encoder = dice::getEncoder(encoding);
+    std::size_t size = 0;
+    for (auto _ : state)
+    {
+        size = encoder->compress(orig, profile).size();
+    }
+    state.SetBytesProcessed(static_cast<std::int64_t>(state.iterations()) *
+                            static_cast<std::int64_t>(orig.size()));
+    state.counters["ratio"] = static_cast<double>(size) / static_cast<double>(orig.size());
+    state.SetLabel(std::string{dice::encodingName(encoding)} +
+                   (profile == dice::Profile::STATIC ? " static" : " dynamic"));
+}
+BENCHMARK(BM_Compress)->ArgsProduct({
+    {static_cast<int>(dice::Encoding::BR), static_cast<int>(dice::Encoding::GZIP),
+     static_cast<int>(dice::Encoding::ZSTD)},
+    {0, 1}});
+
+void BM_ReadHtml(benchmark::State& state)
+{
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(dice::readHtml("game.html", "../static"));
+    }
+}
+BENCHMARK(BM_ReadHtml);
+
+void BM_Tokenizer(benchmark::State& state)
+{
+    const std::string header{"deflate, gzip;q=1.0, br;q=0.9, zstd;q=0.8, identity;q=0.5, *;q=0"};
+    for (auto _ : state)
+    {
+        dice::Tokenizer tok{header.c_str(), " ,;"};
+        for (auto t = tok.nextStringView(); !t.empty(); t = tok.nextStringView())
+        {
+            benchmark::DoNotOptimize(t);
+        }
+    }
+}
+BENCHMARK(BM_Tokenizer);
+
+void BM_Uuid(benchmark::State& state)
+{
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(dice::uuid());
+    }
+}
+BENCHMARK(BM_Uuid);
+
+void BM_PlayerId(benchmark::State& state)
+{
+    char buf[dice::PlayerId::LENGTH];
+    for (auto _ : state)
+    {
+        dice::PlayerId::generate().format(buf);
+        benchmark::DoNotOptimize(buf);
+    }
+}
+BENCHMARK(BM_PlayerId);
+
+// Bot decisions per second with 256 rollouts per candidate. Arg is the
+// number of search threads, 0 = the calling thread only.
+void BM_MonteCarloDecide(benchmark::State& state)
+{
+    const auto threads = static_cast<unsigned>(state.range(0));
+    std::unique_ptr<dice::ThreadPool> pool;
+    if (threads) pool = std::make_unique<dice::ThreadPool>(threads);
+    const dice::sim::MonteCarloStrategy strategy{pool.get(), 256};
+    dice::sim::Rng rng{1};
+    dice::sim::GameState game{4, 0};
+    game.startRound(rng);
+    game.bid({3, 4});
+    const auto view = game.view();
+    const auto far = std::chrono::steady_clock::now() + std::chrono::hours{1};
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(strategy.decide(view, rng, far));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_MonteCarloDecide)->Arg(0)->Arg(1)->Arg(2)->Arg(4)->UseRealTime();
+
+// Saved state with the given number of started two player games. Written
+// directly, logging in 200k players through the engine takes too long.
+TmpFile makeDb(std::int64_t games)
+{
+    rapidjson::StringBuffer s;
+    json::Writer w{s};
+    json::Object(w, [&](auto& w)
+    {
+        json::ArrayW(w, "players", [&](auto& w)
+        {
+            for (std::int64_t i = 0; i < games; ++i)
+            {
+                for (const auto* prefix : {"a", "b"})
+                {
+                    json::Object(w, [&](auto& w)
+                    {
+                        json::KeyValue(w, "id", dice::PlayerId::generate().str());
+                        json::KeyValue(w, "name", prefix + std::to_string(i));
+                        json::KeyValue(w, "game", "g" + std::to_string(i));
+                    });
+                }
+            }
+        });
+        json::ArrayW(w, "games", [&](auto& w)
+        {
+            for (std::int64_t i = 0; i < games; ++i)
+            {
+                const auto name = std::to_string(i);
+                dice::Game game{"g" + name, "a" + name, static_cast<std::uint64_t>(i)};
+                game.addPlayer("b" + name);
+                game.startGame();
+                game.serializeState(w);
+            }
+        });
+    });
+    auto tmp = tmpName("./.json");
+    dice::dumpChecked(tmp, s.GetString());
+    return TmpFile{tmp};
+}
+
+void BM_EngineLoad(benchmark::State& state)
+{
+    auto db = makeDb(state.range(0));
+    for (auto _ : state)
+    {
+        dice::Engine e{db.str()};
+        benchmark::DoNotOptimize(&e);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_EngineLoad)->RangeMultiplier(10)->Range(10, 100000)->Unit(benchmark::kMillisecond);
+
+void BM_EngineSave(benchmark::State& state)
+{
+    auto db = makeDb(state.range(0));
+    dice::Engine e{db.str()};
+    for (auto _ : state)
+    {
+        e.save();
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_EngineSave)->RangeMultiplier(10)->Range(10, 10000)->Unit(benchmark::kMillisecond);
+
+} // unnamed namespace
+
+BENCHMARK_MAIN();
@@ -1,5 +1,7 @@
 #include "bid.hpp"
 
+#include "msgpack.hpp"
+
 namespace dice {
 
 Bid::Bid()
@@ -66,15 +68,25 @@ int Bid::challenge(const std::vector<int>& commonHand) const
     return n - n_;
 }
 
-void Bid::serialize(json::Writer& w) const
+int Bid::challenge(const std::array<int, 7>& faceCounts) const
 {
-    json::Json(w,
+    if (face_ == STAR || face_ < 1) return faceCounts[STAR] - n_;
+    return faceCounts[static_cast<std::size_t>(face_)] + faceCounts[STAR] - n_;
+}
+
+template<typename Writer>
+void Bid::serialize(Writer& w) const
+{
+    json::Object(w, [this](auto& w)
     {
-        {"n", n_},
-        {"face", face_}
+        json::KeyValue(w, "n", n_);
+        json::KeyValue(w, "face", face_);
     });
 }
 
+template void Bid::serialize(json::Writer&) const;
+template void Bid::serialize(msgpack::Writer&) const;
+
 Bid Bid::fromJson(const rapidjson::Value& v)
 {
     return Bid{json::getInt(v, "n"),
@@ -1,6 +1,7 @@
 #pragma once
 #include "json.hpp"
 
+#include <array>
 #include <vector>
 
 namespace dice {
@@ -59,11 +60,21 @@ public:
     */
     int challenge(const std::vector<int>& commonHand) const;
 
+    /**
+     * Same as challenge(commonHand) but for dice given as a histogram.
+     * @param faceCounts [in] faceCounts[face] is the number of dice with
+     *     the face [1, 6]. Index 0 is ignored.
+     * @return bid's difference to actual
+     */
+    int challenge(const std::array<int, 7>& faceCounts) const;
+
     /**
      * Serialize bid to give writer.
+     * @tparam Writer json::Writer or msgpack::Writer
      * @param w [out] where to serialize
      */
-    void serialize(json::Writer& w) const;
+    template<typename Writer>
+    void serialize(Writer& w) const;
 
     /**
      * Construct bid object from given json.
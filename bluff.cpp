@@ -1,82 +1,251 @@
 #include <crow/app.h>
 
-#include "brotli.hpp"
-#include "filehelpers.hpp"
+#include "assets.hpp"
+#include "bots.hpp"
+#include "encoder.hpp"
+#include "endgame.hpp"
 #include "engine.hpp"
 #include "expires.hpp"
+#include "helpers.hpp"
 #include "httphelpers.hpp"
-#include "ssi.hpp"
+#include "msgpack.hpp"
+#include "replication.hpp"
+#include "router.hpp"
+#include "traffic.hpp"
 
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
 #include <string>
+#include <thread>
+#include <vector>
 
 using namespace std;
 using namespace dice;
 
 namespace dice {
 
-inline auto readHtmlFile(const std::string& name, const crow::request& req)
+/**
+ * Parses Accept-Encoding once per request
+ */
+struct Negotiation
 {
-    auto data = dice::readHtml(name, "../static");
-    if (data.empty()) return crow::response(404);
+    struct context
+    {
+        AcceptEncoding accept;
+    };
 
-    crow::response resp;
-    resp.add_header("Content-Type", getContentType(name));
-    resp.add_header("Expires", expires());
-    if (hasHttpValue(req.get_header_value("Accept-Encoding"), "br"))
+    void before_handle(crow::request& req, crow::response&, context& ctx)
     {
-        resp.write(compress(data));
-        resp.add_header("Content-Encoding", "br");
+        ctx.accept = AcceptEncoding{req.get_header_value("Accept-Encoding")};
     }
-    else
+
+    void after_handle(crow::request&, crow::response&, context&)
     {
-        resp.write(data);
     }
-    return resp;
-}
+};
+
+/**
+ * Records the API requests when the server is started with -r
+ */
+struct Recording
+{
+    struct context
+    {
+        std::int64_t t;
+    };
+
+    std::unique_ptr<Recorder> recorder;
+
+    void before_handle(crow::request&, crow::response&, context& ctx)
+    {
+        if (recorder) ctx.t = recorder->now();
+    }
+
+    void after_handle(crow::request& req, crow::response& res, context& ctx)
+    {
+        if (!recorder || req.url.compare(0, 5, "/api/") != 0) return;
+        const auto format = isMsgPack(req.get_header_value("Content-Type")) ? Format::MSGPACK : Format::JSON;
+        recorder->record(ctx.t, req.url, req.body, format, res.body);
+    }
+};
+
+using App = crow::App<Negotiation, Recording>;
 
 /**
  * Read the given file
  * @param name [in] filename
+ * @param accept [in] encodings accepted by the client
  * @return crow response
  */
-inline auto readFile(const std::string& name, const crow::request& req)
+inline auto readFile(const std::string& name, const AcceptEncoding& accept)
 {
-    const auto ct = getContentType(name);
-    if (ct.find("text/html") != std::string::npos)
+    static AssetStore assets{"../static"};
+    const auto asset = assets.get(name);
+    if (!asset) return crow::response(404);
+
+    const auto encoding = accept.select(asset->available);
+    crow::response resp{asset->variant(encoding)};
+    resp.add_header("Content-Type", asset->contentType);
+    resp.add_header("Expires", expires());
+    resp.add_header("Vary", "Accept-Encoding");
+    if (encoding != Encoding::IDENTITY)
     {
-        return readHtmlFile(name, req);
+        resp.add_header("Content-Encoding", encodingName(encoding));
     }
-    const auto path = "../static/"s + name;
-    std::cout << "Slurping " << path << std::endl;
-    const auto data = dice::slurp(path);
-    if (data.empty()) return crow::response(404);
-    crow::response r{data};
-    r.add_header("Content-Type", getContentType(name));
-    r.add_header("Expires", expires());
-    return r;
+    return resp;
+}
+
+/**
+ * Requests with Content-Type application/msgpack are answered in
+ * MessagePack, others in json
+ * @param req [in] the request
+ * @return format of the request and the response
+ */
+inline auto bodyFormat(const crow::request& req)
+{
+    return isMsgPack(req.get_header_value("Content-Type")) ? Format::MSGPACK : Format::JSON;
 }
 
-inline auto packJson(const std::string& json, const crow::request& req)
+inline auto contentType(Format format)
+{
+    return format == Format::MSGPACK ? "application/msgpack" : "application/json";
+}
+
+inline crow::response reply(const std::string& body, Format format)
+{
+    crow::response resp{body};
+    if (format == Format::MSGPACK) resp.add_header("Content-Type", contentType(format));
+    return resp;
+}
+
+inline auto pack(const std::string& body, const AcceptEncoding& accept, Format format)
 {
     crow::response resp;
-    if (dice::hasHttpValue(req.get_header_value("Accept-Encoding"), "br"))
+    const auto encoding = accept.select(availableEncodings());
+    if (encoding != Encoding::IDENTITY)
     {
-        resp.write(dice::compress(json));
-        resp.add_header("Content-Encoding", "br");
+        resp.write(getEncoder(encoding)->compress(body, Profile::DYNAMIC));
+        resp.add_header("Content-Encoding", encodingName(encoding));
     }
     else
     {
-        resp.write(json);
+        resp.write(body);
     }
-    resp.add_header("Content-Type", "application/json");
+    resp.add_header("Vary", "Accept-Encoding");
+    resp.add_header("Content-Type", contentType(format));
     return resp;
 }
 } // dice
 
-int main()
+int main(int argc, char* argv[])
 {
-    static dice::Engine engine{"db.json"};
-    crow::SimpleApp app;
+    // A router serves no games itself. Its engine has no file so that it
+    // doesn't overwrite the database of shards started in the same
+    // directory.
+    bool routing = false;
+    for (int i = 1; i < argc; ++i) routing = routing || std::string{argv[i]} == "-s";
+    static dice::Engine engine{routing ? "" : "db.json"};
+    // Set with -s, the games are then served by the shard processes
+    static std::unique_ptr<Router> router;
+    // Set with -f, the API is closed until promoted with SIGUSR1
+    static std::unique_ptr<Follower> follower;
+    static const auto api = [](const std::string& route, const std::string& body, Format format)
+    {
+        if (follower && !follower->promoted())
+        {
+            const std::string error = Error{"FOLLOWER"};
+            return format == Format::MSGPACK ? msgpack::fromJson(error) : error;
+        }
+        return router ? router->call(route, body, format) : dispatch(engine, route, body, format);
+    };
+    std::vector<std::string> shards;
+    std::unique_ptr<Replicator> replicator;
+    std::chrono::seconds snapshotInterval{0};
+    App app;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string arg = argv[i];
+        if (routing && (arg == "-e" || arg == "-p" || arg == "-b" || arg == "-f"))
+        {
+            cerr << arg << " is for the shards, not with -s" << endl;
+            return 1;
+        }
+        if (arg == "-r" && i + 1 < argc)
+        {
+            app.get_middleware<Recording>().recorder = std::make_unique<Recorder>(argv[++i]);
+            continue;
+        }
+        if (arg == "-e" && i + 1 < argc)
+        {
+            BotConfig config;
+            config.endgame = argv[++i];
+            try {
+                EndgameTable table{config.endgame};
+            } catch (const std::exception& e) {
+                cerr << e.what() << endl;
+                return 1;
+            }
+            engine.setBotConfig(config);
+            continue;
+        }
+        if (arg == "-s" && i + 1 < argc)
+        {
+            shards.push_back(argv[++i]);
+            continue;
+        }
+        if (arg == "-p" && i + 1 < argc)
+        {
+            try {
+                replicator = std::make_unique<Replicator>(engine, argv[++i]);
+            } catch (const std::exception& e) {
+                cerr << e.what() << endl;
+                return 1;
+            }
+            continue;
+        }
+        if (arg == "-b" && i + 1 < argc)
+        {
+            snapshotInterval = std::chrono::seconds{std::atoi(argv[++i])};
+            continue;
+        }
+        if (arg == "-f" && i + 1 < argc)
+        {
+            follower = std::make_unique<Follower>(engine, argv[++i]);
+            continue;
+        }
+        cerr << "Usage: bluff [-r traffic.jsonl] [-e endgame.tbl] [-s shard.sock]..." << endl
+             << "             [-p replication.sock | -f primary.sock] [-b seconds]" << endl;
+        return 1;
+    }
+    if (!shards.empty()) router = std::make_unique<Router>(shards);
+    if (snapshotInterval.count() > 0)
+    {
+        // Saved by a forked process so that the requests are not blocked
+        std::thread{[snapshotInterval]
+        {
+            for (;;)
+            {
+                std::this_thread::sleep_for(snapshotInterval);
+                engine.saveInBackground();
+            }
+        }}.detach();
+    }
+    if (follower)
+    {
+        static std::atomic<bool> promote{false};
+        std::signal(SIGUSR1, [](int) { promote = true; });
+        std::thread{[]
+        {
+            while (!promote) std::this_thread::sleep_for(std::chrono::milliseconds{10});
+            follower->promote();
+            cout << "Promoted to primary" << endl;
+        }}.detach();
+    }
 
     CROW_ROUTE(app, "/")([]{
         crow::response resp;
@@ -95,15 +264,28 @@ int main()
         .methods("POST"_method)
         ([](const crow::request& req)
         {
-            return engine.login(req.body);
+            const auto format = bodyFormat(req);
+            return reply(api("/api/login", req.body, format), format);
         }
     );
 
     CROW_ROUTE(app, "/api/status")
         .methods("POST"_method)
-        ([](const crow::request& req)
+        ([&app](const crow::request& req)
+        {
+            const auto format = bodyFormat(req);
+            const auto& accept = app.get_context<Negotiation>(req).accept;
+            return pack(api("/api/status", req.body, format), accept, format);
+        }
+    );
+
+    CROW_ROUTE(app, "/api/history")
+        .methods("POST"_method)
+        ([&app](const crow::request& req)
         {
-            return packJson(engine.status(req.body), req);
+            const auto format = bodyFormat(req);
+            const auto& accept = app.get_context<Negotiation>(req).accept;
+            return pack(api("/api/history", req.body, format), accept, format);
         }
     );
 
@@ -111,7 +293,8 @@ int main()
         .methods("POST"_method)
         ([](const crow::request& req)
         {
-            return engine.createGame(req.body);
+            const auto format = bodyFormat(req);
+            return reply(api("/api/newGame", req.body, format), format);
         }
     );
 
@@ -119,7 +302,8 @@ int main()
         .methods("POST"_method)
         ([](const crow::request& req)
         {
-            return engine.joinGame(req.body);
+            const auto format = bodyFormat(req);
+            return reply(api("/api/join", req.body, format), format);
         }
     );
 
@@ -127,52 +311,76 @@ int main()
     .methods("POST"_method)
     ([](const crow::request& req)
     {
-        auto r = engine.startGame(req.body);
-        std::cout << "Return " << r << endl;
-        return r;
+        const auto format = bodyFormat(req);
+        auto r = api("/api/startGame", req.body, format);
+        if (format == Format::JSON) std::cout << "Return " << r << endl;
+        return reply(r, format);
     });
 
     CROW_ROUTE(app, "/api/startRound")
     .methods("POST"_method)
     ([](const crow::request& req)
     {
-        auto r = engine.startRound(req.body);
-        std::cout << "Return " << r << endl;
-        return r;
+        const auto format = bodyFormat(req);
+        auto r = api("/api/startRound", req.body, format);
+        if (format == Format::JSON) std::cout << "Return " << r << endl;
+        return reply(r, format);
     });
 
     CROW_ROUTE(app, "/api/bid")
     .methods("POST"_method)
     ([](const crow::request& req)
     {
-        auto r = engine.bid(req.body);
-        std::cout << "Return " << r << endl;
-        return r;
+        const auto format = bodyFormat(req);
+        auto r = api("/api/bid", req.body, format);
+        if (format == Format::JSON) std::cout << "Return " << r << endl;
+        return reply(r, format);
     });
 
     CROW_ROUTE(app, "/api/challenge")
     .methods("POST"_method)
     ([](const crow::request& req) {
-        auto r = engine.challenge(req.body);
-        std::cout << "Return " << r << endl;
-        return r;
+        const auto format = bodyFormat(req);
+        auto r = api("/api/challenge", req.body, format);
+        if (format == Format::JSON) std::cout << "Return " << r << endl;
+        return reply(r, format);
+    });
+
+    CROW_ROUTE(app, "/api/addBot")
+    .methods("POST"_method)
+    ([](const crow::request& req) {
+        const auto format = bodyFormat(req);
+        return reply(api("/api/addBot", req.body, format), format);
+    });
+
+    CROW_ROUTE(app, "/api/batch")
+    .methods("POST"_method)
+    ([&app](const crow::request& req) {
+        const auto format = bodyFormat(req);
+        const auto& accept = app.get_context<Negotiation>(req).accept;
+        return pack(api("/api/batch", req.body, format), accept, format);
     });
 
     CROW_ROUTE(app, "/api/games")([] {
-        return engine.getGames();
+        return api("/api/games", "", Format::JSON);
+    });
+
+    CROW_ROUTE(app, "/api/metrics")([] {
+        return api("/api/metrics", "", Format::JSON);
     });
 
     CROW_ROUTE(app, "/api/logout")
         .methods("POST"_method)
         ([](const crow::request& req) {
-            return engine.logout(req.body);
+            const auto format = bodyFormat(req);
+            return reply(api("/api/logout", req.body, format), format);
         });
 
 // Not using server side redirects for url with query params. The redirection
 // changes based on the query params. If the state on server changes, the client
 // may still be using cached value.
 #ifdef SERVER_SIDE_REDIRECT 
-    CROW_ROUTE(app, "/game.html")([](const crow::request& req) {
+    CROW_ROUTE(app, "/game.html")([&app](const crow::request& req) {
         const auto id = req.url_params.get("id");
         if (!engine.hasPlayer(id))
         {
@@ -181,20 +389,20 @@ int main()
             resp.redirect("/login.html");
             return resp;
         }
-        return readHtmlFile("game.html");
+        return readFile("game.html", app.get_context<Negotiation>(req).accept);
     });
 #endif
 
-    CROW_ROUTE(app, "/game2.html")([](const crow::request& req) {
-	   return readFile("game.html", req);
+    CROW_ROUTE(app, "/game2.html")([&app](const crow::request& req) {
+	   return readFile("game.html", app.get_context<Negotiation>(req).accept);
     });
 
-    CROW_ROUTE(app, "/<string>")([](const crow::request& req, std::string name) {
-	    return readFile(name, req);
+    CROW_ROUTE(app, "/<string>")([&app](const crow::request& req, std::string name) {
+	    return readFile(name, app.get_context<Negotiation>(req).accept);
     });
 
-    CROW_ROUTE(app, "/<string>/<string>")([](const crow::request& req, std::string dir, std::string name) {
-        return readFile(dir + "/" + name, req);
+    CROW_ROUTE(app, "/<string>/<string>")([&app](const crow::request& req, std::string dir, std::string name) {
+        return readFile(dir + "/" + name, app.get_context<Negotiation>(req).accept);
     });
 
     //crow::logger::setLogLevel(crow::LogLevel::CRITICAL);
@@ -0,0 +1,65 @@
+#include "endgame.hpp"
+
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+using namespace std;
+using namespace dice;
+
+namespace {
+
+void usage()
+{
+    cerr << "Usage: bluff_endgame [-n dice] [-i iterations] [endgame.tbl]" << endl
+         << "Solves the 1v1 endgames with up to the given dice per player (1-"
+         << MAX_ENDGAME_DICE << ") and writes the table for bluff -e." << endl;
+}
+
+} // unnamed namespace
+
+int main(int argc, char* argv[])
+{
+    int maxDice = 2;
+    int iterations = 1000;
+    string path = "endgame.tbl";
+    for (int i = 1; i < argc; ++i)
+    {
+        const string arg = argv[i];
+        if ((arg == "-n" || arg == "-i") && i + 1 < argc)
+        {
+            const auto value = atoi(argv[++i]);
+            if (arg == "-n") maxDice = value;
+            else iterations = value;
+            continue;
+        }
+        if (arg[0] == '-')
+        {
+            usage();
+            return 1;
+        }
+        path = arg;
+    }
+    if (maxDice < 1 || maxDice > MAX_ENDGAME_DICE || iterations < 1)
+    {
+        usage();
+        return 1;
+    }
+
+    const auto t0 = chrono::steady_clock::now();
+    const auto values = solveEndgames(path, maxDice, iterations);
+    const chrono::duration<double> duration = chrono::steady_clock::now() - t0;
+
+    cout << "Solved in " << duration.count() << " s" << endl
+         << "Win probability of the player starting the round, own dice down, opponent across:" << endl;
+    for (int a = 1; a <= maxDice; ++a)
+    {
+        for (int b = 1; b <= maxDice; ++b)
+        {
+            cout << setw(8) << fixed << setprecision(3) << values[size_t(a)][size_t(b)];
+        }
+        cout << endl;
+    }
+}
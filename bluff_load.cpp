@@ -0,0 +1,333 @@
+#include "bid.hpp"
+#include "engine.hpp"
+#include "helpers.hpp"
+#include "histogram.hpp"
+#include "httpclient.hpp"
+#include "json.hpp"
+#include "rules.hpp"
+#include "sim.hpp"
+#include "traffic.hpp"
+
+#include <rapidjson/document.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <queue>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+using namespace dice;
+
+namespace {
+
+using Clock = chrono::steady_clock;
+
+void usage()
+{
+    cerr << "Usage: bluff_load [-p players] [-g seats] [-t threads] [-k think_ms] [-d db.json] [-s host:port]" << endl
+         << "Logs in the players, forms games of the given size and plays them to the end" << endl
+         << "with the probability strategy. Runs against an in-process engine loaded from" << endl
+         << "db.json or, with -s, against a running server." << endl;
+}
+
+struct Config
+{
+    unsigned players = 1000;
+    unsigned seats = 4;
+    unsigned threads = 0;
+    unsigned thinkMs = 0;
+    string db;
+    string host;
+    string port;
+};
+
+struct Seat
+{
+    string id;
+    string name;
+};
+
+struct LoadGame
+{
+    string name;
+    vector<Seat> seats;
+    Clock::time_point due;
+    bool finished;
+};
+
+// Latencies in microseconds per route
+using Histograms = map<string, Histogram>;
+
+struct Result
+{
+    Histograms latencies;
+    long long moves = 0;
+    long long errors = 0;
+    long long finished = 0;
+};
+
+// Calls the API of the engine or the server and records the latencies
+class Driver
+{
+    Engine& engine_;
+    unique_ptr<HttpClient> client_;
+    Result& result_;
+public:
+    Driver(Engine& engine, const Config& config, Result& result)
+      : engine_{engine},
+        client_{config.host.empty() ? nullptr : make_unique<HttpClient>(config.host, config.port)},
+        result_{result}
+    {
+    }
+
+    rapidjson::Document call(const string& route, const string& body)
+    {
+        string response;
+        const auto t0 = Clock::now();
+        try {
+            response = client_ ? client_->post(route, body, "application/json") :
+                dispatch(engine_, route, body, Format::JSON);
+        }
+        catch (const exception&) {}
+        const auto us = chrono::duration_cast<chrono::microseconds>(Clock::now() - t0).count();
+        result_.latencies[route].record(static_cast<uint64_t>(us));
+
+        rapidjson::Document doc;
+        doc.Parse(response.c_str());
+        if (!doc.IsObject() || doc.HasMember("error")) ++result_.errors;
+        return doc;
+    }
+};
+
+string idBody(const Seat& seat)
+{
+    return json::Json({"id", seat.id}).str();
+}
+
+// Plays one step: starts the next round or makes the move of the player in
+// turn the way a client would, by polling the status first
+void step(Driver& driver, LoadGame& game, const sim::IStrategy& strategy, sim::Rng& rng, Result& result)
+{
+    const auto& host = game.seats.front();
+    const auto status = driver.call("/api/status", idBody(host));
+    if (!status.IsObject() || !status.HasMember("game"))
+    {
+        game.finished = true;
+        return;
+    }
+    const auto& g = status["game"];
+    const string state = json::getString(g, "state");
+    if (state == "GAME_FINISHED")
+    {
+        game.finished = true;
+        ++result.finished;
+        return;
+    }
+    if (state == "CHALLENGE" || state == "GAME_STARTED")
+    {
+        driver.call("/api/startRound", idBody(host));
+        return;
+    }
+    if (state != "ROUND_STARTED")
+    {
+        // The game could not be started
+        game.finished = true;
+        return;
+    }
+
+    const auto turn = json::getInt(g, "turn");
+    const auto& players = json::getValue(g, "players");
+    const string name = json::getString(players[static_cast<rapidjson::SizeType>(turn)], "name");
+    const auto seat = find_if(game.seats.begin(), game.seats.end(),
+                              [&name](const Seat& s) { return s.name == name; });
+    if (seat == game.seats.end())
+    {
+        game.finished = true;
+        return;
+    }
+
+    // The player in turn sees own dice
+    const auto own = driver.call("/api/status", idBody(*seat));
+    if (!own.IsObject() || !own.HasMember("game")) return;
+    const auto& ownGame = own["game"];
+    const auto& ownPlayers = json::getValue(ownGame, "players");
+    vector<uint8_t> diceLeft;
+    vector<uint8_t> hand;
+    int total = 0;
+    for (rapidjson::SizeType i = 0; i < ownPlayers.Size(); ++i)
+    {
+        const auto& h = json::getValue(ownPlayers[i], "hand");
+        diceLeft.push_back(static_cast<uint8_t>(h.Size()));
+        total += static_cast<int>(h.Size());
+        if (static_cast<int>(i) == turn)
+        {
+            for (const auto& d : h.GetArray()) hand.push_back(static_cast<uint8_t>(d.GetInt()));
+        }
+    }
+    const sim::View view{turn, static_cast<int>(diceLeft.size()), hand.data(),
+                         static_cast<int>(hand.size()), diceLeft.data(), total,
+                         Bid::fromJson(json::getValue(ownGame, "bid"))};
+    const auto bid = strategy.decide(view, rng);
+    if (bid == Bid{})
+    {
+        driver.call("/api/challenge", idBody(*seat));
+    }
+    else
+    {
+        driver.call("/api/bid", json::Json({
+            {"id", seat->id},
+            {"n", bid.n()},
+            {"face", bid.face()}
+        }).str());
+    }
+    ++result.moves;
+}
+
+Result play(vector<LoadGame>& games, const Config& config, Engine& engine, uint64_t seed)
+{
+    Result result;
+    Driver driver{engine, config, result};
+    sim::Rng rng{seed};
+    const sim::ProbabilityStrategy strategy;
+
+    // Form the games
+    for (auto& game : games)
+    {
+        for (auto& seat : game.seats)
+        {
+            const auto doc = driver.call("/api/login", json::Json({"name", seat.name}).str());
+            if (doc.IsObject() && doc.HasMember("id")) seat.id = doc["id"].GetString();
+        }
+        driver.call("/api/newGame", json::Json({{"id", game.seats[0].id}, {"game", game.name}}).str());
+        for (size_t i = 1; i < game.seats.size(); ++i)
+        {
+            driver.call("/api/join", json::Json({{"id", game.seats[i].id}, {"game", game.name}}).str());
+        }
+        driver.call("/api/startGame", idBody(game.seats[0]));
+    }
+
+    // Play them concurrently, each game acting again after the think time
+    using Due = pair<Clock::time_point, size_t>;
+    priority_queue<Due, vector<Due>, greater<Due>> queue;
+    for (size_t i = 0; i < games.size(); ++i) queue.emplace(Clock::now(), i);
+    while (!queue.empty())
+    {
+        const auto due = queue.top();
+        queue.pop();
+        this_thread::sleep_until(due.first);
+        auto& game = games[due.second];
+        step(driver, game, strategy, rng, result);
+        if (game.finished) continue;
+        // Uniformly 0.5 - 1.5 times the think time
+        const auto think = static_cast<long long>(config.thinkMs * (rng() % 1000 + 500));
+        queue.emplace(Clock::now() + chrono::microseconds{think}, due.second);
+    }
+
+    for (const auto& game : games)
+    {
+        for (const auto& seat : game.seats) driver.call("/api/logout", idBody(seat));
+    }
+    return result;
+}
+
+} // unnamed namespace
+
+int main(int argc, char* argv[])
+{
+    Config config;
+    for (int i = 1; i < argc; ++i)
+    {
+        const string arg = argv[i];
+        if (i + 1 >= argc)
+        {
+            usage();
+            return 1;
+        }
+        const string value = argv[++i];
+        const auto number = static_cast<unsigned>(strtoul(value.c_str(), nullptr, 10));
+        if (arg == "-p") config.players = number;
+        else if (arg == "-g") config.seats = number;
+        else if (arg == "-t") config.threads = number;
+        else if (arg == "-k") config.thinkMs = number;
+        else if (arg == "-d") config.db = value;
+        else if (arg == "-s" && value.rfind(':') != string::npos)
+        {
+            config.host = value.substr(0, value.rfind(':'));
+            config.port = value.substr(value.rfind(':') + 1);
+        }
+        else
+        {
+            usage();
+            return 1;
+        }
+    }
+    if (config.seats < 2 || config.seats > static_cast<unsigned>(MAX_PLAYERS) || config.players < config.seats)
+    {
+        usage();
+        return 1;
+    }
+    if (config.threads == 0) config.threads = max(1u, thread::hardware_concurrency());
+
+    // Unique names so that the tool can be run against a server repeatedly
+    random_device rd;
+    const auto tag = to_string(rd() % 1000000);
+    const auto numGames = config.players / config.seats;
+    vector<vector<LoadGame>> perThread(config.threads);
+    for (unsigned g = 0; g < numGames; ++g)
+    {
+        LoadGame game{"load-" + tag + "-" + to_string(g), {}, {}, false};
+        for (unsigned s = 0; s < config.seats; ++s)
+        {
+            game.seats.push_back(Seat{"", "bot-" + tag + "-" + to_string(g) + "-" + to_string(s)});
+        }
+        perThread[g % config.threads].push_back(move(game));
+    }
+
+    vector<uint64_t> seeds;
+    for (unsigned i = 0; i < config.threads; ++i) seeds.push_back((uint64_t{rd()} << 32) ^ rd());
+
+    Engine engine{config.db};
+    vector<Result> results(config.threads);
+    vector<thread> threads;
+    const auto start = Clock::now();
+    for (unsigned i = 0; i < config.threads; ++i)
+    {
+        threads.emplace_back([&, i] {
+            results[i] = play(perThread[i], config, engine, seeds[i]);
+        });
+    }
+    for (auto& t : threads) t.join();
+    const chrono::duration<double> seconds = Clock::now() - start;
+
+    Result total;
+    for (const auto& r : results)
+    {
+        for (const auto& kv : r.latencies) total.latencies[kv.first].merge(kv.second);
+        total.moves += r.moves;
+        total.errors += r.errors;
+        total.finished += r.finished;
+    }
+    cout << total.finished << "/" << numGames << " games finished, " << total.moves << " moves in "
+         << seconds.count() << " s, " << static_cast<double>(total.moves) / seconds.count()
+         << " moves/s, " << total.errors << " errors" << endl;
+    cout << left << setw(16) << "route" << right << setw(10) << "count" << setw(10) << "mean"
+         << setw(10) << "p50" << setw(10) << "p90" << setw(10) << "p99" << setw(10) << "max"
+         << "  (us)" << endl;
+    for (const auto& kv : total.latencies)
+    {
+        const auto& h = kv.second;
+        cout << left << setw(16) << kv.first << right << setw(10) << h.count()
+             << setw(10) << static_cast<long long>(h.mean())
+             << setw(10) << h.percentile(0.5) << setw(10) << h.percentile(0.9)
+             << setw(10) << h.percentile(0.99) << setw(10) << h.max() << endl;
+    }
+}
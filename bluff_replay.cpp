@@ -0,0 +1,222 @@
+#include "engine.hpp"
+#include "helpers.hpp"
+#include "httpclient.hpp"
+#include "json.hpp"
+#include "msgpack.hpp"
+#include "traffic.hpp"
+
+#include <rapidjson/document.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+using namespace std;
+using namespace dice;
+
+namespace {
+
+using Clock = chrono::steady_clock;
+
+void usage()
+{
+    cerr << "Usage: bluff_replay [-t threads] [-x speedup] [-d db.json] [-s host:port] traffic.jsonl" << endl
+         << "Replays the traffic recorded with bluff -r against an in-process engine loaded" << endl
+         << "from db.json or, with -s, against a running server. Speedup 0 sends the requests" << endl
+         << "as fast as possible." << endl;
+}
+
+struct Config
+{
+    unsigned threads = 1;
+    double speedup = 1.0;
+    string db;
+    string host;
+    string port;
+};
+
+struct Result
+{
+    vector<long long> latencies;
+    long long errors = 0;
+};
+
+// Player of the request: the id created by login or the id in the body
+string playerOf(const Record& r)
+{
+    if (!r.player.empty()) return r.player;
+    rapidjson::Document doc;
+    doc.Parse(r.body.c_str());
+    if (doc.IsObject() && doc.HasMember("id") && doc["id"].IsString()) return doc["id"].GetString();
+    return "";
+}
+
+void replaceAll(string& s, const string& from, const string& to)
+{
+    for (auto pos = s.find(from); pos != string::npos; pos = s.find(from, pos + to.size()))
+    {
+        s.replace(pos, from.size(), to);
+    }
+}
+
+// Sends the requests of one thread. The ids of the players logging in
+// during the replay differ from the recorded ones and are mapped.
+Result replay(const vector<const Record*>& records, const Config& config, Engine& engine,
+              Clock::time_point start, long long t0)
+{
+    unique_ptr<HttpClient> client;
+    if (!config.host.empty()) client = make_unique<HttpClient>(config.host, config.port);
+
+    Result result;
+    result.latencies.reserve(records.size());
+    unordered_map<string, string> ids;
+    for (const auto r : records)
+    {
+        auto body = r->body;
+        for (const auto& kv : ids) replaceAll(body, kv.first, kv.second);
+        if (r->format == Format::MSGPACK) body = msgpack::fromJson(body);
+
+        if (config.speedup > 0)
+        {
+            const auto due = chrono::microseconds{static_cast<long long>(static_cast<double>(r->t - t0) / config.speedup)};
+            this_thread::sleep_until(start + due);
+        }
+
+        string response;
+        bool failed = false;
+        const auto sent = Clock::now();
+        if (client)
+        {
+            try {
+                const auto contentType = r->format == Format::MSGPACK ? "application/msgpack" : "application/json";
+                response = (r->route == "/api/games" || r->route == "/api/metrics") ?
+                    client->get(r->route) : client->post(r->route, body, contentType);
+                failed = client->status() != 200;
+            }
+            catch (const exception&) {
+                failed = true;
+            }
+        }
+        else
+        {
+            response = dispatch(engine, r->route, body, r->format);
+        }
+        result.latencies.push_back(chrono::duration_cast<chrono::microseconds>(Clock::now() - sent).count());
+
+        rapidjson::Document doc;
+        doc.Parse(r->format == Format::MSGPACK ? msgpack::toJson(response).c_str() : response.c_str());
+        if (failed || !doc.IsObject() || doc.HasMember("error"))
+        {
+            ++result.errors;
+            continue;
+        }
+        if (!r->player.empty() && doc.HasMember("id") && doc["id"].IsString())
+        {
+            ids[r->player] = doc["id"].GetString();
+        }
+    }
+    return result;
+}
+
+long long percentile(const vector<long long>& sorted, double p)
+{
+    if (sorted.empty()) return 0;
+    const auto i = static_cast<size_t>(p * static_cast<double>(sorted.size() - 1) + 0.5);
+    return sorted[i];
+}
+
+} // unnamed namespace
+
+int main(int argc, char* argv[])
+{
+    Config config;
+    string file;
+    for (int i = 1; i < argc; ++i)
+    {
+        const string arg = argv[i];
+        if (i + 1 < argc && (arg == "-t" || arg == "-x" || arg == "-d" || arg == "-s"))
+        {
+            const string value = argv[++i];
+            if (arg == "-t") config.threads = max(1u, static_cast<unsigned>(strtoul(value.c_str(), nullptr, 10)));
+            else if (arg == "-x") config.speedup = strtod(value.c_str(), nullptr);
+            else if (arg == "-d") config.db = value;
+            else
+            {
+                const auto colon = value.rfind(':');
+                if (colon == string::npos)
+                {
+                    usage();
+                    return 1;
+                }
+                config.host = value.substr(0, colon);
+                config.port = value.substr(colon + 1);
+            }
+            continue;
+        }
+        if (!file.empty() || arg[0] == '-')
+        {
+            usage();
+            return 1;
+        }
+        file = arg;
+    }
+    if (file.empty())
+    {
+        usage();
+        return 1;
+    }
+
+    const auto records = readTraffic(file);
+    if (records.empty())
+    {
+        cerr << "No requests in " << file << endl;
+        return 1;
+    }
+
+    // Requests of a player stay in one thread in the recorded order
+    vector<vector<const Record*>> perThread(config.threads);
+    hash<string> hasher;
+    size_t anonymous = 0;
+    for (const auto& r : records)
+    {
+        const auto player = playerOf(r);
+        const auto slot = player.empty() ? anonymous++ : hasher(player);
+        perThread[slot % config.threads].push_back(&r);
+    }
+
+    Engine engine{config.db};
+    vector<Result> results(config.threads);
+    vector<thread> threads;
+    const auto start = Clock::now();
+    for (unsigned i = 0; i < config.threads; ++i)
+    {
+        threads.emplace_back([&, i] {
+            results[i] = replay(perThread[i], config, engine, start, records.front().t);
+        });
+    }
+    for (auto& t : threads) t.join();
+    const chrono::duration<double> seconds = Clock::now() - start;
+
+    vector<long long> latencies;
+    long long errors = 0;
+    for (const auto& r : results)
+    {
+        latencies.insert(latencies.end(), r.latencies.begin(), r.latencies.end());
+        errors += r.errors;
+    }
+    sort(latencies.begin(), latencies.end());
+    cout << latencies.size() << " requests in " << seconds.count() << " s, "
+         << static_cast<double>(latencies.size()) / seconds.count() << " requests/s, "
+         << errors << " errors" << endl;
+    cout << "latency us: p50 " << percentile(latencies, 0.5)
+         << ", p90 " << percentile(latencies, 0.9)
+         << ", p99 " << percentile(latencies, 0.99)
+         << ", max " << latencies.back() << endl;
+}
@@ -0,0 +1,62 @@
+#include "bots.hpp"
+#include "endgame.hpp"
+#include "engine.hpp"
+#include "shard.hpp"
+
+#include <exception>
+#include <iostream>
+#include <string>
+
+using namespace std;
+using namespace dice;
+
+namespace {
+
+void usage()
+{
+    cerr << "Usage: bluff_shard [-d db.json] [-e endgame.tbl] shard.sock" << endl
+         << "Serves a shard of the games on the Unix domain socket for bluff -s." << endl;
+}
+
+} // unnamed namespace
+
+int main(int argc, char* argv[])
+{
+    string db = "db.json";
+    string path;
+    BotConfig config;
+    for (int i = 1; i < argc; ++i)
+    {
+        const string arg = argv[i];
+        if ((arg == "-d" || arg == "-e") && i + 1 < argc)
+        {
+            if (arg == "-d") db = argv[++i];
+            else config.endgame = argv[++i];
+            continue;
+        }
+        if (arg[0] == '-' || !path.empty())
+        {
+            usage();
+            return 1;
+        }
+        path = arg;
+    }
+    if (path.empty())
+    {
+        usage();
+        return 1;
+    }
+
+    try {
+        static Engine engine{db};
+        if (!config.endgame.empty())
+        {
+            EndgameTable table{config.endgame};
+            engine.setBotConfig(config);
+        }
+        serveShard(engine, path);
+    } catch (const exception& e) {
+        cerr << e.what() << endl;
+        return 1;
+    }
+}
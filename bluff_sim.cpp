@@ -0,0 +1,63 @@
+#include "sim.hpp"
+
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace dice;
+
+namespace {
+
+void usage()
+{
+    cerr << "Usage: bluff_sim [-g games] [-t threads] [-s seed] strategy strategy [strategy...]" << endl
+         << "Strategies: random, probability, montecarlo" << endl;
+}
+
+} // unnamed namespace
+
+int main(int argc, char* argv[])
+{
+    sim::Config config;
+    vector<unique_ptr<sim::IStrategy>> strategies;
+    for (int i = 1; i < argc; ++i)
+    {
+        const string arg = argv[i];
+        if ((arg == "-g" || arg == "-t" || arg == "-s") && i + 1 < argc)
+        {
+            const auto value = strtoull(argv[++i], nullptr, 10);
+            if (arg == "-g") config.games = static_cast<long long>(value);
+            else if (arg == "-t") config.threads = static_cast<unsigned>(value);
+            else config.seed = value;
+            continue;
+        }
+        auto strategy = sim::makeStrategy(arg);
+        if (!strategy)
+        {
+            usage();
+            return 1;
+        }
+        strategies.push_back(move(strategy));
+    }
+    if (strategies.size() < 2 || strategies.size() > static_cast<size_t>(MAX_PLAYERS))
+    {
+        usage();
+        return 1;
+    }
+
+    vector<const sim::IStrategy*> seats;
+    for (const auto& s : strategies) seats.push_back(s.get());
+    const auto stats = sim::run(seats, config);
+
+    cout << stats.games << " games, " << stats.rounds << " rounds, "
+         << stats.moves << " moves in " << stats.seconds << " s" << endl;
+    cout << stats.gamesPerSecond() << " games/s" << endl;
+    for (size_t i = 0; i < seats.size(); ++i)
+    {
+        cout << "seat " << i << " (" << seats[i]->name() << "): "
+             << 100.0 * stats.winRate(i) << " %" << endl;
+    }
+}
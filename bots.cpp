@@ -0,0 +1,117 @@
+#include "bots.hpp"
+
+#include "endgame.hpp"
+#include "game.hpp"
+#include "threadpool.hpp"
+
+#include <algorithm>
+
+namespace dice {
+
+BotScheduler::BotScheduler(unsigned threads)
+  : numThreads_{std::max(1u, threads)},
+    mutex_{},
+    cv_{},
+    queue_{},
+    seq_{},
+    stop_{},
+    threads_{}
+{
+}
+
+BotScheduler::~BotScheduler()
+{
+    {
+        std::lock_guard<std::mutex> lock{mutex_};
+        stop_ = true;
+    }
+    cv_.notify_all();
+    for (auto& t : threads_) t.join();
+}
+
+void BotScheduler::schedule(Clock::time_point due, Task task)
+{
+    {
+        std::lock_guard<std::mutex> lock{mutex_};
+        if (stop_) return;
+        queue_.push(Entry{due, seq_++, std::move(task)});
+        while (threads_.size() < numThreads_) threads_.emplace_back([this] { run(); });
+    }
+    cv_.notify_one();
+}
+
+std::size_t BotScheduler::pending() const
+{
+    std::lock_guard<std::mutex> lock{mutex_};
+    return queue_.size();
+}
+
+void BotScheduler::run()
+{
+    std::unique_lock<std::mutex> lock{mutex_};
+    while (!stop_)
+    {
+        if (queue_.empty())
+        {
+            cv_.wait(lock);
+            continue;
+        }
+        const auto due = queue_.top().due;
+        if (due > Clock::now())
+        {
+            cv_.wait_until(lock, due);
+            continue;
+        }
+        auto task = std::move(const_cast<Entry&>(queue_.top()).task);
+        queue_.pop();
+        // Another task may be due as well
+        if (!queue_.empty()) cv_.notify_one();
+        lock.unlock();
+        task();
+        lock.lock();
+    }
+}
+
+BotPosition::BotPosition(const Game& game)
+  : turn{game.turn()},
+    hand{},
+    diceLeft{},
+    totalDice{0},
+    bid{game.currentBid()}
+{
+    const auto& players = game.players();
+    for (const auto& p : players)
+    {
+        diceLeft.push_back(static_cast<std::uint8_t>(p.hand().size()));
+        totalDice += static_cast<int>(p.hand().size());
+    }
+    for (const auto d : players[static_cast<std::size_t>(turn)].hand())
+    {
+        hand.push_back(static_cast<std::uint8_t>(d));
+    }
+}
+
+sim::View BotPosition::view() const
+{
+    return sim::View{turn, static_cast<int>(diceLeft.size()), hand.data(),
+                     static_cast<int>(hand.size()), diceLeft.data(), totalDice, bid};
+}
+
+Bid decideBotMove(const BotPosition& position, sim::Rng& rng, std::chrono::steady_clock::time_point deadline,
+                  const EndgameTable* endgame)
+{
+    static ThreadPool pool;
+    static const sim::MonteCarloStrategy policy{&pool, 1024};
+
+    const auto view = position.view();
+    if (endgame && endgame->covers(view)) return endgame->decide(view, rng);
+    return policy.decide(view, rng, deadline);
+}
+
+Bid decideBotMove(const Game& game, sim::Rng& rng, std::chrono::steady_clock::time_point deadline,
+                  const EndgameTable* endgame)
+{
+    return decideBotMove(BotPosition{game}, rng, deadline, endgame);
+}
+
+} // namespace dice
@@ -0,0 +1,129 @@
+#pragma once
+
+#include "bid.hpp"
+#include "sim.hpp"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace dice {
+
+class EndgameTable;
+class Game;
+
+/// Configuration of the server-side bots
+struct BotConfig
+{
+    /// Threads making the bot moves
+    unsigned threads = 1;
+    /// How long a bot waits before moving so that the players can follow
+    /// the game
+    std::chrono::milliseconds delay{1000};
+    /// How much time a move may take after the delay. The policy gets the
+    /// end of the budget as its deadline and the moves made after it are
+    /// counted in the metrics.
+    std::chrono::milliseconds budget{100};
+    /// Endgame table written by bluff_endgame for the 1v1 positions, empty
+    /// for none
+    std::string endgame;
+};
+
+/// Runs tasks at given times on its own threads so that the bot moves never
+/// block the request threads. The threads are started on the first
+/// schedule. Pending tasks are dropped on destruction.
+class BotScheduler
+{
+public:
+    using Clock = std::chrono::steady_clock;
+    using Task = std::function<void()>;
+
+    /// Construct BotScheduler
+    /// @param threads [in] number of threads, at least one is used
+    explicit BotScheduler(unsigned threads);
+
+    /// Stop the threads
+    ~BotScheduler();
+
+    BotScheduler(BotScheduler&&) = delete;
+
+    /// Run the task at the given time or as soon as a thread is free after
+    /// it. Thread-safe.
+    /// @param due [in] when to run the task
+    /// @param task [in] task to run
+    void schedule(Clock::time_point due, Task task);
+
+    /// @return number of tasks waiting to run
+    std::size_t pending() const;
+
+private:
+    struct Entry
+    {
+        Clock::time_point due;
+        // Tasks due at the same time run in the order of scheduling
+        std::uint64_t seq;
+        Task task;
+
+        bool operator>(const Entry& other) const
+        {
+            return due > other.due || (due == other.due && seq > other.seq);
+        }
+    };
+
+    const unsigned numThreads_;
+    mutable std::mutex mutex_;
+    std::condition_variable cv_;
+    std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> queue_;
+    std::uint64_t seq_;
+    bool stop_;
+    std::vector<std::thread> threads_;
+
+    void run();
+};
+
+/// What the player in turn sees: own dice, the number of dice of the others
+/// and the current bid. Copied out of the game so that the move can be
+/// decided without the engine locked.
+struct BotPosition
+{
+    /// Copy the position of the player in turn
+    /// @param game [in] game where a round is in progress
+    explicit BotPosition(const Game& game);
+
+    int turn;
+    std::vector<std::uint8_t> hand;
+    std::vector<std::uint8_t> diceLeft;
+    int totalDice;
+    Bid bid;
+
+    /// @return the position for the strategies, valid as long as this
+    sim::View view() const;
+};
+
+/// Decide the move of the player in turn. The moves are searched with
+/// sim::MonteCarloStrategy on a pool shared by the bots unless the position
+/// is in the endgame table.
+/// @param position [in] what the player in turn sees
+/// @param rng [in,out] random numbers for the policy
+/// @param deadline [in] when the decision must be ready
+/// @param endgame [in] solved endgames or nullptr
+/// @return bid to raise to or Bid{} to challenge
+Bid decideBotMove(const BotPosition& position, sim::Rng& rng, std::chrono::steady_clock::time_point deadline,
+                  const EndgameTable* endgame = nullptr);
+
+/// Decide the move of the player in turn of the game
+/// @param game [in] game where a round is in progress
+/// @param rng [in,out] random numbers for the policy
+/// @param deadline [in] when the decision must be ready
+/// @param endgame [in] solved endgames or nullptr
+/// @return bid to raise to or Bid{} to challenge
+Bid decideBotMove(const Game& game, sim::Rng& rng, std::chrono::steady_clock::time_point deadline,
+                  const EndgameTable* endgame = nullptr);
+
+} // namespace dice
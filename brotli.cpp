@@ -9,15 +9,18 @@
 #include <cassert>
 #include <cstdint>
 #include <memory>
+#include <stdexcept>
 
 namespace dice {
 
-std::string compress(const std::string& orig)
+namespace {
+
+std::string encode(const std::string& orig, int quality)
 {
     size_t encodedSize = BrotliEncoderMaxCompressedSize(orig.size());
     auto outBuf = std::make_unique<std::uint8_t[]>(encodedSize);
     auto ret = BrotliEncoderCompress(
-        BROTLI_DEFAULT_QUALITY,
+        quality,
         BROTLI_DEFAULT_WINDOW,
         BROTLI_MODE_TEXT,
         orig.size(), // Not including terminating zero
@@ -28,6 +31,13 @@ std::string compress(const std::string& orig)
     return std::string{reinterpret_cast<const char*>(outBuf.get()), encodedSize};
 }
 
+} // unnamed namespace
+
+std::string compress(const std::string& orig)
+{
+    return encode(orig, BROTLI_DEFAULT_QUALITY);
+}
+
 std::string decompress(const std::string& compressed)
 {
     std::string result;
@@ -64,4 +74,16 @@ std::string decompress(const std::string& compressed)
     }
 }
 
+std::string BrotliEncoder::compress(const std::string& data, Profile profile) const
+{
+    // Quality 11 is several times slower than 5 for a few percent smaller
+    // output, worth it only when the result is cached
+    return encode(data, profile == Profile::STATIC ? BROTLI_MAX_QUALITY : 5);
+}
+
+std::string BrotliEncoder::decompress(const std::string& data) const
+{
+    return dice::decompress(data);
+}
+
 } // namespace dice
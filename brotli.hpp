@@ -1,5 +1,7 @@
 #pragma once
 
+#include "encoder.hpp"
+
 #include <string>
 
 namespace dice {
@@ -8,4 +10,13 @@ std::string compress(const std::string& orig);
 
 std::string decompress(const std::string& compressed);
 
+/// Brotli encoder. Static files are compressed with the best quality.
+class BrotliEncoder : public Encoder
+{
+public:
+    Encoding encoding() const override { return Encoding::BR; }
+    std::string compress(const std::string& data, Profile profile) const override;
+    std::string decompress(const std::string& data) const override;
+};
+
 } // namespace dice
@@ -1,11 +1,16 @@
 #include "dice.hpp"
 
-#include <random>
+#include "rng.hpp"
 
 namespace dice {
 
 IDice::~IDice() {}
 
+void IDice::rollMany(int* first, std::size_t n) const
+{
+    for (std::size_t i = 0; i < n; ++i) first[i] = roll();
+}
+
 void Dice::setInstance(const IDice* dice) { dice_ = dice; }
 const IDice& Dice::instance()
 {
@@ -14,13 +19,48 @@ const IDice& Dice::instance()
     return dice;
 }
 
+const IDice& Dice::instance(const IDice& fallback)
+{
+    return dice_ ? *dice_ : fallback;
+}
+
 int Dice::roll() const
 {
-    static std::random_device r;
-    static std::default_random_engine e1(r());
-    std::uniform_int_distribution<int> uniform_dist(1, 6);
-    return uniform_dist(e1);
+    return rollDie(threadRng());
+}
+
+void Dice::rollMany(int* first, std::size_t n) const
+{
+    fillDice(threadRng(), first, n);
 }
 const IDice* Dice::dice_{nullptr};
 
+SeededDice::SeededDice(std::uint64_t seed, std::uint64_t position)
+  : seed_{},
+    position_{},
+    rng_{}
+{
+    reset(seed, position);
+}
+
+void SeededDice::reset(std::uint64_t seed, std::uint64_t position)
+{
+    seed_ = seed;
+    position_ = position;
+    rng_.seed(seed);
+    rng_.discard(position);
+}
+
+int SeededDice::roll() const
+{
+    int face;
+    position_ += fillDice(rng_, &face, 1);
+    return face;
+}
+
+void SeededDice::rollMany(int* first, std::size_t n) const
+{
+    position_ += fillDice(rng_, first, n);
+}
+
 } // namespace dice
@@ -1,5 +1,10 @@
 #pragma once
 
+#include "rng.hpp"
+
+#include <cstddef>
+#include <cstdint>
+
 namespace dice {
 
 /// Abstraction for dice roll
@@ -11,6 +16,11 @@ public:
     /// Roll the dice
     /// @return face of the dice [1, 6]
     virtual int roll() const = 0;
+    /// Roll many dice at once. Default implementation calls roll() for
+    /// every dice.
+    /// @param first [out] faces [1, 6] are written here
+    /// @param n [in] number of dice to roll
+    virtual void rollMany(int* first, std::size_t n) const;
 };
 
 /// Dice roller randomizing the dice roll
@@ -24,9 +34,48 @@ public:
     /// Get the configured dice instance
     /// @return IDice object
     static const IDice& instance();
+    /// Get the dice instance set with setInstance, if any
+    /// @param fallback [in] dice to use when no instance has been set
+    /// @return IDice object
+    static const IDice& instance(const IDice& fallback);
+
+    /// @see IDice::roll
+    virtual int roll() const override;
+    /// @see IDice::rollMany
+    virtual void rollMany(int* first, std::size_t n) const override;
+};
+
+/// Reproducible stream of dice. The stream is fully described by the seed
+/// and the position in the stream so that it can be saved with the game
+/// and continued bit-exactly after loading.
+class SeededDice : public IDice
+{
+    std::uint64_t seed_;
+    mutable std::uint64_t position_;
+    mutable Xoshiro256 rng_;
+public:
+    /// Construct SeededDice
+    /// @param seed [in] seed for the stream
+    /// @param position [in] how many random numbers the stream has
+    ///     already consumed
+    explicit SeededDice(std::uint64_t seed, std::uint64_t position = 0);
+
+    /// Continue another stream
+    /// @param seed [in] seed for the stream
+    /// @param position [in] how many random numbers the stream has
+    ///     already consumed
+    void reset(std::uint64_t seed, std::uint64_t position);
+
+    /// @return seed of the stream
+    auto seed() const { return seed_; }
+
+    /// @return number of random numbers consumed so far
+    auto position() const { return position_; }
 
     /// @see IDice::roll
     virtual int roll() const override;
+    /// @see IDice::rollMany
+    virtual void rollMany(int* first, std::size_t n) const override;
 };
 
 } // namespace dice
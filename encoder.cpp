@@ -0,0 +1,36 @@
+#include "encoder.hpp"
+
+#include "brotli.hpp"
+#include "gzip.hpp"
+#include "zstd.hpp"
+
+namespace dice {
+
+Encoder::~Encoder() = default;
+
+const Encoder* getEncoder(Encoding encoding)
+{
+    static const BrotliEncoder brotli;
+    static const GzipEncoder gzip;
+    static const ZstdEncoder zstd;
+    switch (encoding)
+    {
+    case Encoding::BR:
+        return &brotli;
+    case Encoding::GZIP:
+        return &gzip;
+    case Encoding::ZSTD:
+        return &zstd;
+    case Encoding::IDENTITY:
+        break;
+    }
+    return nullptr;
+}
+
+unsigned availableEncodings()
+{
+    return encodingBit(Encoding::IDENTITY) | encodingBit(Encoding::BR) |
+        encodingBit(Encoding::GZIP) | encodingBit(Encoding::ZSTD);
+}
+
+} // namespace dice
@@ -0,0 +1,46 @@
+#pragma once
+
+#include "httphelpers.hpp"
+
+#include <string>
+
+namespace dice {
+
+/// How much time to spend compressing
+enum class Profile
+{
+    /// Responses compressed on every request, e.g., status
+    DYNAMIC,
+    /// Static files compressed once and cached
+    STATIC
+};
+
+/// Compression for a content coding
+class Encoder
+{
+public:
+    virtual ~Encoder();
+
+    /// @return the content coding produced by the encoder
+    virtual Encoding encoding() const = 0;
+
+    /// Compress data
+    /// @param data [in] data to compress
+    /// @param profile [in] the quality to compress with
+    /// @return compressed data
+    virtual std::string compress(const std::string& data, Profile profile) const = 0;
+
+    /// Decompress data
+    /// @param data [in] compressed data
+    /// @return decompressed data
+    /// @throw std::runtime_error if the data is not valid
+    virtual std::string decompress(const std::string& data) const = 0;
+};
+
+/// @return encoder for the encoding or nullptr for identity
+const Encoder* getEncoder(Encoding encoding);
+
+/// @return bits of all the encodings, including identity
+unsigned availableEncodings();
+
+} // namespace dice
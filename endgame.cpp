@@ -0,0 +1,576 @@
+#include "endgame.hpp"
+
+#include "filehelpers.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace dice {
+
+namespace {
+
+const char MAGIC[8] = {'B', 'L', 'F', 'E', 'N', 'D', '1', '\0'};
+
+using Values = std::array<std::array<float, MAX_DICE + 1>, MAX_DICE + 1>;
+
+// Highest bid that can be true with the given dice on the table
+int maxScore(int totalDice)
+{
+    return Bid{totalDice, STAR}.score();
+}
+
+int binomial(int n, int k)
+{
+    int r = 1;
+    for (int i = 1; i <= k; ++i) r = r * (n - k + i) / i;
+    return r;
+}
+
+// Number of hands of m dice with faces in [from, 6]
+int multisets(int from, int m)
+{
+    return binomial(6 - from + m, m);
+}
+
+struct Hand
+{
+    std::array<int, 7> counts;
+    double probability;
+};
+
+// Hands of n dice in the order of handIndex
+std::vector<Hand> enumerateHands(int n)
+{
+    std::vector<Hand> hands;
+    std::array<std::uint8_t, MAX_DICE> dice{};
+    std::fill(dice.begin(), dice.begin() + n, std::uint8_t{1});
+    double perms = 1.0;
+    for (int i = 2; i <= n; ++i) perms *= i;
+    for (;;)
+    {
+        Hand h{};
+        for (int i = 0; i < n; ++i) ++h.counts[dice[static_cast<std::size_t>(i)]];
+        double p = perms;
+        for (int f = 1; f <= 6; ++f)
+        {
+            for (int c = 2; c <= h.counts[static_cast<std::size_t>(f)]; ++c) p /= c;
+        }
+        for (int i = 0; i < n; ++i) p /= 6.0;
+        h.probability = p;
+        hands.push_back(h);
+
+        // Next non-decreasing sequence
+        int i = n - 1;
+        while (i >= 0 && dice[static_cast<std::size_t>(i)] == 6) --i;
+        if (i < 0) break;
+        const auto next = static_cast<std::uint8_t>(dice[static_cast<std::size_t>(i)] + 1);
+        std::fill(dice.begin() + i, dice.begin() + n, next);
+    }
+    return hands;
+}
+
+// CFR+ over the rounds of a 1v1 endgame. Player A has x dice and B y dice.
+// A decision point is the current bid and the player to act, regardless of
+// the earlier bids. Either player may start the round. The payoff is the
+// probability that A wins the game, given by the values of the smaller
+// endgames.
+class Solver
+{
+    static constexpr int A = 0;
+    static constexpr int B = 1;
+
+    const int dice_[2];
+    const int m_;
+    const std::vector<Hand> hands_[2];
+    const std::size_t n_[2];
+    const std::size_t actions_;
+    const std::size_t cells_;
+    // Payoff of challenging bid s by player p: [(s * 2 + p) * cells_ + a * nb + b]
+    std::vector<double> terminal_;
+    // Payoff of the node under the current strategies, same layout
+    std::vector<double> u_;
+    // Reach of the player times chance: [p][(s * 2 + actor) * n_p + h]
+    std::vector<double> reach_[2];
+    // Per player, decision point and hand: [p][(s * n_p + h) * actions_ + a]
+    std::vector<double> regret_[2];
+    std::vector<double> sigma_[2];
+    std::vector<double> average_[2];
+
+    std::size_t node(int s, int actor) const { return static_cast<std::size_t>(s * 2 + actor); }
+
+    std::size_t slot(int p, int s, std::size_t h) const
+    {
+        return (static_cast<std::size_t>(s) * n_[p] + h) * actions_;
+    }
+
+    void initTerminal(const Values& values)
+    {
+        for (int s = 1; s <= m_; ++s)
+        {
+            const auto bid = Bid::fromScore(s);
+            for (int challenger = A; challenger <= B; ++challenger)
+            {
+                auto* t = &terminal_[node(s, challenger) * cells_];
+                for (const auto& ha : hands_[A])
+                {
+                    for (const auto& hb : hands_[B])
+                    {
+                        std::array<int, 7> counts;
+                        for (std::size_t f = 0; f < 7; ++f) counts[f] = ha.counts[f] + hb.counts[f];
+                        const int offset = bid.challenge(counts);
+                        const int bidder = 1 - challenger;
+                        int lost[2] = {0, 0};
+                        if (offset < 0) lost[bidder] = -offset;
+                        else lost[challenger] = std::max(1, offset);
+                        const int winner = offset >= 0 ? bidder : challenger;
+                        const int a = dice_[A] - lost[A];
+                        const int b = dice_[B] - lost[B];
+                        // The winner of the challenge starts the next round
+                        double u;
+                        if (a <= 0) u = 0.0;
+                        else if (b <= 0) u = 1.0;
+                        else if (winner == A) u = double(values[std::size_t(a)][std::size_t(b)]);
+                        else u = 1.0 - double(values[std::size_t(b)][std::size_t(a)]);
+                        *t++ = u;
+                    }
+                }
+            }
+        }
+    }
+
+    // Regret matching
+    void updateSigma()
+    {
+        for (int p = A; p <= B; ++p)
+        {
+            for (int s = 0; s <= m_; ++s)
+            {
+                const auto first = static_cast<std::size_t>(s == 0 ? 1 : 0);
+                for (std::size_t h = 0; h < n_[p]; ++h)
+                {
+                    const auto k = slot(p, s, h);
+                    const double* r = &regret_[p][k];
+                    double* sigma = &sigma_[p][k];
+                    double sum = 0.0;
+                    std::size_t legal = 0;
+                    for (auto a = first; a < actions_; ++a)
+                    {
+                        if (a != 0 && a <= static_cast<std::size_t>(s)) continue;
+                        sum += r[a];
+                        ++legal;
+                    }
+                    for (auto a = first; a < actions_; ++a)
+                    {
+                        if (a != 0 && a <= static_cast<std::size_t>(s)) continue;
+                        sigma[a] = sum > 0.0 ? r[a] / sum : 1.0 / double(legal);
+                    }
+                }
+            }
+        }
+    }
+
+    void forward()
+    {
+        for (int p = A; p <= B; ++p)
+        {
+            std::fill(reach_[p].begin(), reach_[p].end(), 0.0);
+            // Chance decides who starts
+            for (int actor = A; actor <= B; ++actor)
+            {
+                std::fill_n(&reach_[p][node(0, actor) * n_[p]], n_[p], 0.5);
+            }
+        }
+        for (int s = 0; s <= m_; ++s)
+        {
+            for (int p = A; p <= B; ++p)
+            {
+                const int o = 1 - p;
+                const double* rp = &reach_[p][node(s, p) * n_[p]];
+                const double* ro = &reach_[o][node(s, p) * n_[o]];
+                for (int a = s + 1; a <= m_; ++a)
+                {
+                    double* cp = &reach_[p][node(a, o) * n_[p]];
+                    double* co = &reach_[o][node(a, o) * n_[o]];
+                    for (std::size_t h = 0; h < n_[p]; ++h)
+                    {
+                        cp[h] += rp[h] * sigma_[p][slot(p, s, h) + static_cast<std::size_t>(a)];
+                    }
+                    for (std::size_t h = 0; h < n_[o]; ++h) co[h] += ro[h];
+                }
+            }
+        }
+    }
+
+    void backward()
+    {
+        // Weight of the action per hand of B
+        std::vector<double> wb(n_[B]);
+        for (int s = m_; s >= 0; --s)
+        {
+            for (int p = A; p <= B; ++p)
+            {
+                double* u = &u_[node(s, p) * cells_];
+                std::fill_n(u, cells_, 0.0);
+                for (int a = s == 0 ? 1 : s; a <= m_; ++a)
+                {
+                    // Challenge is action 0 and ends the round at bid s
+                    const auto action = static_cast<std::size_t>(a == s ? 0 : a);
+                    const double* child = a == s ? &terminal_[node(s, p) * cells_] : &u_[node(a, 1 - p) * cells_];
+                    if (p == B)
+                    {
+                        for (std::size_t hb = 0; hb < n_[B]; ++hb) wb[hb] = sigma_[B][slot(B, s, hb) + action];
+                    }
+                    for (std::size_t ha = 0; ha < n_[A]; ++ha)
+                    {
+                        double* row = u + ha * n_[B];
+                        const double* childRow = child + ha * n_[B];
+                        if (p == A)
+                        {
+                            // CFR+ strategies are sparse
+                            const double w = sigma_[A][slot(A, s, ha) + action];
+                            if (w <= 0.0) continue;
+                            for (std::size_t hb = 0; hb < n_[B]; ++hb) row[hb] += w * childRow[hb];
+                        }
+                        else
+                        {
+                            for (std::size_t hb = 0; hb < n_[B]; ++hb) row[hb] += wb[hb] * childRow[hb];
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    void updateRegrets(double t)
+    {
+        std::vector<double> q(actions_);
+        std::vector<double> w;
+        for (int s = 0; s <= m_; ++s)
+        {
+            for (int p = A; p <= B; ++p)
+            {
+                const int o = 1 - p;
+                // Counterfactual weight of the hands of the opponent
+                w.resize(n_[o]);
+                double total = 0.0;
+                for (std::size_t h = 0; h < n_[o]; ++h)
+                {
+                    w[h] = hands_[o][h].probability * reach_[o][node(s, p) * n_[o] + h];
+                    total += w[h];
+                }
+                for (std::size_t h = 0; h < n_[p]; ++h)
+                {
+                    const auto k = slot(p, s, h);
+                    double v = 0.0;
+                    for (int a = s == 0 ? 1 : s; a <= m_; ++a)
+                    {
+                        const auto action = static_cast<std::size_t>(a == s ? 0 : a);
+                        const double* child = a == s ? &terminal_[node(s, p) * cells_] : &u_[node(a, o) * cells_];
+                        double sum = 0.0;
+                        if (p == A)
+                        {
+                            const double* row = child + h * n_[B];
+                            for (std::size_t hb = 0; hb < n_[B]; ++hb) sum += w[hb] * row[hb];
+                        }
+                        else
+                        {
+                            for (std::size_t ha = 0; ha < n_[A]; ++ha) sum += w[ha] * child[ha * n_[B] + h];
+                            // B wins when A doesn't
+                            sum = total - sum;
+                        }
+                        q[action] = hands_[p][h].probability * sum;
+                        v += sigma_[p][k + action] * q[action];
+                    }
+                    const double reach = reach_[p][node(s, p) * n_[p] + h];
+                    for (int a = s == 0 ? 1 : s; a <= m_; ++a)
+                    {
+                        const auto action = static_cast<std::size_t>(a == s ? 0 : a);
+                        auto& r = regret_[p][k + action];
+                        r = std::max(0.0, r + q[action] - v);
+                        average_[p][k + action] += t * reach * sigma_[p][k + action];
+                    }
+                }
+            }
+        }
+    }
+
+public:
+    Solver(int a, int b, const Values& values)
+      : dice_{a, b},
+        m_{maxScore(a + b)},
+        hands_{enumerateHands(a), enumerateHands(b)},
+        n_{hands_[A].size(), hands_[B].size()},
+        actions_{static_cast<std::size_t>(m_ + 1)},
+        cells_{n_[A] * n_[B]},
+        terminal_(node(m_ + 1, A) * cells_),
+        u_(terminal_.size()),
+        reach_{std::vector<double>(node(m_ + 1, A) * n_[A]), std::vector<double>(node(m_ + 1, A) * n_[B])},
+        regret_{std::vector<double>(slot(A, m_ + 1, 0)), std::vector<double>(slot(B, m_ + 1, 0))},
+        sigma_{regret_[A], regret_[B]},
+        average_{regret_[A], regret_[B]}
+    {
+        initTerminal(values);
+    }
+
+    void run(int iterations)
+    {
+        for (int t = 1; t <= iterations; ++t)
+        {
+            updateSigma();
+            forward();
+            backward();
+            // Linear averaging: later iterations weigh more
+            updateRegrets(t);
+        }
+        // Evaluate the average strategies
+        for (int p = A; p <= B; ++p)
+        {
+            regret_[p] = average_[p];
+        }
+        updateSigma();
+        backward();
+    }
+
+    // @return probability that the player starting the round wins
+    double value(int starter) const
+    {
+        double v = 0.0;
+        const double* u = &u_[node(0, starter) * cells_];
+        for (std::size_t ha = 0; ha < n_[A]; ++ha)
+        {
+            for (std::size_t hb = 0; hb < n_[B]; ++hb)
+            {
+                v += hands_[A][ha].probability * hands_[B][hb].probability * u[ha * n_[B] + hb];
+            }
+        }
+        return starter == A ? v : 1.0 - v;
+    }
+
+    // Entries of the player ordered by hand and bid score
+    std::vector<EndgameTable::Entry> entries(int p) const
+    {
+        std::vector<EndgameTable::Entry> out;
+        std::vector<std::pair<double, std::size_t>> policy;
+        for (std::size_t h = 0; h < n_[p]; ++h)
+        {
+            for (int s = 0; s <= m_; ++s)
+            {
+                const auto k = slot(p, s, h);
+                policy.clear();
+                for (auto a = static_cast<std::size_t>(s == 0 ? 1 : 0); a < actions_; ++a)
+                {
+                    if (a != 0 && a <= static_cast<std::size_t>(s)) continue;
+                    policy.emplace_back(sigma_[p][k + a], a);
+                }
+                std::stable_sort(policy.begin(), policy.end(),
+                                 [](const auto& l, const auto& r) { return l.first > r.first; });
+                policy.resize(std::min<std::size_t>(policy.size(), 4));
+                double sum = 0.0;
+                for (const auto& pa : policy) sum += pa.first;
+
+                EndgameTable::Entry e{};
+                int left = 255;
+                for (std::size_t i = 0; i < policy.size(); ++i)
+                {
+                    e.action[i] = static_cast<std::uint8_t>(policy[i].second);
+                    const int q = static_cast<int>(255.0 * policy[i].first / sum + 0.5);
+                    e.probability[i] = static_cast<std::uint8_t>(std::min(left, q));
+                    left -= e.probability[i];
+                }
+                // Rounding error goes to the most likely action
+                e.probability[0] = static_cast<std::uint8_t>(e.probability[0] + left);
+                out.push_back(e);
+            }
+        }
+        return out;
+    }
+};
+
+} // unnamed namespace
+
+int numHands(int n)
+{
+    return multisets(1, n);
+}
+
+int handIndex(const std::uint8_t* hand, int n)
+{
+    std::array<int, 7> counts{};
+    for (int i = 0; i < n; ++i) ++counts[hand[i]];
+    // Rank of the sorted dice among the non-decreasing sequences
+    int index = 0;
+    int prev = 1;
+    int i = 0;
+    for (int face = 1; face <= 6; ++face)
+    {
+        for (int c = 0; c < counts[static_cast<std::size_t>(face)]; ++c, ++i)
+        {
+            for (int v = prev; v < face; ++v) index += multisets(v, n - i - 1);
+            prev = face;
+        }
+    }
+    return index;
+}
+
+EndgameTable::EndgameTable(const std::string& path)
+  : size_{},
+    data_{},
+    header_{}
+{
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) throw std::runtime_error{"Can't open " + path};
+    struct stat st;
+    if (::fstat(fd, &st) != 0 || st.st_size < static_cast<off_t>(sizeof(Header)))
+    {
+        ::close(fd);
+        throw std::runtime_error{"Invalid endgame table " + path};
+    }
+    size_ = static_cast<std::size_t>(st.st_size);
+    void* data = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (data == MAP_FAILED) throw std::runtime_error{"Can't map " + path};
+    data_ = data;
+    header_ = static_cast<const Header*>(data_);
+
+    // Tables written before the checksums have no footer
+    std::size_t contentSize = 0;
+    try {
+        contentSize = checkedSize(static_cast<const char*>(data_), size_, false);
+    } catch (const std::runtime_error& e) {
+        ::munmap(data, size_);
+        throw std::runtime_error{"Invalid endgame table " + path + ": " + e.what()};
+    }
+
+    bool valid = contentSize >= sizeof(Header) &&
+                 std::memcmp(header_->magic, MAGIC, sizeof(MAGIC)) == 0 &&
+                 header_->entrySize == sizeof(Entry) &&
+                 header_->maxDice >= 1 && header_->maxDice <= static_cast<std::uint32_t>(MAX_DICE);
+    for (int i = 1; valid && i <= maxDice(); ++i)
+    {
+        for (int j = 1; valid && j <= maxDice(); ++j)
+        {
+            const auto entries = static_cast<std::uint64_t>(numHands(i)) * static_cast<std::uint64_t>(maxScore(i + j) + 1);
+            valid = header_->offset[i][j] + entries * sizeof(Entry) <= contentSize;
+        }
+    }
+    if (!valid)
+    {
+        ::munmap(const_cast<void*>(data_), size_);
+        throw std::runtime_error{"Invalid endgame table " + path};
+    }
+}
+
+EndgameTable::~EndgameTable()
+{
+    ::munmap(const_cast<void*>(data_), size_);
+}
+
+bool EndgameTable::covers(int dice, int opponentDice) const
+{
+    return dice >= 1 && dice <= maxDice() && opponentDice >= 1 && opponentDice <= maxDice();
+}
+
+float EndgameTable::value(int dice, int opponentDice) const
+{
+    return header_->value[dice][opponentDice];
+}
+
+const EndgameTable::Entry& EndgameTable::lookup(const std::uint8_t* hand, int dice, int opponentDice, const Bid& bid) const
+{
+    const auto index = static_cast<std::size_t>(handIndex(hand, dice) * (maxScore(dice + opponentDice) + 1) + bid.score());
+    const auto* entries = reinterpret_cast<const Entry*>(static_cast<const char*>(data_) + header_->offset[dice][opponentDice]);
+    return entries[index];
+}
+
+bool EndgameTable::covers(const sim::View& view) const
+{
+    int players = 0;
+    for (int i = 0; i < view.numPlayers; ++i)
+    {
+        if (view.diceLeft[i] > 0) ++players;
+    }
+    return players == 2 && covers(view.handSize, view.totalDice - view.handSize);
+}
+
+Bid EndgameTable::decide(const sim::View& view, sim::Rng& rng) const
+{
+    const int opponentDice = view.totalDice - view.handSize;
+    // A bid that can't be true
+    if (view.bid.score() > maxScore(view.totalDice)) return Bid{};
+
+    const auto& e = lookup(view.hand, view.handSize, opponentDice, view.bid);
+    auto r = static_cast<int>(rng() % 255);
+    std::size_t i = 0;
+    while (i < 3 && r >= e.probability[i])
+    {
+        r -= e.probability[i];
+        ++i;
+    }
+    return e.action[i] == 0 ? Bid{} : Bid::fromScore(e.action[i]);
+}
+
+Bid EndgameStrategy::decide(const sim::View& view, sim::Rng& rng) const
+{
+    return table_.covers(view) ? table_.decide(view, rng) : fallback_.decide(view, rng);
+}
+
+Values solveEndgames(const std::string& path, int maxDice, int iterations)
+{
+    if (maxDice < 1 || maxDice > MAX_ENDGAME_DICE) throw std::invalid_argument{"maxDice"};
+
+    Values values{};
+    std::vector<EndgameTable::Entry> entries[MAX_DICE + 1][MAX_DICE + 1];
+    // The loser of a round has fewer dice so the endgames with fewer dice
+    // in total are solved first
+    for (int total = 2; total <= 2 * maxDice; ++total)
+    {
+        for (int a = std::max(1, total - maxDice); a <= total - a; ++a)
+        {
+            const int b = total - a;
+            Solver solver{a, b, values};
+            solver.run(iterations);
+            values[std::size_t(a)][std::size_t(b)] = static_cast<float>(solver.value(0));
+            values[std::size_t(b)][std::size_t(a)] = static_cast<float>(solver.value(1));
+            entries[a][b] = solver.entries(0);
+            entries[b][a] = solver.entries(1);
+        }
+    }
+
+    EndgameTable::Header header{};
+    std::copy(MAGIC, MAGIC + sizeof(MAGIC), header.magic);
+    header.maxDice = static_cast<std::uint32_t>(maxDice);
+    header.entrySize = sizeof(EndgameTable::Entry);
+    std::uint64_t offset = sizeof(header);
+    for (int a = 1; a <= maxDice; ++a)
+    {
+        for (int b = 1; b <= maxDice; ++b)
+        {
+            header.value[a][b] = values[std::size_t(a)][std::size_t(b)];
+            header.offset[a][b] = offset;
+            offset += entries[a][b].size() * sizeof(EndgameTable::Entry);
+        }
+    }
+
+    AtomicFile f{path, true};
+    f.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    for (int a = 1; a <= maxDice; ++a)
+    {
+        for (int b = 1; b <= maxDice; ++b)
+        {
+            f.write(reinterpret_cast<const char*>(entries[a][b].data()),
+                    entries[a][b].size() * sizeof(EndgameTable::Entry));
+        }
+    }
+    f.commit();
+    return values;
+}
+
+} // namespace dice
@@ -0,0 +1,135 @@
+#pragma once
+
+#include "bid.hpp"
+#include "rules.hpp"
+#include "sim.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace dice {
+
+/// Largest number of dice per player the endgame solver handles in
+/// reasonable time
+constexpr int MAX_ENDGAME_DICE = 3;
+
+/// Policies for 1v1 endgames with few dice, solved offline with
+/// solveEndgames() and memory-mapped for play.
+///
+/// A policy is stored for every decision a player can face: own dice, the
+/// dice of the opponent, own hand and the current bid. The history before
+/// the current bid is not part of the state, which keeps the table small.
+/// Every entry holds the four most likely actions of the mixed strategy so
+/// a lookup is O(1).
+///
+/// File layout: Header followed by the entries of each (own dice, opponent
+/// dice) pair, ordered by hand index and bid score.
+class EndgameTable
+{
+public:
+    /// One decision: challenge (action 0) or the score of the bid to raise
+    /// to, and the probabilities of the actions in 1/255.
+    struct Entry
+    {
+        std::uint8_t action[4];
+        std::uint8_t probability[4];
+    };
+
+    /// Start of the file
+    struct Header
+    {
+        char magic[8];
+        std::uint32_t maxDice;
+        std::uint32_t entrySize;
+        /// Win probability of the player starting the round with i dice
+        /// against j dice
+        float value[MAX_DICE + 1][MAX_DICE + 1];
+        /// Offset of the entries of own dice i and opponent dice j from the
+        /// start of the file
+        std::uint64_t offset[MAX_DICE + 1][MAX_DICE + 1];
+    };
+
+    /// Map the table in memory
+    /// @param path [in] file written by solveEndgames
+    /// @throws std::runtime_error if the file can't be mapped or is not a
+    ///     valid table
+    explicit EndgameTable(const std::string& path);
+
+    /// Unmap the table
+    ~EndgameTable();
+
+    EndgameTable(EndgameTable&&) = delete;
+
+    /// @return largest number of dice per player in the table
+    int maxDice() const { return static_cast<int>(header_->maxDice); }
+
+    /// @return whether the decisions of a player with the given dice
+    ///     against the given dice are in the table
+    bool covers(int dice, int opponentDice) const;
+
+    /// @return probability that the player starting the round wins
+    float value(int dice, int opponentDice) const;
+
+    /// Look up the policy of the decision. Precondition: covers().
+    /// @param hand [in] own dice, any order
+    /// @param dice [in] number of own dice
+    /// @param opponentDice [in] number of dice of the opponent
+    /// @param bid [in] current bid, Bid{} when opening the round
+    /// @return the entry for the decision
+    const Entry& lookup(const std::uint8_t* hand, int dice, int opponentDice, const Bid& bid) const;
+
+    /// @return whether the view is a 1v1 position in the table
+    bool covers(const sim::View& view) const;
+
+    /// Sample the move from the policy. Precondition: covers(view).
+    /// @param view [in] the visible state of the game
+    /// @param rng [in,out] random numbers for the mixed strategy
+    /// @return bid to raise to or Bid{} to challenge the current bid
+    Bid decide(const sim::View& view, sim::Rng& rng) const;
+
+private:
+    std::size_t size_;
+    const void* data_;
+    const Header* header_;
+};
+
+/// Uses the endgame table in covered 1v1 positions and another strategy
+/// elsewhere
+class EndgameStrategy : public sim::IStrategy
+{
+    const EndgameTable& table_;
+    const sim::IStrategy& fallback_;
+public:
+    /// Construct EndgameStrategy
+    /// @param table [in] the solved endgames
+    /// @param fallback [in] strategy for the other positions
+    EndgameStrategy(const EndgameTable& table, const sim::IStrategy& fallback)
+      : table_{table},
+        fallback_{fallback}
+    {
+    }
+    const char* name() const override { return "endgame"; }
+    Bid decide(const sim::View& view, sim::Rng& rng) const override;
+};
+
+/// @return number of distinct hands of n dice
+int numHands(int n);
+
+/// @return index of the hand among the hands of the same size [0, numHands)
+int handIndex(const std::uint8_t* hand, int n);
+
+/// Solve the 1v1 endgames up to the given number of dice per player with
+/// counterfactual regret minimization (CFR+) and write the table. The
+/// endgames are solved from the fewest dice up, the values of the smaller
+/// endgames giving the payoffs of the larger ones.
+/// @param path [in] where to write the table
+/// @param maxDice [in] dice per player [1, MAX_ENDGAME_DICE]
+/// @param iterations [in] CFR iterations per endgame
+/// @return values of the endgames, see EndgameTable::value
+std::array<std::array<float, MAX_DICE + 1>, MAX_DICE + 1>
+solveEndgames(const std::string& path, int maxDice, int iterations);
+
+} // namespace dice
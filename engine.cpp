@@ -1,8 +1,17 @@
 #include "engine.hpp"
 
+#include "bots.hpp"
+#include "endgame.hpp"
 #include "game.hpp"
 #include "helpers.hpp"
 #include "json.hpp"
+#include "msgpack.hpp"
+#include "playerid.hpp"
+#include "replication.hpp"
+#include "request.hpp"
+#include "rng.hpp"
+#include "threadpool.hpp"
+#include "timerwheel.hpp"
 #include <rapidjson/document.h>
 
 #include <rapidjson/reader.h>
@@ -11,7 +20,19 @@
 #include <rapidjson/filewritestream.h>
 #include <rapidjson/error/en.h>
 
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <exception>
+#include <set>
+#include <system_error>
+#include <thread>
 #include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
 using namespace rapidjson;
@@ -24,23 +45,87 @@ public:
     LogicError(const std::string& what) : std::runtime_error{what} {}
 };
 
+namespace {
+
+// Responses are built as json and transcoded for the other formats. Apart
+// from status, which is written directly, the responses are tiny.
+std::string reply(const std::string& json, Format format)
+{
+    return format == Format::MSGPACK ? msgpack::fromJson(json) : json;
+}
+
+// Games per thread when loading, fewer are not worth starting a thread for
+constexpr std::size_t MIN_GAMES_PER_THREAD = 2000;
+
+} // unnamed namespace
+
 class Engine::Impl
 {
+    using Clock = std::chrono::steady_clock;
+
     const std::string filename_;
     // id - player
-    std::map<std::string, std::string> players_;
+    std::unordered_map<PlayerId, std::string> players_;
     // Id -> Game name
-    std::unordered_map<std::string, std::string> joinedGames_;
+    std::unordered_map<PlayerId, std::string> joinedGames_;
     std::map<std::string, std::unique_ptr<Game>> games_;
+    // Source of dice seeds for new games if they are to be reproducible
+    std::unique_ptr<Xoshiro256> seeder_;
+
+    // Expiry of idle players and empty games. Time is in seconds (ticks)
+    // since the engine was created.
+    const Clock::time_point epoch_;
+    std::uint64_t now_;
+    std::uint64_t playerTtl_;
+    std::uint64_t gameTtl_;
+    // id -> tick when the player was last seen
+    mutable std::unordered_map<PlayerId, std::uint64_t> lastSeen_;
+    TimerWheel<PlayerId> playerTimers_;
+    TimerWheel<std::string> gameTimers_;
+    std::uint64_t expiredPlayers_;
+    std::uint64_t expiredGames_;
+
+    // Bot name -> id. The bots are players too but are not expired.
+    std::unordered_map<std::string, PlayerId> bots_;
+    std::uint64_t nextBot_;
+    BotConfig botConfig_;
+    std::shared_ptr<const EndgameTable> endgame_;
+    Xoshiro256 botRng_;
+    // Games where a bot got the turn and the hash of the game then
+    std::vector<std::pair<std::string, int>> botTurns_;
+    std::uint64_t botMoves_;
+    std::uint64_t lateBotMoves_;
+    // Set by the changes of a primary, the bots of a follower don't move
+    // until promoted
+    bool following_;
+
+    // Players and games changed since the last takeChanges(), collected
+    // only while replicating
+    bool replicating_;
+    std::unordered_set<PlayerId> changedPlayers_;
+    std::set<std::string> changedGames_;
+
+    // Process writing the background snapshot, 0 if none
+    pid_t snapshotPid_;
+    Clock::time_point snapshotStart_;
+    std::uint64_t snapshots_;
+    std::uint64_t failedSnapshots_;
+    // Duration of the last completed snapshot
+    std::uint64_t snapshotMicros_;
+    // Time the engine was locked for forking
+    std::uint64_t snapshotPauseMicros_;
+    std::uint64_t maxSnapshotPauseMicros_;
 
-    // Get the game and player for the given doc["id"] or
+    // Get the game and player for the given request id or
     // thow an error if anything fails.
-    auto getGamePlayer(const rapidjson::Value& doc) const
+    auto getGamePlayer(const Request& req) const
     {
-        const std::string id = json::getString(doc, "id");
+        req.require(Request::ID);
+        const auto id = PlayerId::fromString(req.id);
 
         const auto pit = players_.find(id);
         if (pit == players_.end()) throw LogicError{"NO_PLAYER"};
+        touch(id);
 
         const auto jit = joinedGames_.find(id);
         if (jit == joinedGames_.end()) throw LogicError{"NOT_JOINED"};
@@ -51,27 +136,65 @@ class Engine::Impl
         return std::make_pair(git->second.get(), pit->second);
     }
 
-    // Get the player for the given doc["id"]
-    const auto& getPlayer(const std::string& id) const
+    // Run one operation of a batch for the given player
+    std::string batchOp(const std::string& id, const rapidjson::Value& op)
     {
-        const auto it = players_.find(id);
-        if (it == players_.end()) throw LogicError{"NO_PLAYER"};
-        return it->second;
+        try {
+            Request req;
+            req.id = id;
+            req.fields = Request::ID;
+            auto getInt = [&op, &req](const char* key, int& value, Request::Field field)
+            {
+                if (op.IsObject() && op.HasMember(key) && op[key].IsInt())
+                {
+                    value = op[key].GetInt();
+                    req.fields |= field;
+                }
+            };
+            getInt("n", req.n, Request::N);
+            getInt("face", req.face, Request::FACE);
+            getInt("hash", req.hash, Request::HASH);
+
+            const std::string name = json::getString(op, "op");
+            if (name == "bid") return bid(req);
+            if (name == "challenge") return challenge(req);
+            if (name == "startRound") return startRound(req);
+            if (name == "status") return status(req, Format::JSON);
+            return Error{"UNKNOWN_OP"};
+        } catch (const std::exception& e) {
+            return Error{e.what()};
+        }
     }
 
-    std::string getId(const std::string& name) const
+    template<typename Writer>
+    void writeStatus(Writer& w, const PlayerId& id, const Game* game) const
     {
-        for (auto kv : players_)
+        json::Object(w, [this, &id, game](auto& w)
         {
-            if (kv.second == name)
+            const std::string name = getPlayer(id);
+
+            json::KeyValue(w, "success", true);
+            json::KeyValue(w, "id", id.str());
+            json::KeyValue(w, "name", name);
+
+            if (game)
             {
-                return kv.first;
+                w.Key("game");
+                game->serialize(w, name);
             }
-        }
-        return "";
+        });
     }
 
-    const Game* getJoinedGame(const std::string& id) const
+    // Get the player for the given doc["id"]
+    const auto& getPlayer(const PlayerId& id) const
+    {
+        const auto it = players_.find(id);
+        if (it == players_.end()) throw LogicError{"NO_PLAYER"};
+        touch(id);
+        return it->second;
+    }
+
+    const Game* getJoinedGame(const PlayerId& id) const
     {
         const auto jit = joinedGames_.find(id);
         if (jit != joinedGames_.end())
@@ -83,48 +206,228 @@ class Engine::Impl
         return nullptr;
     }
 
+    std::uint64_t nextSeed()
+    {
+        return seeder_ ? (*seeder_)() : threadRng()();
+    }
+
+    // Start tracking when the player was last seen
+    void track(const PlayerId& id)
+    {
+        lastSeen_[id] = now_;
+        playerTimers_.schedule(id, now_ + playerTtl_);
+    }
+
+    // Mark the player as seen now
+    void touch(const PlayerId& id) const
+    {
+        const auto it = lastSeen_.find(id);
+        if (it != lastSeen_.end()) it->second = now_;
+    }
+
+    // Mark the player as changed for the followers
+    void changed(const PlayerId& id)
+    {
+        if (replicating_) changedPlayers_.insert(id);
+    }
+
+    // Mark the game as changed for the followers
+    void changed(const std::string& game)
+    {
+        if (replicating_) changedGames_.insert(game);
+    }
+
+    // Log the player out of the joined game, if any
+    void leave(const PlayerId& id)
+    {
+        const auto jit = joinedGames_.find(id);
+        if (jit == joinedGames_.end()) return;
+        const auto git = games_.find(jit->second);
+        assert(git != games_.end());
+        auto& game = *git->second;
+        game.logout(players_.at(id));
+        changed(id);
+        changed(git->first);
+        joinedGames_.erase(jit);
+        if (onlyBots(game)) removeBots(game);
+        if (game.players().empty())
+        {
+            gameTimers_.schedule(git->first, now_ + gameTtl_);
+        }
+        else
+        {
+            checkBotTurn(game);
+        }
+    }
+
+    bool isBot(const std::string& name) const
+    {
+        return hasItem(bots_, name);
+    }
+
+    bool onlyBots(const Game& game) const
+    {
+        for (const auto& p : game.players())
+        {
+            if (!isBot(p.name())) return false;
+        }
+        return true;
+    }
+
+    // Remove the bots from the game and the engine
+    void removeBots(Game& game)
+    {
+        std::vector<std::string> names;
+        for (const auto& p : game.players()) names.push_back(p.name());
+        for (const auto& name : names)
+        {
+            const auto it = bots_.find(name);
+            if (it == bots_.end()) continue;
+            game.logout(name);
+            changed(it->second);
+            joinedGames_.erase(it->second);
+            players_.erase(it->second);
+            bots_.erase(it);
+        }
+    }
+
+    // Queue a move if a bot has the turn
+    void checkBotTurn(const Game& game)
+    {
+        if (bots_.empty() || !game.roundStarted()) return;
+        const auto turn = static_cast<std::size_t>(game.turn());
+        if (turn < game.players().size() && isBot(game.players()[turn].name()))
+        {
+            botTurns_.emplace_back(game.name(), game.hash());
+        }
+    }
+
+    void expirePlayer(const PlayerId& id)
+    {
+        const auto it = lastSeen_.find(id);
+        if (it == lastSeen_.end()) return;
+        const auto due = it->second + playerTtl_;
+        if (due > now_)
+        {
+            // Seen after the timer was set
+            playerTimers_.schedule(id, due);
+            return;
+        }
+        leave(id);
+        players_.erase(id);
+        lastSeen_.erase(it);
+        changed(id);
+        ++expiredPlayers_;
+    }
+
+    void expireGame(const std::string& game)
+    {
+        const auto it = games_.find(game);
+        // Someone may have joined in the meanwhile
+        if (it != games_.end() && it->second->players().empty())
+        {
+            changed(it->first);
+            games_.erase(it);
+            ++expiredGames_;
+        }
+    }
+
 public:
     Impl(const std::string& filename)
       : filename_{filename},
-        players_{}
+        players_{},
+        joinedGames_{},
+        games_{},
+        seeder_{},
+        epoch_{Clock::now()},
+        now_{},
+        playerTtl_{60 * 60},
+        gameTtl_{5 * 60},
+        lastSeen_{},
+        playerTimers_{},
+        gameTimers_{},
+        expiredPlayers_{},
+        expiredGames_{},
+        bots_{},
+        nextBot_{},
+        botConfig_{},
+        endgame_{},
+        botRng_{threadRng()()},
+        botTurns_{},
+        botMoves_{},
+        lateBotMoves_{},
+        following_{},
+        replicating_{},
+        changedPlayers_{},
+        changedGames_{},
+        snapshotPid_{},
+        snapshotStart_{},
+        snapshots_{},
+        failedSnapshots_{},
+        snapshotMicros_{},
+        snapshotPauseMicros_{},
+        maxSnapshotPauseMicros_{}
     {
         load();
     }
 
-    std::string login(const std::string& body)
+    ~Impl()
+    {
+        reapSnapshot(true);
+    }
+
+    std::string login(const Request& req)
     {
-        const auto name = json::getString(parse(body), "name");
-        if (hasValue(players_, name)) return Error{"PLAYER_EXISTS"};
-        const auto id = uuid();
-        const auto ret = players_.insert({id, name});
-        assert(ret.second);
+        req.require(Request::NAME);
+        // An empty name would see all the dice in the status
+        if (req.name.empty()) return Error{"INVALID_NAME"};
+        const auto name = req.name.to_string();
+        // Only shard logins have the id, the shard router picks them so that
+        // a player can follow their games to other shards. Logging in again
+        // with the same id and name is not an error.
+        const auto id = req.has(Request::ID) ? PlayerId::fromString(req.id) : PlayerId::generate();
+        if (id.nil()) return Error{"INVALID_ID"};
+        const auto pit = players_.find(id);
+        if (pit != players_.end() && pit->second == name)
+        {
+            touch(id);
+        }
+        else
+        {
+            if (pit != players_.end() || hasValue(players_, name)) return Error{"PLAYER_EXISTS"};
+            players_.insert({id, name});
+            track(id);
+            changed(id);
+        }
         return json::Json(
         {
             {"success", true},
-            {"id", id}
+            {"id", id.str()}
         });
     }
 
-    std::string createGame(const std::string& body)
+    std::string createGame(const Request& req)
     {
-        const auto doc = parse(body);
-        const std::string id = json::getString(doc, "id");
-        const std::string game = json::getString(doc, "game");
+        req.require(Request::ID | Request::GAME);
+        const auto id = PlayerId::fromString(req.id);
+        const std::string game = req.game.to_string();
 
         const auto name = getPlayer(id);
         if (hasItem(joinedGames_, id)) return Error{"ALREADY_JOINED"};
         if (hasItem(games_, game)) return Error{"GAME_EXISTS"};
 
         joinedGames_.insert({id, game});
-        games_.emplace(game, std::make_unique<Game>(game, name));
+        games_.emplace(game, std::make_unique<Game>(game, name, nextSeed()));
+        changed(id);
+        changed(game);
         return Success{};
     }
 
-    std::string joinGame(const std::string& body)
+    std::string joinGame(const Request& req)
     {
-        const auto doc = parse(body);
-        const std::string id = json::getString(doc, "id");
-        const std::string game = json::getString(doc, "game");
+        req.require(Request::ID | Request::GAME);
+        const auto id = PlayerId::fromString(req.id);
+        const std::string game = req.game.to_string();
 
         const auto name = getPlayer(id);
 
@@ -134,79 +437,241 @@ public:
         if (git == games_.end()) return Error{"NO_GAME"};
 
         const auto rv = git->second->addPlayer(name);
-        if (rv) joinedGames_.insert({id, game});
+        if (!rv) return rv;
+        joinedGames_.insert({id, game});
+        changed(id);
+        changed(game);
         return rv;
     }
 
-    std::string startGame(const std::string& body)
+    std::string startGame(const Request& req)
     {
-        const auto gp = getGamePlayer(parse(body));
+        const auto gp = getGamePlayer(req);
 
         // Start game and round
         const auto rv = gp.first->startGame();
-        return rv ? gp.first->startRound().str() : rv.str();
+        if (!rv) return rv;
+        const auto round = gp.first->startRound();
+        changed(gp.first->name());
+        if (round) checkBotTurn(*gp.first);
+        return round;
     }
 
-    std::string startRound(const std::string& body)
+    std::string startRound(const Request& req)
     {
-        const auto gp = getGamePlayer(parse(body));
-        return gp.first->startRound();
+        const auto gp = getGamePlayer(req);
+        const auto rv = gp.first->startRound();
+        if (!rv) return rv;
+        changed(gp.first->name());
+        checkBotTurn(*gp.first);
+        return rv;
     }
 
-    std::string bid(const std::string& body)
+    std::string bid(const Request& req)
     {
-        auto doc = parse(body);
-        auto gp = getGamePlayer(doc);
-        return gp.first->bid(gp.second,
-            json::getInt(doc, "n"),
-            json::getInt(doc, "face"));
+        auto gp = getGamePlayer(req);
+        req.require(Request::N | Request::FACE);
+        const auto rv = gp.first->bid(gp.second, req.n, req.face);
+        // A failed move doesn't change the turn, checking it would queue
+        // the move of the bot again
+        if (!rv) return rv;
+        changed(gp.first->name());
+        checkBotTurn(*gp.first);
+        return rv;
     }
 
-    std::string challenge(const std::string& body)
+    std::string challenge(const Request& req)
     {
-        auto gp = getGamePlayer(parse(body));
-        return gp.first->challenge(gp.second);
+        auto gp = getGamePlayer(req);
+        const auto rv = gp.first->challenge(gp.second);
+        if (rv) changed(gp.first->name());
+        return rv;
+    }
+
+    std::string addBot(const Request& req)
+    {
+        const auto gp = getGamePlayer(req);
+        std::string name;
+        do {
+            name = "bot-" + std::to_string(++nextBot_);
+        } while (hasValue(players_, name));
+
+        const auto rv = gp.first->addPlayer(name);
+        if (!rv) return rv;
+        const auto id = PlayerId::generate();
+        players_.emplace(id, name);
+        joinedGames_.emplace(id, gp.first->name());
+        bots_.emplace(name, id);
+        changed(id);
+        changed(gp.first->name());
+        checkBotTurn(*gp.first);
+        return json::Json({
+            {"success", true},
+            {"name", name}
+        });
+    }
+
+    // A bot move decided with the engine unlocked
+    struct BotTurn
+    {
+        BotPosition position;
+        sim::Rng rng;
+        // Kept alive if the bots are configured meanwhile
+        std::shared_ptr<const EndgameTable> endgame;
+        Clock::time_point deadline;
+    };
+
+    // Copy what the bot in turn sees unless the game has changed since the
+    // bot got the turn
+    // @return nullptr if there is no move to decide
+    std::unique_ptr<BotTurn> botTurn(const std::string& name, int hash, Clock::time_point due)
+    {
+        const auto* game = following_ ? nullptr : botGame(name, hash);
+        if (!game) return nullptr;
+        return std::make_unique<BotTurn>(BotTurn{
+            BotPosition{*game}, sim::Rng{botRng_()}, endgame_, due + botConfig_.budget});
+    }
+
+    // Make the move decided for the bot unless the game has changed while
+    // it was deciding. Whatever changed the game has queued the bot again if
+    // it still has the turn.
+    void botMove(const std::string& name, int hash, const Bid& move, Clock::time_point deadline)
+    {
+        auto* game = botGame(name, hash);
+        if (!game) return;
+        const auto bot = game->players()[static_cast<std::size_t>(game->turn())].name();
+        const auto rv = move == Bid{} ? game->challenge(bot) : game->bid(bot, move.n(), move.face());
+        if (!rv) return;
+        changed(name);
+        ++botMoves_;
+        if (Clock::now() > deadline) ++lateBotMoves_;
+        checkBotTurn(*game);
+    }
+
+    // @return the game if a bot still has the turn it got at the hash,
+    //     nullptr otherwise
+    Game* botGame(const std::string& name, int hash) const
+    {
+        const auto it = games_.find(name);
+        if (it == games_.end() || it->second->hash() != hash) return nullptr;
+        auto& game = *it->second;
+        if (!game.roundStarted()) return nullptr;
+        const auto turn = static_cast<std::size_t>(game.turn());
+        if (turn >= game.players().size() || !isBot(game.players()[turn].name())) return nullptr;
+        return &game;
+    }
+
+    // Queue the moves of the bots that have the turn, e.g., in the games
+    // received from the primary
+    void resumeBots()
+    {
+        following_ = false;
+        for (const auto& kv : games_) checkBotTurn(*kv.second);
+    }
+
+    // @return the games where a bot got the turn since the last call
+    std::vector<std::pair<std::string, int>> takeBotTurns()
+    {
+        std::vector<std::pair<std::string, int>> turns;
+        turns.swap(botTurns_);
+        return turns;
+    }
+
+    const BotConfig& botConfig() const { return botConfig_; }
+
+    void setBotConfig(const BotConfig& config)
+    {
+        botConfig_ = config;
+        endgame_.reset();
+        if (config.endgame.empty()) return;
+        try {
+            endgame_ = std::make_shared<const EndgameTable>(config.endgame);
+        } catch (const std::runtime_error&) {
+            // The bots play without the table
+        }
     }
 
-    std::string logout(const std::string& body)
+    std::string logout(const Request& req)
     {
-        auto gp = getGamePlayer(parse(body));
-        gp.first->logout(gp.second);
-        // @TODO optimization opportunity
-        joinedGames_.erase(json::getString(parse(body), "id"));
+        getGamePlayer(req);
+        leave(PlayerId::fromString(req.id));
         return Success{};
     }
 
-    std::string status(const std::string& body) const
+    std::string status(const Request& req, Format format) const
     {
-        const auto doc = dice::parse(body);
-        const std::string id = json::getString(doc, "id");
+        req.require(Request::ID);
+        const auto id = PlayerId::fromString(req.id);
         auto* game = getJoinedGame(id);
         if (game)
         {
-            const auto hash = json::getInt(doc, "hash", -1);
-            if (game->hash() == hash) return json::Json({
+            if (game->hash() == req.hash) return reply(json::Json({
                 {"success", true},
                 {"noChange", true}
-            });
+            }), format);
         }
 
+        if (format == Format::MSGPACK)
+        {
+            msgpack::Writer w;
+            writeStatus(w, id, game);
+            return w.str();
+        }
         rapidjson::StringBuffer s;
         rapidjson::PrettyWriter<rapidjson::StringBuffer> w{s};
+        writeStatus(w, id, game);
+        return s.GetString();
+    }
 
-        json::Object(w, [this, &id, game](auto& w)
+    std::string history(const Request& req, Format format) const
+    {
+        req.require(Request::ID);
+        const auto id = PlayerId::fromString(req.id);
+        getPlayer(id);
+        const auto* game = getJoinedGame(id);
+        if (!game) return reply(Error{"NOT_JOINED"}, format);
+        const auto since = static_cast<std::uint64_t>(std::max(req.since, 0));
+
+        const auto write = [game, since](auto& w)
         {
-            const std::string name = getPlayer(id);
+            json::Object(w, [game, since](auto& w)
+            {
+                json::KeyValue(w, "success", true);
+                w.Key("history");
+                game->serializeMoves(w, since);
+            });
+        };
+        if (format == Format::MSGPACK)
+        {
+            msgpack::Writer w;
+            write(w);
+            return w.str();
+        }
+        rapidjson::StringBuffer s;
+        rapidjson::PrettyWriter<rapidjson::StringBuffer> w{s};
+        write(w);
+        return s.GetString();
+    }
 
-            json::KeyValue(w, "success", true);
-            json::KeyValue(w, "id", id);
-            json::KeyValue(w, "name", name);
+    std::string batch(const std::string& body, Format format)
+    {
+        const auto doc = parse(format == Format::MSGPACK ? msgpack::toJson(body) : body);
+        const std::string id = json::getString(doc, "id");
+        const auto ops = json::getArray(doc, "ops");
 
-            if (game)
+        rapidjson::StringBuffer s;
+        rapidjson::PrettyWriter<rapidjson::StringBuffer> w{s};
+        json::Object(w, [&](auto& w)
+        {
+            json::KeyValue(w, "success", true);
+            json::ArrayW(w, "results", [&](auto& w)
             {
-                w.Key("game");
-                game->serialize(w, name);
-            }
+                for (const auto& op : ops)
+                {
+                    const auto result = batchOp(id, op);
+                    w.RawValue(result.c_str(), result.size(), rapidjson::kObjectType);
+                }
+            });
         });
         return s.GetString();
     }
@@ -226,186 +691,720 @@ public:
         return s.GetString();
     }
 
-    void save()
+    // Serialize the player as in the saved state
+    template<typename Writer>
+    void writePlayer(Writer& w, const PlayerId& id) const
+    {
+        json::Object(w, [&](auto& w)
+        {
+            const auto& name = players_.at(id);
+            json::KeyValue(w, "id", id.str());
+            json::KeyValue(w, "name", name);
+            if (isBot(name)) json::KeyValue(w, "bot", true);
+
+            const auto it = joinedGames_.find(id);
+            if (it != joinedGames_.end())
+            {
+                json::KeyValue(w, "game", it->second);
+            }
+        });
+    }
+
+    // The whole state as json
+    std::string state() const
     {
         rapidjson::StringBuffer s;
         rapidjson::PrettyWriter<rapidjson::StringBuffer> w{s};
 
         json::Object(w, [=](auto& w)
         {
-            json::ArrayW(w, "players", [=](auto& w)
+            // Sorted by id so that the file doesn't change without changes
+            std::vector<PlayerId> ids;
+            ids.reserve(players_.size());
+            for (const auto& kv : players_) ids.push_back(kv.first);
+            std::sort(ids.begin(), ids.end());
+
+            json::ArrayW(w, "players", [&](auto& w)
             {
-                for (const auto& kv : players_)
+                for (const auto& id : ids) writePlayer(w, id);
+            });
+            json::ArrayW(w, "games", [=](auto& w){
+                for (const auto& it : games_)
                 {
-                    const auto id = kv.first;
-                    json::Object(w, [=](auto& w)
+                    it.second->serializeState(w);
+                }
+            });
+        });
+        return s.GetString();
+    }
+
+    void save()
+    {
+        dumpChecked(filename_, state());
+    }
+
+    // Fork a process that saves the copy-on-write image of the state. The
+    // engine is only paused for copying the page tables.
+    bool saveInBackground()
+    {
+        reapSnapshot(false);
+        if (snapshotPid_ > 0) return false;
+
+        const auto start = Clock::now();
+        const auto pid = ::fork();
+        if (pid < 0)
+        {
+            ++failedSnapshots_;
+            return false;
+        }
+        if (pid == 0)
+        {
+            // Only this thread exists in the child and nothing else changes
+            // the state. Exit without the destructors and atexit handlers
+            // of the parent.
+            int rc = 0;
+            try {
+                dumpChecked(filename_, state());
+            } catch (const std::exception&) {
+                rc = 1;
+            }
+            ::_exit(rc);
+        }
+        snapshotPid_ = pid;
+        snapshotStart_ = start;
+        snapshotPauseMicros_ = micros(Clock::now() - start);
+        maxSnapshotPauseMicros_ = std::max(maxSnapshotPauseMicros_, snapshotPauseMicros_);
+        return true;
+    }
+
+    // Collect the snapshot process if it has exited
+    // @param wait [in] whether to wait for it
+    void reapSnapshot(bool wait)
+    {
+        if (snapshotPid_ <= 0) return;
+        int status = 0;
+        const auto pid = ::waitpid(snapshotPid_, &status, wait ? 0 : WNOHANG);
+        if (pid == 0) return;
+        if (pid == snapshotPid_ && WIFEXITED(status) && WEXITSTATUS(status) == 0)
+        {
+            ++snapshots_;
+            snapshotMicros_ = micros(Clock::now() - snapshotStart_);
+        }
+        else
+        {
+            ++failedSnapshots_;
+        }
+        snapshotPid_ = 0;
+    }
+
+    static std::uint64_t micros(Clock::duration d)
+    {
+        return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(d).count());
+    }
+
+    void setReplicating(bool replicating)
+    {
+        replicating_ = replicating;
+        changedPlayers_.clear();
+        changedGames_.clear();
+    }
+
+    // @return the players and games changed since the last call in the
+    // format of the saved state, the removed ones with "removed": true, or
+    // an empty string if nothing has changed
+    std::string takeChanges()
+    {
+        if (changedPlayers_.empty() && changedGames_.empty()) return {};
+        rapidjson::StringBuffer s;
+        rapidjson::PrettyWriter<rapidjson::StringBuffer> w{s};
+        json::Object(w, [this](auto& w)
+        {
+            json::ArrayW(w, "players", [this](auto& w)
+            {
+                for (const auto& id : changedPlayers_)
+                {
+                    if (hasItem(players_, id))
                     {
-                        json::KeyValue(w, "id", id);
-                        json::KeyValue(w, "name", kv.second);
-
-                        const auto it = joinedGames_.find(id);
-                        if (it != joinedGames_.end())
-                        {
-                            json::KeyValue(w, "game", it->second);
-                        }
+                        writePlayer(w, id);
+                        continue;
+                    }
+                    json::Object(w, [&id](auto& w)
+                    {
+                        json::KeyValue(w, "id", id.str());
+                        json::KeyValue(w, "removed", true);
                     });
                 }
             });
-            json::ArrayW(w, "games", [=](auto& w){
-                for (const auto& it : games_)
+            json::ArrayW(w, "games", [this](auto& w)
+            {
+                for (const auto& name : changedGames_)
                 {
-                    it.second->serialize(w, "");
+                    const auto it = games_.find(name);
+                    if (it != games_.end())
+                    {
+                        it->second->serializeState(w);
+                        continue;
+                    }
+                    json::Object(w, [&name](auto& w)
+                    {
+                        json::KeyValue(w, "game", name);
+                        json::KeyValue(w, "removed", true);
+                    });
                 }
             });
         });
+        changedPlayers_.clear();
+        changedGames_.clear();
+        return s.GetString();
+    }
 
-        dump(filename_, s.GetString());
+    // Apply the changes of the primary, see takeChanges. A snapshot, i.e.,
+    // the whole state, replaces the state.
+    void apply(const std::string& entry, bool snapshot)
+    {
+        following_ = true;
+        const auto doc = parse(entry);
+        const auto players = json::getArray(doc, "players");
+        const auto games = json::getArray(doc, "games");
+        if (snapshot)
+        {
+            for (const auto& kv : players_) changed(kv.first);
+            for (const auto& kv : games_) changed(kv.first);
+            players_.clear();
+            joinedGames_.clear();
+            games_.clear();
+            bots_.clear();
+            lastSeen_.clear();
+        }
+        for (const auto& p : players)
+        {
+            const auto id = PlayerId::fromString(json::getString(p, "id"));
+            if (id.nil()) continue;
+            changed(id);
+            const auto it = players_.find(id);
+            if (p.HasMember("removed"))
+            {
+                if (it != players_.end())
+                {
+                    bots_.erase(it->second);
+                    players_.erase(it);
+                }
+                joinedGames_.erase(id);
+                lastSeen_.erase(id);
+                continue;
+            }
+            if (it == players_.end())
+            {
+                const auto ret = players_.emplace(id, json::getString(p, "name"));
+                if (p.HasMember("bot") && p["bot"].IsTrue()) bots_.emplace(ret.first->second, id);
+                else track(id);
+            }
+            if (p.HasMember("game")) joinedGames_[id] = json::getString(p, "game");
+            else joinedGames_.erase(id);
+        }
+        for (const auto& g : games)
+        {
+            const std::string name = json::getString(g, "game");
+            changed(name);
+            if (g.HasMember("removed"))
+            {
+                games_.erase(name);
+                continue;
+            }
+            auto game = Game::fromJson(g);
+            if (game->players().empty()) gameTimers_.schedule(name, now_ + gameTtl_);
+            games_[name] = std::move(game);
+        }
+    }
+
+    void seedGames(std::uint64_t seed)
+    {
+        seeder_ = std::make_unique<Xoshiro256>(seed);
+    }
+
+    void setTimeouts(std::chrono::seconds playerTtl, std::chrono::seconds gameTtl)
+    {
+        // Pending timers fire at their old time and are then rescheduled
+        // according to the new timeouts
+        playerTtl_ = static_cast<std::uint64_t>(playerTtl.count());
+        gameTtl_ = static_cast<std::uint64_t>(gameTtl.count());
+    }
+
+    void expire(Clock::time_point now)
+    {
+        const auto tick = now > epoch_ ?
+            static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::seconds>(now - epoch_).count()) : 0;
+        if (tick <= now_) return;
+        now_ = tick;
+        playerTimers_.advance(now_, [this](const PlayerId& id) { expirePlayer(id); });
+        gameTimers_.advance(now_, [this](const std::string& game) { expireGame(game); });
+    }
+
+    std::string metrics() const
+    {
+        return json::Json({
+            {"players", static_cast<int>(players_.size())},
+            {"games", static_cast<int>(games_.size())},
+            {"expiredPlayers", static_cast<int>(expiredPlayers_)},
+            {"expiredGames", static_cast<int>(expiredGames_)},
+            {"bots", static_cast<int>(bots_.size())},
+            {"botMoves", static_cast<int>(botMoves_)},
+            {"lateBotMoves", static_cast<int>(lateBotMoves_)},
+            {"snapshots", static_cast<int>(snapshots_)},
+            {"failedSnapshots", static_cast<int>(failedSnapshots_)},
+            {"snapshotUs", static_cast<int>(snapshotMicros_)},
+            {"snapshotPauseUs", static_cast<int>(snapshotPauseMicros_)},
+            {"maxSnapshotPauseUs", static_cast<int>(maxSnapshotPauseMicros_)}
+        });
     }
 
 private:
     void readPlayers(const rapidjson::Document& doc)
     {
-        for (const auto& p : json::getArray(doc, "players"))
+        const auto jplayers = json::getArray(doc, "players");
+        players_.reserve(jplayers.Size());
+        for (const auto& p : jplayers)
         {
             try {
-                players_.emplace(json::getString(p, "id"),
-                                 json::getString(p, "name"));
+                const auto id = PlayerId::fromString(json::getString(p, "id"));
+                if (id.nil()) continue;
+                const auto ret = players_.emplace(id, json::getString(p, "name"));
+                if (!ret.second) continue;
+                if (p.HasMember("bot") && p["bot"].IsTrue()) bots_.emplace(ret.first->second, id);
+                else track(id);
             } catch (const std::exception&) {}
         }
     }
 
+    // A game constructed by a loader thread with the ids of its players,
+    // nil for unknown players
+    struct LoadedGame
+    {
+        std::unique_ptr<Game> game;
+        std::vector<PlayerId> ids;
+        std::exception_ptr error;
+    };
+
     void readGames(const rapidjson::Document& doc)
     {
-        for (const auto& jgame : json::getArray(doc, "games"))
+        const auto jgames = json::getArray(doc, "games");
+        const auto n = static_cast<std::size_t>(jgames.Size());
+
+        // Players by name, read concurrently by the loader threads
+        std::unordered_map<std::string, PlayerId> ids;
+        ids.reserve(players_.size());
+        for (const auto& kv : players_) ids.emplace(kv.second, kv.first);
+
+        // The games are constructed in parallel, the engine state is only
+        // changed when merging them below
+        std::vector<LoadedGame> loaded(n);
+        const auto construct = [&](std::size_t begin, std::size_t end)
         {
-            try {
-                auto game = Game::fromJson(jgame);
-                for (const auto& player : game->players())
-                {
-                    const auto id = getId(player.name());
-                    if (id.empty())
-                    {
-                        game->removePlayer(player);
-                    }
-                    else
+            for (auto i = begin; i < end; ++i)
+            {
+                auto& l = loaded[i];
+                try {
+                    l.game = Game::fromJson(jgames[static_cast<rapidjson::SizeType>(i)]);
+                    l.ids.reserve(l.game->players().size());
+                    for (const auto& player : l.game->players())
                     {
-                        if (!joinedGames_.emplace(id, game->name()).second)
-                        {
-                            game->removePlayer(player);
-                        }
+                        const auto it = ids.find(player.name());
+                        l.ids.push_back(it != ids.end() ? it->second : PlayerId{});
                     }
+                } catch (const json::ParseError&) {
+                    // Format error in one game shouldn't prevent parsing the others
+                    l.game.reset();
+                } catch (...) {
+                    l.error = std::current_exception();
                 }
-                if (!game->players().empty())
-                    games_.emplace(game->name(), std::move(game));
-            } catch (const json::ParseError&) {
-                // Format error in one game shouldn't prevent parsing the others
             }
+        };
+        const auto threads = std::min<std::size_t>(
+            std::max(1u, std::thread::hardware_concurrency()), 1 + n / MIN_GAMES_PER_THREAD);
+        if (threads == 1)
+        {
+            construct(0, n);
+        }
+        else
+        {
+            ThreadPool pool{static_cast<unsigned>(threads)};
+            TaskGroup group{pool};
+            const auto chunk = (n + threads - 1) / threads;
+            for (std::size_t begin = 0; begin < n; begin += chunk)
+            {
+                group.run([&construct, begin, end = std::min(n, begin + chunk)] { construct(begin, end); });
+            }
+            group.wait();
+        }
+
+        // In the order of the file so that a player in several games stays
+        // in the first one
+        for (auto& l : loaded)
+        {
+            if (l.error) std::rethrow_exception(l.error);
+            if (!l.game) continue;
+            auto& game = l.game;
+            std::vector<bool> drop(l.ids.size());
+            for (std::size_t i = 0; i < l.ids.size(); ++i)
+            {
+                drop[i] = l.ids[i].nil() || !joinedGames_.emplace(l.ids[i], game->name()).second;
+            }
+            // Backwards, removing a player moves the ones after it
+            for (auto i = drop.size(); i-- > 0;)
+            {
+                if (drop[i]) game->removePlayer(game->players()[i]);
+            }
+            if (!game->players().empty())
+                games_.emplace(game->name(), std::move(game));
         }
     }
     void load() noexcept
     {
-        auto doc = parse(slurp(filename_));
+        if (filename_.empty() || ::access(filename_.c_str(), F_OK) != 0) return;
         try {
+            // Files saved before the checksums are accepted, they fail to
+            // parse if truncated
+            const auto doc = parse(slurpChecked(filename_, false));
+            if (doc.HasParseError()) throw json::ParseError{};
             readPlayers(doc);
             readGames(doc);
         }
-        catch (const std::exception&) {}
+        catch (const std::exception&) {
+            // Start empty but keep the damaged file for recovery instead of
+            // overwriting it with the next save
+            players_.clear();
+            joinedGames_.clear();
+            games_.clear();
+            bots_.clear();
+            lastSeen_.clear();
+            std::rename(filename_.c_str(), (filename_ + ".corrupt").c_str());
+        }
     }
 };
 
 Engine::Engine(const std::string& filename) noexcept
-    : impl_{std::make_unique<Impl>(filename)}
+    : mutex_{},
+      impl_{std::make_unique<Impl>(filename)},
+      replicator_{},
+      bots_{}
 {
+    // The bots that had the turn when the state was saved
+    std::lock_guard<std::mutex> lock{mutex_};
+    impl_->resumeBots();
+    scheduleBots();
 }
 
 Engine::~Engine() noexcept = default;
 
-std::string Engine::login(const std::string& body) noexcept
+std::string Engine::login(const std::string& body, Format format) noexcept
 {
+    std::lock_guard<std::mutex> lock{mutex_};
     try {
-        return impl_->login(body);
+        impl_->expire(std::chrono::steady_clock::now());
+        auto r = reply(impl_->login(decodeRequest<Request::LOGIN>(body, format)), format);
+        publish();
+        return r;
     } catch (const std::exception& e) {
-        return Error{e.what()};
+        return reply(Error{e.what()}, format);
     }
 }
 
-std::string Engine::createGame(const std::string& body) noexcept
+std::string Engine::shardLogin(const std::string& body, Format format) noexcept
 {
+    std::lock_guard<std::mutex> lock{mutex_};
     try {
-        return impl_->createGame(body);
+        impl_->expire(std::chrono::steady_clock::now());
+        auto r = reply(impl_->login(decodeRequest<Request::SHARD_LOGIN>(body, format)), format);
+        publish();
+        return r;
     } catch (const std::exception& e) {
-        return Error{e.what()};
+        return reply(Error{e.what()}, format);
     }
 }
 
-std::string Engine::joinGame(const std::string& body) noexcept
+std::string Engine::createGame(const std::string& body, Format format) noexcept
 {
+    std::lock_guard<std::mutex> lock{mutex_};
     try {
-        return impl_->joinGame(body);
+        impl_->expire(std::chrono::steady_clock::now());
+        auto r = reply(impl_->createGame(decodeRequest<Request::JOIN>(body, format)), format);
+        publish();
+        return r;
     } catch (const std::exception& e) {
-        return Error{e.what()};
+        return reply(Error{e.what()}, format);
     }
 }
 
-std::string Engine::startGame(const std::string& body) noexcept
+std::string Engine::joinGame(const std::string& body, Format format) noexcept
 {
+    std::lock_guard<std::mutex> lock{mutex_};
     try {
-        return impl_->startGame(body);
+        impl_->expire(std::chrono::steady_clock::now());
+        auto r = reply(impl_->joinGame(decodeRequest<Request::JOIN>(body, format)), format);
+        publish();
+        return r;
+    } catch (const std::exception& e) {
+        return reply(Error{e.what()}, format);
+    }
+}
+
+std::string Engine::startGame(const std::string& body, Format format) noexcept
+{
+    std::lock_guard<std::mutex> lock{mutex_};
+    try {
+        impl_->expire(std::chrono::steady_clock::now());
+        auto r = reply(impl_->startGame(decodeRequest<Request::PLAYER>(body, format)), format);
+        publish();
+        scheduleBots();
+        return r;
     } catch (const std::runtime_error& e) {
-        return Error{e.what()};
+        return reply(Error{e.what()}, format);
     }
 }
 
-std::string Engine::startRound(const std::string& body) noexcept
+std::string Engine::startRound(const std::string& body, Format format) noexcept
 {
+    std::lock_guard<std::mutex> lock{mutex_};
     try {
-        return impl_->startRound(body);
+        impl_->expire(std::chrono::steady_clock::now());
+        auto r = reply(impl_->startRound(decodeRequest<Request::PLAYER>(body, format)), format);
+        publish();
+        scheduleBots();
+        return r;
     } catch (const std::exception& e) {
-        return Error{e.what()};
+        return reply(Error{e.what()}, format);
     }
 }
 
-std::string Engine::bid(const std::string& body) noexcept
+std::string Engine::bid(const std::string& body, Format format) noexcept
 {
+    std::lock_guard<std::mutex> lock{mutex_};
     try {
-        return impl_->bid(body);
+        impl_->expire(std::chrono::steady_clock::now());
+        auto r = reply(impl_->bid(decodeRequest<Request::BID>(body, format)), format);
+        publish();
+        scheduleBots();
+        return r;
     } catch (const std::exception& e) {
-        return Error{e.what()};
+        return reply(Error{e.what()}, format);
     }
 }
 
-std::string Engine::challenge(const std::string& body) noexcept
+std::string Engine::challenge(const std::string& body, Format format) noexcept
 {
+    std::lock_guard<std::mutex> lock{mutex_};
     try {
-        return impl_->challenge(body);
+        impl_->expire(std::chrono::steady_clock::now());
+        auto r = reply(impl_->challenge(decodeRequest<Request::PLAYER>(body, format)), format);
+        publish();
+        scheduleBots();
+        return r;
     } catch (const std::exception& e) {
-        return Error{e.what()};
+        return reply(Error{e.what()}, format);
     }
 }
 
-std::string Engine::logout(const std::string& body) noexcept try {
-    return impl_->logout(body);
+std::string Engine::addBot(const std::string& body, Format format) noexcept
+{
+    std::lock_guard<std::mutex> lock{mutex_};
+    try {
+        impl_->expire(std::chrono::steady_clock::now());
+        auto r = reply(impl_->addBot(decodeRequest<Request::PLAYER>(body, format)), format);
+        publish();
+        scheduleBots();
+        return r;
+    } catch (const std::exception& e) {
+        return reply(Error{e.what()}, format);
+    }
+}
+
+std::string Engine::logout(const std::string& body, Format format) noexcept try {
+    std::lock_guard<std::mutex> lock{mutex_};
+    impl_->expire(std::chrono::steady_clock::now());
+    auto r = reply(impl_->logout(decodeRequest<Request::PLAYER>(body, format)), format);
+    publish();
+    scheduleBots();
+    return r;
 } catch (const std::exception& e) {
-    return Error{e.what()};
+    return reply(Error{e.what()}, format);
+}
+
+std::string Engine::status(const std::string& body, Format format) const noexcept
+{
+    std::lock_guard<std::mutex> lock{mutex_};
+    try {
+        impl_->expire(std::chrono::steady_clock::now());
+        return impl_->status(decodeRequest<Request::STATUS>(body, format), format);
+    } catch (const std::exception& e) {
+        return reply(Error{e.what()}, format);
+    }
+}
+
+std::string Engine::history(const std::string& body, Format format) const noexcept
+{
+    std::lock_guard<std::mutex> lock{mutex_};
+    try {
+        impl_->expire(std::chrono::steady_clock::now());
+        return impl_->history(decodeRequest<Request::HISTORY>(body, format), format);
+    } catch (const std::exception& e) {
+        return reply(Error{e.what()}, format);
+    }
 }
 
-std::string Engine::status(const std::string& body) const noexcept
+std::string Engine::batch(const std::string& body, Format format) noexcept
 {
+    std::lock_guard<std::mutex> lock{mutex_};
     try {
-        return impl_->status(body);
+        impl_->expire(std::chrono::steady_clock::now());
+        auto r = reply(impl_->batch(body, format), format);
+        publish();
+        scheduleBots();
+        return r;
     } catch (const std::exception& e) {
-        return Error{e.what()};
+        return reply(Error{e.what()}, format);
     }
 }
 
 std::string Engine::getGames() const noexcept
 {
+    std::lock_guard<std::mutex> lock{mutex_};
+    impl_->expire(std::chrono::steady_clock::now());
     return impl_->getGames();
 }
 
-void Engine::save() noexcept
+bool Engine::save() noexcept
+{
+    std::lock_guard<std::mutex> lock{mutex_};
+    try {
+        impl_->save();
+        return true;
+    } catch (const std::exception&) {
+        return false;
+    }
+}
+
+bool Engine::saveInBackground() noexcept
+{
+    std::lock_guard<std::mutex> lock{mutex_};
+    return impl_->saveInBackground();
+}
+
+void Engine::seedGames(std::uint64_t seed) noexcept
 {
-    impl_->save();
+    std::lock_guard<std::mutex> lock{mutex_};
+    impl_->seedGames(seed);
+}
+
+void Engine::setTimeouts(std::chrono::seconds playerTtl, std::chrono::seconds gameTtl) noexcept
+{
+    std::lock_guard<std::mutex> lock{mutex_};
+    impl_->setTimeouts(playerTtl, gameTtl);
+}
+
+void Engine::expire(std::chrono::steady_clock::time_point now) noexcept
+{
+    std::lock_guard<std::mutex> lock{mutex_};
+    impl_->expire(now);
+    publish();
+    scheduleBots();
+}
+
+void Engine::setBotConfig(const BotConfig& config) noexcept
+{
+    std::lock_guard<std::mutex> lock{mutex_};
+    impl_->setBotConfig(config);
+}
+
+std::string Engine::metrics() const noexcept
+{
+    std::lock_guard<std::mutex> lock{mutex_};
+    impl_->reapSnapshot(false);
+    return impl_->metrics();
+}
+
+void Engine::setReplicator(Replicator* replicator) noexcept
+{
+    std::lock_guard<std::mutex> lock{mutex_};
+    replicator_ = replicator;
+    impl_->setReplicating(replicator != nullptr);
+}
+
+void Engine::snapshot(const std::function<void(std::string)>& f)
+{
+    std::lock_guard<std::mutex> lock{mutex_};
+    // The pending changes go to the followers that have the older state
+    publish();
+    f(impl_->state());
+}
+
+bool Engine::restore(const std::string& snapshot) noexcept
+{
+    std::lock_guard<std::mutex> lock{mutex_};
+    try {
+        impl_->apply(snapshot, true);
+        publish();
+        return true;
+    } catch (const std::exception&) {
+        return false;
+    }
+}
+
+bool Engine::apply(const std::string& entry) noexcept
+{
+    std::lock_guard<std::mutex> lock{mutex_};
+    try {
+        impl_->apply(entry, false);
+        publish();
+        return true;
+    } catch (const std::exception&) {
+        return false;
+    }
+}
+
+void Engine::promote() noexcept
+{
+    std::lock_guard<std::mutex> lock{mutex_};
+    impl_->resumeBots();
+    scheduleBots();
+}
+
+void Engine::publish()
+{
+    if (!replicator_) return;
+    auto entry = impl_->takeChanges();
+    if (!entry.empty()) replicator_->push(std::move(entry));
+}
+
+void Engine::scheduleBots()
+{
+    const auto turns = impl_->takeBotTurns();
+    if (turns.empty()) return;
+    const auto& config = impl_->botConfig();
+    try {
+        if (!bots_) bots_ = std::make_unique<BotScheduler>(config.threads);
+        const auto due = std::chrono::steady_clock::now() + config.delay;
+        for (const auto& turn : turns)
+        {
+            bots_->schedule(due, [this, turn, due]
+            {
+                // The move is searched with the engine unlocked so that the
+                // requests are served meanwhile
+                std::unique_ptr<Impl::BotTurn> bot;
+                {
+                    std::lock_guard<std::mutex> lock{mutex_};
+                    bot = impl_->botTurn(turn.first, turn.second, due);
+                }
+                if (!bot) return;
+                const auto move = decideBotMove(bot->position, bot->rng, bot->deadline, bot->endgame.get());
+                std::lock_guard<std::mutex> lock{mutex_};
+                impl_->botMove(turn.first, turn.second, move, bot->deadline);
+                publish();
+                scheduleBots();
+            });
+        }
+    } catch (const std::system_error&) {
+        // No threads for the bots, they won't move
+    }
 }
 
 } // namespace dice
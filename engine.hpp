@@ -1,10 +1,22 @@
 #pragma once
+#include "request.hpp" // Format
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
 #include <memory>
+#include <mutex>
 #include <utility>
 #include <string>
 
 namespace dice {
 
+struct BotConfig;
+class BotScheduler;
+class Replicator;
+
+/// Game engine serving the API. The calls are serialized with a mutex so
+/// the engine can be used from several threads.
 class Engine
 {
 public:
@@ -14,58 +26,184 @@ public:
     /// Destructor
     ~Engine() noexcept;
 
-    /// Create a new user account
+    /// Create a new user account with a generated id
     /// @param body [in] json containing required input
+    /// @param format [in] encoding of body and the returned value
     /// @return json indicating success of failure
-    std::string login(const std::string& body) noexcept;
+    std::string login(const std::string& body, Format format = Format::JSON) noexcept;
+
+    /// Create a new user account with the id in the body, which the shard
+    /// Router picks so that players can move between shards. Logging in
+    /// again with the same id and name is not an error. Only served to the
+    /// Router by serveShard, never on the public API.
+    /// @param body [in] json containing required input
+    /// @param format [in] encoding of body and the returned value
+    /// @return json indicating success of failure
+    std::string shardLogin(const std::string& body, Format format = Format::JSON) noexcept;
 
     /// Create a new game
     /// @param body [in] json containing required input
+    /// @param format [in] encoding of body and the returned value
     /// @return json indicating success of failure
-    std::string createGame(const std::string& body) noexcept;
+    std::string createGame(const std::string& body, Format format = Format::JSON) noexcept;
 
     /// Join an existing game
     /// @param body [in] json containing required input
+    /// @param format [in] encoding of body and the returned value
     /// @return json indicating success of failure
-    std::string joinGame(const std::string& body) noexcept;
+    std::string joinGame(const std::string& body, Format format = Format::JSON) noexcept;
 
     /// Start the game you have joined
     /// @param body [in] json containing required input
+    /// @param format [in] encoding of body and the returned value
     /// @return json indicating success of failure
-    std::string startGame(const std::string& body) noexcept;
+    std::string startGame(const std::string& body, Format format = Format::JSON) noexcept;
 
     /// Start a round of the game you have joined
     /// @param body [in] json containing required input
+    /// @param format [in] encoding of body and the returned value
     /// @return json indicating success of failure
-    std::string startRound(const std::string& body) noexcept;
+    std::string startRound(const std::string& body, Format format = Format::JSON) noexcept;
 
     /// Bid for a round in game you've joined
     /// @param body [in] json containing required input
+    /// @param format [in] encoding of body and the returned value
     /// @return json indicating success of failure
-    std::string bid(const std::string& body) noexcept;
+    std::string bid(const std::string& body, Format format = Format::JSON) noexcept;
 
     /// Challenge a bid in round of game you've joined
     /// @param body [in] json containing required input
+    /// @param format [in] encoding of body and the returned value
     /// @return json indicating success of failure
-    std::string challenge(const std::string& body) noexcept;
+    std::string challenge(const std::string& body, Format format = Format::JSON) noexcept;
 
-    std::string logout(const std::string& body) noexcept;
+    /// Add a bot to the game you have joined. The bot joins the game like a
+    /// player and makes its move automatically when it gets the turn. Bots
+    /// leave when the last player has left.
+    /// @param body [in] json containing required input
+    /// @param format [in] encoding of body and the returned value
+    /// @return json with the name of the bot or error
+    std::string addBot(const std::string& body, Format format = Format::JSON) noexcept;
+
+    /// Leave the game you have joined
+    /// @param body [in] json containing required input
+    /// @param format [in] encoding of body and the returned value
+    /// @return json indicating success of failure
+    std::string logout(const std::string& body, Format format = Format::JSON) noexcept;
 
     /// Get status for a player
     /// @param body [in] json containing required input
+    /// @param format [in] encoding of body and the returned value
     /// @return json indicating success of failure
-    std::string status(const std::string& body) const noexcept;
+    std::string status(const std::string& body, Format format = Format::JSON) const noexcept;
+
+    /// Get the moves of the game the player has joined. The log is saved
+    /// and replicated with the game, so it survives restarts and failovers,
+    /// but only the last MoveLog::MAX_MOVES moves are kept. Games saved
+    /// without the log, or loaded from older files, are not "complete" and
+    /// cannot be replayed.
+    /// @param body [in] json with the id of the player and optionally
+    ///     "since", the number of the first move to return
+    /// @param format [in] encoding of body and the returned value
+    /// @return json with the moves in "history" or error
+    std::string history(const std::string& body, Format format = Format::JSON) const noexcept;
+
+    /// Run several operations of the player in order so that no other
+    /// request is served in between, e.g., bid and then get the status.
+    /// @param body [in] json like {"id": id, "ops": [{"op": "bid", "n": 3,
+    ///     "face": 2}, {"op": "status", "hash": 5}]}. The operations are
+    ///     bid, challenge, startRound and status and they take the same
+    ///     fields as the corresponding calls.
+    /// @param format [in] encoding of body and the returned value
+    /// @return json with the result of every operation in "results". All
+    ///     the operations are run even if some of them fail.
+    std::string batch(const std::string& body, Format format = Format::JSON) noexcept;
 
     /// Get current games and players
     /// @return json containing list of games and players or error
     std::string getGames() const noexcept;
 
-    /// Save state to the file given in constructor
-    void save() noexcept;
-    
+    /// Save state to the file given in constructor. The file is replaced
+    /// atomically and has a checksum that is verified on load. A damaged
+    /// file is not loaded but renamed with the suffix .corrupt.
+    /// @return false if the file could not be written
+    bool save() noexcept;
+
+    /// Save state to the file given in constructor in a forked process
+    /// without blocking the calls for longer than the fork takes. The
+    /// child writes the copy-on-write image of the state at the time of
+    /// the call.
+    /// @return false if the previous snapshot is still being written or
+    ///     the process could not be forked
+    bool saveInBackground() noexcept;
+
+    /// Derive the dice seeds of new games from the given seed instead of
+    /// random seeds. Makes load tests reproducible.
+    /// @param seed [in] master seed
+    void seedGames(std::uint64_t seed) noexcept;
+
+    /// Set how long players may be idle and games may stay empty before
+    /// they are removed. Idle players are logged out of their game. The
+    /// defaults are one hour for players and five minutes for games.
+    /// @param playerTtl [in] time since the player's last request
+    /// @param gameTtl [in] time since the last player left the game
+    void setTimeouts(std::chrono::seconds playerTtl, std::chrono::seconds gameTtl) noexcept;
+
+    /// Remove idle players and empty games as of the given time. This is
+    /// done automatically with the current time on every request.
+    /// @param now [in] current time
+    void expire(std::chrono::steady_clock::time_point now) noexcept;
+
+    /// Configure the bots. Affects the moves scheduled after the call.
+    /// @param config [in] the configuration
+    void setBotConfig(const BotConfig& config) noexcept;
+
+    /// @return json with the number of players and games, how many of them
+    ///     have been removed because of expiry, the bot moves, and the
+    ///     background snapshots with the duration of the last one and the
+    ///     pause of the calls for forking
+    std::string metrics() const noexcept;
+
+    /// Send the changes of every call to the replicator. Called by
+    /// Replicator.
+    /// @param replicator [in] where to send the changes, nullptr to stop
+    void setReplicator(Replicator* replicator) noexcept;
+
+    /// Call f with the whole state for a new follower. The engine is locked
+    /// during the call so that the changes after the snapshot are sent
+    /// after it.
+    /// @param f [in] receives the state as json
+    void snapshot(const std::function<void(std::string)>& f);
+
+    /// Replace the state with a snapshot of the primary
+    /// @param snapshot [in] state from snapshot()
+    /// @return false if the snapshot is invalid
+    bool restore(const std::string& snapshot) noexcept;
+
+    /// Apply the changes of one call on the primary
+    /// @param entry [in] changes sent to the Replicator
+    /// @return false if the entry is invalid
+    bool apply(const std::string& entry) noexcept;
+
+    /// Take over after following a primary: the bots that have the turn
+    /// make their moves
+    void promote() noexcept;
+
 private:
     class Impl;
+    mutable std::mutex mutex_;
     std::unique_ptr<Impl> impl_;
+    Replicator* replicator_;
+    // Destroyed first so that no bot move is running when impl_ goes away
+    std::unique_ptr<BotScheduler> bots_;
+
+    // Schedule the moves of the bots that got the turn. Called with the
+    // mutex locked.
+    void scheduleBots();
+
+    // Send the changes to the replicator, if any. Called with the mutex
+    // locked.
+    void publish();
 };
 
 } // namespace dice
@@ -1,11 +1,101 @@
 #include "filehelpers.hpp"
 
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <array>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
 #include <fstream>
 #include <memory>
+#include <stdexcept>
 #include <unordered_map>
 
 namespace dice {
 
+namespace {
+
+// Footer appended by AtomicFile: "\n#crc32 1a2b3c4d 1234\n" with the CRC-32
+// in hex and the size of the content in decimal
+constexpr char FOOTER[] = "\n#crc32 ";
+constexpr std::size_t FOOTER_PREFIX = sizeof(FOOTER) - 1;
+constexpr std::size_t MAX_FOOTER = 48;
+
+std::runtime_error systemError(const std::string& what, const std::string& path)
+{
+    return std::runtime_error{what + " " + path + ": " + std::strerror(errno)};
+}
+
+std::string directory(const std::string& path)
+{
+    const auto slash = path.find_last_of('/');
+    if (slash == std::string::npos) return ".";
+    if (slash == 0) return "/";
+    return path.substr(0, slash);
+}
+
+void syncDirectory(const std::string& path)
+{
+    const auto dir = directory(path);
+    const int fd = ::open(dir.c_str(), O_RDONLY | O_DIRECTORY);
+    if (fd < 0) throw systemError("Can't open", dir);
+    const auto rc = ::fsync(fd);
+    ::close(fd);
+    if (rc != 0) throw systemError("Can't sync", dir);
+}
+
+// Parse the footer at the end of the data
+// @param start [out] where the footer starts
+// @return false if there is no footer
+bool parseFooter(const char* data, std::size_t size, std::size_t& start,
+                 std::uint32_t& crc, std::uint64_t& length)
+{
+    if (size < FOOTER_PREFIX + 1 || data[size - 1] != '\n') return false;
+    const auto limit = size > MAX_FOOTER ? size - MAX_FOOTER : 0;
+    std::size_t nl = size - 1;
+    while (nl > limit && data[nl - 1] != '\n') --nl;
+    if (nl == 0 || data[nl - 1] != '\n') return false;
+    start = nl - 1;
+    if (size - start < FOOTER_PREFIX || std::memcmp(data + start, FOOTER, FOOTER_PREFIX) != 0)
+        return false;
+
+    const std::string line{data + start + FOOTER_PREFIX, size - 1 - start - FOOTER_PREFIX};
+    std::size_t pos = 0;
+    try {
+        crc = static_cast<std::uint32_t>(std::stoul(line, &pos, 16));
+        if (pos != 8 || line.size() < 10 || line[8] != ' ') return false;
+        length = std::stoull(line.substr(9), &pos, 10);
+        return pos == line.size() - 9;
+    } catch (const std::logic_error&) {
+        return false;
+    }
+}
+
+} // unnamed namespace
+
+std::uint32_t crc32(const char* data, std::size_t size, std::uint32_t crc)
+{
+    static const auto table = []
+    {
+        std::array<std::uint32_t, 256> t{};
+        for (std::uint32_t i = 0; i < 256; ++i)
+        {
+            auto c = i;
+            for (int k = 0; k < 8; ++k) c = (c & 1) ? 0xedb88320u ^ (c >> 1) : c >> 1;
+            t[i] = c;
+        }
+        return t;
+    }();
+    crc = ~crc;
+    for (std::size_t i = 0; i < size; ++i)
+    {
+        crc = table[(crc ^ static_cast<std::uint8_t>(data[i])) & 0xffu] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
 std::string slurp(const std::string& path)
 {
     std::ifstream f{path, std::ios::binary | std::ios::ate};
@@ -22,8 +112,112 @@ std::string slurp(const std::string& path)
 
 void dump(const std::string& path, const std::string& data)
 {
-    std::ofstream f{path, std::ios::binary};
-    f.write(data.data(), std::streamsize(data.size()));
+    AtomicFile f{path, false};
+    f.write(data.data(), data.size());
+    f.commit();
+}
+
+void dumpChecked(const std::string& path, const std::string& data)
+{
+    AtomicFile f{path, true};
+    f.write(data.data(), data.size());
+    f.commit();
+}
+
+std::string slurpChecked(const std::string& path, bool required)
+{
+    auto data = slurp(path);
+    if (data.empty() && !required) return data;
+    try {
+        data.resize(checkedSize(data.data(), data.size(), required));
+    } catch (const std::runtime_error& e) {
+        throw std::runtime_error{path + ": " + e.what()};
+    }
+    return data;
+}
+
+std::size_t checkedSize(const char* data, std::size_t size, bool required)
+{
+    std::size_t start = 0;
+    std::uint32_t crc = 0;
+    std::uint64_t length = 0;
+    if (!parseFooter(data, size, start, crc, length))
+    {
+        if (required) throw std::runtime_error{"Missing checksum"};
+        return size;
+    }
+    if (length != start) throw std::runtime_error{"Size mismatch"};
+    if (crc32(data, start) != crc) throw std::runtime_error{"Checksum mismatch"};
+    return start;
+}
+
+AtomicFile::AtomicFile(const std::string& path, bool checksum)
+  : path_{path},
+    tmp_{path + ".tmpXXXXXX"},
+    fd_{-1},
+    checksum_{checksum},
+    crc_{0},
+    size_{0}
+{
+    fd_ = ::mkstemp(&tmp_[0]);
+    if (fd_ < 0) throw systemError("Can't create", tmp_);
+    // mkstemp creates the file private, keep the mode of the file replaced
+    struct stat st;
+    const auto mode = ::stat(path_.c_str(), &st) == 0 ? st.st_mode & 07777 : 0644;
+    ::fchmod(fd_, mode);
+}
+
+AtomicFile::~AtomicFile()
+{
+    if (fd_ >= 0)
+    {
+        ::close(fd_);
+        ::unlink(tmp_.c_str());
+    }
+}
+
+void AtomicFile::write(const char* data, std::size_t size)
+{
+    if (checksum_) crc_ = crc32(data, size, crc_);
+    size_ += size;
+    while (size > 0)
+    {
+        const auto n = ::write(fd_, data, size);
+        if (n < 0)
+        {
+            if (errno == EINTR) continue;
+            throw systemError("Can't write", tmp_);
+        }
+        data += n;
+        size -= static_cast<std::size_t>(n);
+    }
+}
+
+void AtomicFile::commit()
+{
+    if (checksum_)
+    {
+        char footer[MAX_FOOTER];
+        const auto n = std::snprintf(footer, sizeof(footer), "%s%08x %llu\n", FOOTER,
+                                     crc_, static_cast<unsigned long long>(size_));
+        checksum_ = false;
+        write(footer, static_cast<std::size_t>(n));
+    }
+    if (::fsync(fd_) != 0) throw systemError("Can't sync", tmp_);
+    if (::close(fd_) != 0)
+    {
+        fd_ = -1;
+        ::unlink(tmp_.c_str());
+        throw systemError("Can't close", tmp_);
+    }
+    fd_ = -1;
+    if (::rename(tmp_.c_str(), path_.c_str()) != 0)
+    {
+        const auto e = systemError("Can't rename", tmp_);
+        ::unlink(tmp_.c_str());
+        throw e;
+    }
+    syncDirectory(path_);
 }
 
 std::string getExtension(const std::string& path)
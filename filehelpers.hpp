@@ -1,11 +1,82 @@
 #pragma once
+#include <cstddef>
+#include <cstdint>
 #include <string>
 
 namespace dice {
 std::string slurp(const std::string& path);
 
+/// Replace the file atomically and durably, see AtomicFile
+/// @param path [in] file to replace
+/// @param data [in] the new content
+/// @throws std::runtime_error if the file cannot be written
 void dump(const std::string& path, const std::string& data);
 
+/// Like dump but with a checksum footer that slurpChecked verifies
+/// @param path [in] file to replace
+/// @param data [in] the new content
+/// @throws std::runtime_error if the file cannot be written
+void dumpChecked(const std::string& path, const std::string& data);
+
+/// Read a file written with dumpChecked or AtomicFile with a checksum
+/// @param path [in] file to read
+/// @param required [in] whether a file without the footer is an error. If
+///     not, the content of such a file is returned as it is, so files
+///     written before the checksums can still be read.
+/// @return the content without the footer, empty if the file is missing
+///     and the checksum is not required
+/// @throws std::runtime_error if the checksum or the size does not match
+std::string slurpChecked(const std::string& path, bool required = true);
+
+/// Verify the checksum footer of data in memory, e.g., a mapped file
+/// @param data [in] content of the file
+/// @param size [in] size of the file
+/// @param required [in] as in slurpChecked
+/// @return size of the content without the footer
+/// @throws std::runtime_error if the checksum or the size does not match
+std::size_t checkedSize(const char* data, std::size_t size, bool required = true);
+
+/// @return CRC-32 (IEEE) of the data continuing from crc
+std::uint32_t crc32(const char* data, std::size_t size, std::uint32_t crc = 0);
+
+/// Writes a file so that a crash at any point leaves either the old or the
+/// new content in place. The data goes to a temporary file next to the
+/// target that is synced and renamed over the target on commit, after which
+/// the directory is synced for the rename to survive a power loss.
+/// Optionally a footer with the CRC-32 and size of the content is appended
+/// for detecting files damaged after they have been written.
+class AtomicFile
+{
+    const std::string path_;
+    std::string tmp_;
+    int fd_;
+    bool checksum_;
+    std::uint32_t crc_;
+    std::uint64_t size_;
+public:
+    /// Create the temporary file
+    /// @param path [in] file to replace on commit
+    /// @param checksum [in] whether to append the checksum footer
+    /// @throws std::runtime_error if the file cannot be created
+    AtomicFile(const std::string& path, bool checksum);
+
+    /// Remove the temporary file unless committed
+    ~AtomicFile();
+
+    AtomicFile(AtomicFile&&) = delete;
+
+    /// Append to the temporary file
+    /// @param data [in] bytes to write
+    /// @param size [in] number of bytes
+    /// @throws std::runtime_error if the write fails
+    void write(const char* data, std::size_t size);
+
+    /// Replace the target with the temporary file
+    /// @throws std::runtime_error if syncing or renaming fails, the target
+    ///     is left as it was
+    void commit();
+};
+
 std::string getExtension(const std::string& path);
 
 std::string getContentType(const std::string& path);
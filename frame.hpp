@@ -0,0 +1,48 @@
+#pragma once
+
+#include <boost/asio.hpp>
+
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace dice {
+
+/// Messages between the processes over stream sockets are frames of a
+/// uint32 length in host byte order followed by the payload. Larger frames
+/// are a protocol error rather than a message.
+constexpr std::uint32_t MAX_FRAME = 1u << 30;
+
+/// Write one frame
+/// @param socket [in,out] connected stream socket
+/// @param payload [in] the message
+/// @throws boost::system::system_error if the write fails
+template<typename Socket>
+void writeFrame(Socket& socket, const std::string& payload)
+{
+    const auto length = static_cast<std::uint32_t>(payload.size());
+    const std::vector<boost::asio::const_buffer> buffers{
+        boost::asio::buffer(&length, sizeof(length)),
+        boost::asio::buffer(payload)
+    };
+    boost::asio::write(socket, buffers);
+}
+
+/// Read one frame
+/// @param socket [in,out] connected stream socket
+/// @return the message
+/// @throws boost::system::system_error if the read fails
+/// @throws std::runtime_error if the frame is too large
+template<typename Socket>
+std::string readFrame(Socket& socket)
+{
+    std::uint32_t length = 0;
+    boost::asio::read(socket, boost::asio::buffer(&length, sizeof(length)));
+    if (length > MAX_FRAME) throw std::runtime_error("FRAME_TOO_LARGE");
+    std::string payload(length, '\0');
+    if (length > 0) boost::asio::read(socket, boost::asio::buffer(&payload[0], length));
+    return payload;
+}
+
+} // namespace dice
@@ -1,11 +1,47 @@
 #include "game.hpp"
 
 #include "dice.hpp"
+#include "msgpack.hpp"
+#include "rules.hpp"
 
 #include <algorithm>
+#include <array>
 
 namespace dice {
 
+namespace {
+
+// Read the log written by Game::serializeState
+MoveLog readLog(const rapidjson::Value& v)
+{
+    using namespace json;
+    MoveLog log{getValue(v, "complete").IsTrue(), getUint64(v, "first")};
+    for (const auto& n : getArray(v, "names"))
+    {
+        if (!n.IsString()) throw ParseError{};
+        log.intern(n.GetString());
+    }
+    const auto names = static_cast<int>(log.names().size());
+    const auto moves = getArray(v, "moves");
+    if (moves.Size() % 4 != 0) throw ParseError{};
+    for (rapidjson::SizeType i = 0; i < moves.Size(); i += 4)
+    {
+        const auto type = getInt(moves[i]);
+        const auto player = getInt(moves[i + 1]);
+        const auto value = getInt(moves[i + 2]);
+        const auto face = getInt(moves[i + 3]);
+        if (type < 0 || type > Move::RESULT || face < 0 || face > 6) throw ParseError{};
+        // The moves of the game itself have no player
+        const bool named = type != Move::START_GAME && type != Move::START_ROUND && type != Move::ROLL;
+        if (named ? player < 0 || player >= names : player != 0) throw ParseError{};
+        log.push(Move{static_cast<Move::Type>(type), static_cast<std::uint8_t>(face),
+                      static_cast<std::uint16_t>(player), value});
+    }
+    return log;
+}
+
+} // unnamed namespace
+
 int Game::getOffset() const
 {
     std::vector<int> commonHand;
@@ -42,11 +78,7 @@ std::tuple<int, bool, bool> Game::getResult(int offset, const Player& player) co
 {
     //std::cout << player.name() << " ";
     //std::cout << &player << " " << bidder_ << " " << challenger() << std::endl;
-    if (&player == bidder_)
-        return std::make_tuple(offset < 0 ? offset : 0, offset >= 0, offset < 0);
-    if (&player == challenger())
-        return std::make_tuple(offset >= 0 ? std::min(-1, -offset) : 0, offset < 0, offset >= 0);
-    return std::make_tuple(offset == 0 ? -1 : 0, false, false);
+    return roundResult(offset, &player == bidder_, &player == challenger());
 }
 
 void Game::setTurn(const Player& player)
@@ -69,22 +101,34 @@ Game::Game(const std::string& game)
     players_{},
     turn_{0},
     currentBid_{},
-    diceRoll_{Dice::instance()},
+    dice_{threadRng()()},
     state_{GAME_NOT_STARTED},
-    hash_{}
+    hash_{},
+    bidder_{nullptr},
+    challenger_{nullptr},
+    moves_{}
 {
 }
 
 Game::Game(const std::string& game, const std::string& player)
+  : Game{game, player, threadRng()()}
+{
+}
+
+Game::Game(const std::string& game, const std::string& player, std::uint64_t seed)
   : game_{game},
     players_{},
     turn_{0},
     currentBid_{},
-    diceRoll_{Dice::instance()},
+    dice_{seed},
     state_{GAME_NOT_STARTED},
-    hash_{}
+    hash_{},
+    bidder_{nullptr},
+    challenger_{nullptr},
+    moves_{}
 {
     players_.emplace_back(player);
+    log(Move::CREATE, player);
 }
 
 RetVal Game::addPlayer(const std::string& player)
@@ -93,9 +137,10 @@ RetVal Game::addPlayer(const std::string& player)
     {
     case GAME_NOT_STARTED:
     case GAME_FINISHED:
-        if (players_.size() >= 8) return Error{"TOO_MANY_PLAYERS"};
+        if (players_.size() >= static_cast<std::size_t>(MAX_PLAYERS)) return Error{"TOO_MANY_PLAYERS"};
         players_.emplace_back(player);
         ++hash_;
+        log(Move::JOIN, player);
         return Success{};
     case GAME_STARTED:
     case ROUND_STARTED:
@@ -109,6 +154,7 @@ void Game::removePlayer(const Player& player)
     auto it = std::find(players_.begin(), players_.end(), player);
     if (it != players_.end())
     {
+        log(Move::REMOVE, it->name());
         players_.erase(it);
         ++hash_;
     }
@@ -121,6 +167,7 @@ RetVal Game::startGame()
     if (players_.size() < 2) return Error{"NOT_ENOUGH_PLAYERS"};
     state_ = GAME_STARTED;
     ++hash_;
+    log(Move::START_GAME);
     return Success{};
 }
 
@@ -141,11 +188,9 @@ RetVal Game::startRound()
     case GAME_STARTED:
         state_ = ROUND_STARTED;
         currentBid_ = Bid{};
-        for (auto& p : players_)
-        {
-            p.roll();
-        }
+        rollAll();
         ++hash_;
+        log(Move::START_ROUND);
         return Success{};
     case GAME_NOT_STARTED:
     case ROUND_STARTED:
@@ -154,6 +199,36 @@ RetVal Game::startRound()
     }
 }
 
+void Game::rollAll()
+{
+    std::size_t n = 0;
+    for (const auto& p : players_) n += p.hand().size();
+
+    // Games are limited to MAX_PLAYERS but a loaded game could have more
+    std::array<int, MAX_PLAYERS * MAX_DICE> buf;
+    std::vector<int> big;
+    int* faces = buf.data();
+    if (n > buf.size())
+    {
+        big.resize(n);
+        faces = big.data();
+    }
+
+    dice().rollMany(faces, n);
+    const int* next = faces;
+    for (auto& p : players_)
+    {
+        next = p.roll(next);
+    }
+    log(Move::ROLL, {}, static_cast<int>(n));
+}
+
+void Game::log(Move::Type type, const std::string& player, int value, int face)
+{
+    const auto index = player.empty() ? std::uint16_t{0} : moves_.intern(player);
+    moves_.push(Move{type, static_cast<std::uint8_t>(face), index, value});
+}
+
 void Game::nextPlayer()
 {
     ++turn_;
@@ -179,6 +254,7 @@ RetVal Game::bid(const std::string& player, int n, int face)
     currentBid_ = bid;
     bidder_ = &currentPlayer();
     currentPlayer().bid(bid);
+    log(Move::BID, player, n, face);
     nextPlayer();
     return Success{};
 }
@@ -205,6 +281,7 @@ RetVal Game::challenge(const std::string& player)
         {
             ++numPlayers;
         }
+        if (numDiceRemoved != 0) log(Move::RESULT, p.name(), numDiceRemoved);
     }
     assert(numPlayers >= 1);
     state_ = numPlayers == 1 ? GAME_FINISHED : CHALLENGE;
@@ -214,6 +291,7 @@ RetVal Game::challenge(const std::string& player)
     {
         setTurn(*bidder_);
     }
+    log(Move::CHALLENGE, player, offset);
     return Success{};
 }
 
@@ -221,21 +299,17 @@ RetVal Game::logout(const std::string& player)
 {
     auto it = std::find_if(players_.begin(), players_.end(),
         [&player](const Player& p) { return p.name() == player; });
-    std::cout << "num players " << players_.size() << std::endl;
     if (it != players_.end())
     {
         if (state_ == ROUND_STARTED)
         {
             currentBid_ = Bid{};
-            for (auto& p : players_)
-            {
-                p.roll();
-            }
+            rollAll();
         }
         players_.erase(it);
         ++hash_;
+        log(Move::LEAVE, player);
     }
-    std::cout << "num players " << players_.size() << std::endl;
     return Success{};
 }
 
@@ -247,7 +321,20 @@ std::string Game::getStatus(const std::string& player)
     return s.GetString();
 }
 
-void Game::serialize(json::Writer& writer, const std::string& name) const
+template<typename Writer>
+void Game::serialize(Writer& w, const std::string& name) const
+{
+    doSerialize(w, name, false);
+}
+
+template<typename Writer>
+void Game::serializeState(Writer& w) const
+{
+    doSerialize(w, "", true);
+}
+
+template<typename Writer>
+void Game::doSerialize(Writer& writer, const std::string& name, bool state) const
 {
     using namespace json;
     Object(writer, [=](auto& w)
@@ -256,6 +343,17 @@ void Game::serialize(json::Writer& writer, const std::string& name) const
         KeyValue(w, "state", toString(state_));
         KeyValue(w, "turn", turn_);
         KeyValue(w, "hash", hash_);
+        if (state)
+        {
+            KeyValueF(w, "dice", [this](auto& w)
+            {
+                Object(w, [this](auto& w)
+                {
+                    KeyValue(w, "seed", dice_.seed());
+                    KeyValue(w, "position", dice_.position());
+                });
+            });
+        }
         KeyValueF(w, "bid", [=](auto& w)
         {
             currentBid_.serialize(w);
@@ -273,9 +371,98 @@ void Game::serialize(json::Writer& writer, const std::string& name) const
                     p.serialize(w1, name);
             }
         });
+
+        // The log is saved and replicated with the game so that the game
+        // can still be replayed after a restart or a failover. Four numbers
+        // per move: type, player, value, face.
+        if (state && moves_.end() > moves_.begin())
+        {
+            KeyValueF(w, "log", [this](auto& w)
+            {
+                Object(w, [this](auto& w)
+                {
+                    KeyValue(w, "first", moves_.begin());
+                    KeyValue(w, "complete", moves_.complete());
+                    ArrayW(w, "names", [this](auto& w1)
+                    {
+                        for (const auto& n : moves_.names()) w1.String(n.c_str());
+                    });
+                    ArrayW(w, "moves", [this](auto& w1)
+                    {
+                        moves_.forEach(moves_.begin(), [&w1](std::uint64_t, const Move& m)
+                        {
+                            w1.Int(m.type);
+                            w1.Int(m.player);
+                            w1.Int(m.value);
+                            w1.Int(m.face);
+                        });
+                    });
+                });
+            });
+        }
+    });
+}
+
+template void Game::serialize(json::Writer&, const std::string&) const;
+template void Game::serialize(msgpack::Writer&, const std::string&) const;
+template void Game::serializeState(json::Writer&) const;
+template void Game::serializeState(msgpack::Writer&) const;
+
+template<typename Writer>
+void Game::serializeMoves(Writer& writer, std::uint64_t since) const
+{
+    using namespace json;
+    Object(writer, [=](auto& w)
+    {
+        KeyValue(w, "game", game_);
+        KeyValue(w, "complete", moves_.complete());
+        KeyValue(w, "first", moves_.begin());
+        KeyValue(w, "next", moves_.end());
+        ArrayW(w, "moves", [=](auto& w1)
+        {
+            moves_.forEach(since, [&](std::uint64_t seq, const Move& m)
+            {
+                Object(w1, [&](auto& w2)
+                {
+                    KeyValue(w2, "seq", seq);
+                    KeyValue(w2, "move", Move::toString(m.type));
+                    switch (m.type)
+                    {
+                    case Move::START_GAME:
+                    case Move::START_ROUND:
+                        break;
+                    case Move::ROLL:
+                        KeyValue(w2, "dice", static_cast<int>(m.value));
+                        break;
+                    case Move::BID:
+                        KeyValue(w2, "player", moves_.name(m.player));
+                        KeyValue(w2, "n", static_cast<int>(m.value));
+                        KeyValue(w2, "face", static_cast<int>(m.face));
+                        break;
+                    case Move::CHALLENGE:
+                        KeyValue(w2, "player", moves_.name(m.player));
+                        KeyValue(w2, "offset", static_cast<int>(m.value));
+                        break;
+                    case Move::RESULT:
+                        KeyValue(w2, "player", moves_.name(m.player));
+                        KeyValue(w2, "dice", static_cast<int>(m.value));
+                        break;
+                    case Move::CREATE:
+                    case Move::JOIN:
+                    case Move::LEAVE:
+                    case Move::REMOVE:
+                        KeyValue(w2, "player", moves_.name(m.player));
+                        break;
+                    }
+                });
+            });
+        });
     });
 }
 
+template void Game::serializeMoves(json::Writer&, std::uint64_t) const;
+template void Game::serializeMoves(msgpack::Writer&, std::uint64_t) const;
+
 void Game::serializeGameInfo(json::Writer& w) const
 {
     json::Object(w, [this](auto& w)
@@ -295,8 +482,22 @@ std::unique_ptr<Game> Game::fromJson(const rapidjson::Value& v)
 {
     using namespace json;
     auto game = std::make_unique<Game>(getString(v, "game"));
+    // The moves before the snapshot are not known unless it has the log. A
+    // damaged log only loses the history, not the game.
+    game->moves_ = MoveLog{false};
+    if (v.IsObject() && v.HasMember("log"))
+    {
+        try {
+            game->moves_ = readLog(v["log"]);
+        } catch (const ParseError&) {}
+    }
     game->turn_ = getInt(v, "turn");
     game->hash_ = getInt(v, "hash", 0);
+    if (v.IsObject() && v.HasMember("dice"))
+    {
+        const auto& d = v["dice"];
+        game->dice_.reset(getUint64(d, "seed"), getUint64(d, "position"));
+    }
     game->state_ = fromString(getString(v, "state"));
     game->currentBid_ = Bid::fromJson(getValue(v, "bid"));
     for (const auto& jplayer : getArray(v, "players"))
@@ -306,4 +507,56 @@ std::unique_ptr<Game> Game::fromJson(const rapidjson::Value& v)
     return game;
 }
 
+std::unique_ptr<Game> Game::replay(const std::string& game, std::uint64_t seed, const MoveLog& moves)
+{
+    if (!moves.complete()) return nullptr;
+    auto g = std::make_unique<Game>(game);
+    g->dice_.reset(seed, 0);
+    bool ok = true;
+    moves.forEach(0, [&](std::uint64_t, const Move& m)
+    {
+        // The outcomes follow from the commands
+        if (!ok || m.outcome()) return;
+        const auto& player = moves.name(m.player);
+        switch (m.type)
+        {
+        case Move::CREATE:
+            ok = g->players_.empty();
+            g->players_.emplace_back(player);
+            g->log(Move::CREATE, player);
+            break;
+        case Move::JOIN:
+            ok = g->addPlayer(player);
+            break;
+        case Move::LEAVE:
+            g->logout(player);
+            break;
+        case Move::REMOVE:
+        {
+            const auto it = std::find_if(g->players_.begin(), g->players_.end(),
+                [&player](const Player& p) { return p.name() == player; });
+            ok = it != g->players_.end();
+            if (ok) g->removePlayer(*it);
+            break;
+        }
+        case Move::START_GAME:
+            ok = g->startGame();
+            break;
+        case Move::START_ROUND:
+            ok = g->startRound();
+            break;
+        case Move::BID:
+            ok = g->bid(player, m.value, m.face);
+            break;
+        case Move::CHALLENGE:
+            ok = g->challenge(player);
+            break;
+        case Move::ROLL:
+        case Move::RESULT:
+            break;
+        }
+    });
+    return ok ? std::move(g) : nullptr;
+}
+
 } // namespace dice
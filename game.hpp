@@ -3,9 +3,12 @@
 #include "player.hpp"
 
 #include "bid.hpp"
+#include "dice.hpp"
 #include "json.hpp"
 #include "helpers.hpp" // RetVal
+#include "movelog.hpp"
 
+#include <cstdint>
 #include <memory>
 #include <random>
 #include <string>
@@ -13,8 +16,6 @@
 
 namespace dice {
 
-class IDice;
-
 template<typename T>
 inline T set(T& value, T newValue)
 {
@@ -45,7 +46,7 @@ class Game
     int turn_;
     Bid currentBid_;
     //bool roundStarted_;
-    const IDice& diceRoll_;
+    SeededDice dice_;
     enum State
     {
         GAME_NOT_STARTED,
@@ -60,6 +61,8 @@ class Game
     const Player* bidder_;
     const Player* challenger_;
 
+    MoveLog moves_;
+
     int getOffset() const;
 
     static const char* toString(State state);
@@ -73,6 +76,16 @@ class Game
     
     void setTurn(const Player& player);
     void nextPlayer();
+
+    // Per-game dice stream unless a global instance has been set for tests
+    const IDice& dice() const { return Dice::instance(dice_); }
+    // Roll the dice of all players with a single call to the dice stream
+    void rollAll();
+    // Append to the move log, player is empty for the moves of the game
+    void log(Move::Type type, const std::string& player = {}, int value = 0, int face = 0);
+    // Serialize for the player or, if state, with the dice stream
+    template<typename Writer>
+    void doSerialize(Writer& w, const std::string& name, bool state) const;
 public:
     /// Construct a new game
     /// @param game [in] name of the game
@@ -81,6 +94,11 @@ public:
     /// @param game [in] name of the game
     /// @param player [in] first player in the game
     Game(const std::string& game, const std::string& player);
+    /// Construct a new game with a reproducible dice stream
+    /// @param game [in] name of the game
+    /// @param player [in] first player in the game
+    /// @param seed [in] seed for the dice of the game
+    Game(const std::string& game, const std::string& player, std::uint64_t seed);
     /// No copying
     Game(Game&&) = delete;
 
@@ -90,6 +108,9 @@ public:
     /// @return hash for the game (unique id for state)
     auto hash() const { return hash_; }
 
+    /// @return seed of the game's dice stream
+    auto seed() const { return dice_.seed(); }
+
     /// Add player to the game
     /// @param player [in] player's name
     /// @return json indicating the success of the operation
@@ -101,6 +122,19 @@ public:
 
     /// @return players in the game
     const auto& players() const { return players_; }
+
+    /// @return whether a round is in progress, i.e., bids can be made
+    bool roundStarted() const { return state_ == ROUND_STARTED; }
+
+    /// @return index of the player in turn in players
+    auto turn() const { return turn_; }
+
+    /// @return the bid to raise or challenge, Bid{} if there is none
+    const auto& currentBid() const { return currentBid_; }
+
+    /// @return log of the moves since the game was created, or since it
+    ///     was loaded from a state without the log
+    const auto& moves() const { return moves_; }
     
     /// Start the game
     /// @return json indicating the success of the operation
@@ -130,10 +164,30 @@ public:
     /// Serialize engine state to given writer. If round is still in progress,
     /// only given player's dice are "shown".
     ///
+    /// @tparam Writer json::Writer or msgpack::Writer
     /// @param w [out] state is serialized here
     /// @param name [in] who's dice to show if round is in progress. If empty,
     ///                  show all dice.
-    void serialize(json::Writer& w, const std::string& name) const;
+    template<typename Writer>
+    void serialize(Writer& w, const std::string& name) const;
+
+    /// Serialize the whole state for saving and replication: all dice, the
+    /// state of the dice stream, which predicts the coming rolls and is
+    /// never in the status of a player, and the move log for replay.
+    ///
+    /// @tparam Writer json::Writer or msgpack::Writer
+    /// @param w [out] state is serialized here
+    template<typename Writer>
+    void serializeState(Writer& w) const;
+
+    /// Serialize the move log. No dice are shown, the rolls only have the
+    /// number of dice.
+    ///
+    /// @tparam Writer json::Writer or msgpack::Writer
+    /// @param w [out] the moves are serialized here
+    /// @param since [in] number of the first move to serialize
+    template<typename Writer>
+    void serializeMoves(Writer& w, std::uint64_t since) const;
 
     /// Serialize information about all games: name, players.
     /// @param w [out] state is serialized here
@@ -143,6 +197,14 @@ public:
     /// @param v [in] json where to serialize from
     /// @throws ParseError if invalid format
     static std::unique_ptr<Game> fromJson(const rapidjson::Value& v);
+
+    /// Rebuild a game by running the commands of its move log again
+    /// @param game [in] name of the game
+    /// @param seed [in] seed of the dice stream of the game
+    /// @param moves [in] log of the game
+    /// @return the game or nullptr if the log does not start at the
+    ///     creation of the game or a move fails
+    static std::unique_ptr<Game> replay(const std::string& game, std::uint64_t seed, const MoveLog& moves);
 };
 
 } // namespace dice
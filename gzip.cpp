@@ -0,0 +1,75 @@
+#include "gzip.hpp"
+
+#include "atend.hpp"
+
+#include <zlib.h>
+
+#include <climits>
+#include <stdexcept>
+
+namespace dice {
+
+namespace {
+
+// 15 bits window with the gzip header and trailer
+constexpr int GZIP_WINDOW = 15 + 16;
+
+} // unnamed namespace
+
+std::string GzipEncoder::compress(const std::string& data, Profile profile) const
+{
+    if (data.size() > UINT_MAX) throw std::runtime_error("TOO_LARGE");
+
+    z_stream s{};
+    const auto level = profile == Profile::STATIC ? Z_BEST_COMPRESSION : 6;
+    if (deflateInit2(&s, level, Z_DEFLATED, GZIP_WINDOW, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+    {
+        throw std::runtime_error("DEFLATE_INIT");
+    }
+    AtEnd ae{[&s]{ deflateEnd(&s); }};
+
+    std::string result(deflateBound(&s, static_cast<uLong>(data.size())), '\0');
+    s.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data.data()));
+    s.avail_in = static_cast<uInt>(data.size());
+    s.next_out = reinterpret_cast<Bytef*>(&result[0]);
+    s.avail_out = static_cast<uInt>(result.size());
+    // The bound guarantees that one call is enough
+    if (deflate(&s, Z_FINISH) != Z_STREAM_END) throw std::runtime_error("DEFLATE");
+    result.resize(s.total_out);
+    return result;
+}
+
+std::string GzipEncoder::decompress(const std::string& data) const
+{
+    if (data.size() > UINT_MAX) throw std::runtime_error("TOO_LARGE");
+
+    z_stream s{};
+    if (inflateInit2(&s, GZIP_WINDOW) != Z_OK) throw std::runtime_error("INFLATE_INIT");
+    AtEnd ae{[&s]{ inflateEnd(&s); }};
+
+    s.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data.data()));
+    s.avail_in = static_cast<uInt>(data.size());
+    std::string result;
+    char outBuf[4096];
+    for (;;)
+    {
+        s.next_out = reinterpret_cast<Bytef*>(outBuf);
+        s.avail_out = sizeof(outBuf);
+        const auto ret = inflate(&s, Z_NO_FLUSH);
+        result.append(outBuf, sizeof(outBuf) - s.avail_out);
+        switch (ret)
+        {
+        case Z_STREAM_END:
+            if (s.avail_in != 0) throw std::runtime_error("INVALID_FORMAT");
+            return result;
+        case Z_OK:
+            break;
+        case Z_BUF_ERROR:
+            // No progress possible: truncated input
+        default:
+            throw std::runtime_error("INVALID_FORMAT");
+        }
+    }
+}
+
+} // namespace dice
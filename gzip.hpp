@@ -0,0 +1,18 @@
+#pragma once
+
+#include "encoder.hpp"
+
+#include <string>
+
+namespace dice {
+
+/// Gzip encoder using zlib
+class GzipEncoder : public Encoder
+{
+public:
+    Encoding encoding() const override { return Encoding::GZIP; }
+    std::string compress(const std::string& data, Profile profile) const override;
+    std::string decompress(const std::string& data) const override;
+};
+
+} // namespace dice
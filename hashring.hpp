@@ -0,0 +1,81 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <experimental/string_view>
+#include <utility>
+#include <vector>
+
+namespace dice {
+
+/// Consistent hash ring mapping keys, e.g., game names, to shards. Every
+/// shard owns VNODES points on the ring and a key belongs to the first
+/// point at or after its hash, so adding or removing a shard only moves the
+/// keys of that shard and the load is spread within a few percent.
+///
+/// The hash is fixed (FNV-1a with a final mix) so that all the processes
+/// agree on the owner of a key across restarts and builds.
+class HashRing
+{
+public:
+    /// Points per shard
+    static constexpr std::size_t VNODES = 128;
+
+    /// Construct HashRing
+    /// @param shards [in] number of shards, at least 1
+    explicit HashRing(std::size_t shards)
+      : shards_{std::max<std::size_t>(shards, 1)},
+        points_{}
+    {
+        points_.reserve(shards_ * VNODES);
+        for (std::size_t s = 0; s < shards_; ++s)
+        {
+            for (std::size_t v = 0; v < VNODES; ++v)
+            {
+                points_.emplace_back(mix(s * VNODES + v), s);
+            }
+        }
+        std::sort(points_.begin(), points_.end());
+    }
+
+    /// @return number of shards
+    std::size_t size() const { return shards_; }
+
+    /// @return shard owning the key [0, size())
+    std::size_t shard(std::experimental::string_view key) const
+    {
+        const auto h = hash(key);
+        auto it = std::lower_bound(points_.begin(), points_.end(), std::make_pair(h, std::size_t{0}));
+        if (it == points_.end()) it = points_.begin();
+        return it->second;
+    }
+
+    /// @return stable 64-bit hash of the key
+    static std::uint64_t hash(std::experimental::string_view key)
+    {
+        std::uint64_t h = 14695981039346656037ull;
+        for (const auto c : key)
+        {
+            h ^= static_cast<unsigned char>(c);
+            h *= 1099511628211ull;
+        }
+        return mix(h);
+    }
+
+private:
+    std::size_t shards_;
+    // Sorted (position, shard)
+    std::vector<std::pair<std::uint64_t, std::size_t>> points_;
+
+    // splitmix64 finalizer, spreads the nearby FNV values over the ring
+    static std::uint64_t mix(std::uint64_t x)
+    {
+        x += 0x9e3779b97f4a7c15ull;
+        x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+        x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+        return x ^ (x >> 31);
+    }
+};
+
+} // namespace dice
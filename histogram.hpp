@@ -0,0 +1,110 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+
+namespace dice {
+
+/// Histogram of non-negative integers, e.g., latencies in microseconds.
+/// Values below 2^SUB_BITS are counted exactly and larger values in
+/// logarithmic buckets with relative width 2^-SUB_BITS, so percentiles are
+/// within about 3 % with constant memory and O(1) recording.
+class Histogram
+{
+    static constexpr unsigned SUB_BITS = 5;
+    static constexpr std::size_t SUB = std::size_t{1} << SUB_BITS;
+    static constexpr std::size_t BUCKETS = (64 - SUB_BITS + 1) * SUB;
+
+    std::array<std::uint64_t, BUCKETS> counts_;
+    std::uint64_t count_;
+    std::uint64_t sum_;
+    std::uint64_t min_;
+    std::uint64_t max_;
+
+    static std::size_t index(std::uint64_t v)
+    {
+        if (v < SUB) return static_cast<std::size_t>(v);
+        const auto msb = static_cast<unsigned>(63 - __builtin_clzll(v));
+        const auto shift = msb - SUB_BITS;
+        return (shift + 1) * SUB + static_cast<std::size_t>((v >> shift) - SUB);
+    }
+
+    /// @return largest value in the bucket
+    static std::uint64_t highest(std::size_t i)
+    {
+        if (i < SUB) return i;
+        const auto shift = i / SUB - 1;
+        const auto mantissa = std::uint64_t{i % SUB + SUB};
+        return ((mantissa + 1) << shift) - 1;
+    }
+public:
+    /// Construct empty Histogram
+    Histogram()
+      : counts_{},
+        count_{},
+        sum_{},
+        min_{std::numeric_limits<std::uint64_t>::max()},
+        max_{}
+    {
+    }
+
+    /// Add value
+    /// @param v [in] value to add
+    void record(std::uint64_t v)
+    {
+        ++counts_[index(v)];
+        ++count_;
+        sum_ += v;
+        min_ = std::min(min_, v);
+        max_ = std::max(max_, v);
+    }
+
+    /// Add the values of another histogram
+    /// @param other [in] histogram to add
+    void merge(const Histogram& other)
+    {
+        for (std::size_t i = 0; i < BUCKETS; ++i) counts_[i] += other.counts_[i];
+        count_ += other.count_;
+        sum_ += other.sum_;
+        min_ = std::min(min_, other.min_);
+        max_ = std::max(max_, other.max_);
+    }
+
+    /// @return number of values
+    auto count() const { return count_; }
+
+    /// @return smallest value or 0 if empty
+    std::uint64_t min() const { return count_ ? min_ : 0; }
+
+    /// @return largest value
+    auto max() const { return max_; }
+
+    /// @return mean of the values or 0 if empty
+    double mean() const
+    {
+        return count_ ? static_cast<double>(sum_) / static_cast<double>(count_) : 0.0;
+    }
+
+    /// @param p [in] percentile as fraction [0, 1], e.g., 0.99
+    /// @return value that p of the values are less than or equal to, 0 if
+    ///     empty
+    std::uint64_t percentile(double p) const
+    {
+        if (count_ == 0) return 0;
+        const auto rank = std::max<std::uint64_t>(1,
+            static_cast<std::uint64_t>(std::ceil(p * static_cast<double>(count_))));
+        std::uint64_t seen = 0;
+        for (std::size_t i = 0; i < BUCKETS; ++i)
+        {
+            seen += counts_[i];
+            if (seen >= rank) return std::min(highest(i), max_);
+        }
+        return max_;
+    }
+};
+
+} // namespace dice
@@ -0,0 +1,133 @@
+#include "httpclient.hpp"
+
+#include <boost/asio.hpp>
+
+#include <cctype>
+#include <cstdlib>
+#include <istream>
+#include <sstream>
+#include <stdexcept>
+
+namespace dice {
+
+namespace asio = boost::asio;
+using asio::ip::tcp;
+
+struct HttpClient::Impl
+{
+    const std::string host_;
+    const std::string port_;
+    asio::io_service io_;
+    tcp::socket socket_;
+    asio::streambuf buf_;
+    int status_;
+
+    Impl(const std::string& host, const std::string& port)
+      : host_{host}, port_{port}, io_{}, socket_{io_}, buf_{}, status_{}
+    {
+    }
+
+    void connect()
+    {
+        tcp::resolver resolver{io_};
+        asio::connect(socket_, resolver.resolve(tcp::resolver::query{host_, port_}));
+        socket_.set_option(tcp::no_delay{true});
+    }
+
+    void close()
+    {
+        boost::system::error_code ec;
+        socket_.close(ec);
+        buf_.consume(buf_.size());
+    }
+
+    std::string roundTrip(const std::string& request)
+    {
+        asio::write(socket_, asio::buffer(request));
+        asio::read_until(socket_, buf_, "\r\n\r\n");
+
+        std::istream in{&buf_};
+        std::string line;
+        std::getline(in, line);
+        std::istringstream statusLine{line};
+        std::string version;
+        statusLine >> version >> status_;
+        if (version.compare(0, 5, "HTTP/") != 0) throw std::runtime_error("INVALID_RESPONSE");
+
+        std::size_t length = 0;
+        bool hasLength = false;
+        bool closing = false;
+        while (std::getline(in, line) && line != "\r")
+        {
+            const auto colon = line.find(':');
+            if (colon == std::string::npos) continue;
+            std::string name = line.substr(0, colon);
+            for (auto& c : name) c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+            const auto value = line.substr(colon + 1);
+            if (name == "content-length")
+            {
+                length = std::strtoull(value.c_str(), nullptr, 10);
+                hasLength = true;
+            }
+            else if (name == "connection" && value.find("close") != std::string::npos)
+            {
+                closing = true;
+            }
+        }
+        if (!hasLength) throw std::runtime_error("NO_CONTENT_LENGTH");
+
+        if (buf_.size() < length) asio::read(socket_, buf_, asio::transfer_exactly(length - buf_.size()));
+        std::string body(length, '\0');
+        in.read(&body[0], static_cast<std::streamsize>(length));
+        if (closing) close();
+        return body;
+    }
+
+    std::string request(const std::string& request)
+    {
+        // The server may have closed the kept-alive connection, retry once
+        for (int attempt = 0;; ++attempt)
+        {
+            try {
+                if (!socket_.is_open()) connect();
+                return roundTrip(request);
+            }
+            catch (const boost::system::system_error& e) {
+                close();
+                if (attempt > 0) throw std::runtime_error(e.what());
+            }
+        }
+    }
+};
+
+HttpClient::HttpClient(const std::string& host, const std::string& port)
+  : impl_{std::make_unique<Impl>(host, port)}
+{
+}
+
+HttpClient::~HttpClient() = default;
+
+std::string HttpClient::post(const std::string& path, const std::string& body, const std::string& contentType)
+{
+    std::string request = "POST " + path + " HTTP/1.1\r\n"
+        "Host: " + impl_->host_ + "\r\n"
+        "Content-Type: " + contentType + "\r\n"
+        "Content-Length: " + std::to_string(body.size()) + "\r\n"
+        "\r\n";
+    request += body;
+    return impl_->request(request);
+}
+
+std::string HttpClient::get(const std::string& path)
+{
+    return impl_->request("GET " + path + " HTTP/1.1\r\n"
+        "Host: " + impl_->host_ + "\r\n"
+        "\r\n");
+}
+
+int HttpClient::status() const
+{
+    return impl_->status_;
+}
+
+} // namespace dice
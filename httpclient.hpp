@@ -0,0 +1,43 @@
+#pragma once
+
+#include <memory>
+#include <string>
+
+namespace dice {
+
+/// Minimal blocking HTTP/1.1 client for the load tools. The connection is
+/// kept open between the requests and reopened if the server closes it.
+/// Responses must have Content-Length. Not thread-safe, use one client per
+/// thread.
+class HttpClient
+{
+    struct Impl;
+    std::unique_ptr<Impl> impl_;
+public:
+    /// Construct HttpClient. Connects on the first request.
+    /// @param host [in] host name or address of the server
+    /// @param port [in] port of the server
+    HttpClient(const std::string& host, const std::string& port);
+
+    /// Destructor
+    ~HttpClient();
+
+    /// Make POST request
+    /// @param path [in] path of the url
+    /// @param body [in] body of the request
+    /// @param contentType [in] Content-Type of the body
+    /// @return body of the response
+    /// @throws std::runtime_error if the request fails
+    std::string post(const std::string& path, const std::string& body, const std::string& contentType);
+
+    /// Make GET request
+    /// @param path [in] path of the url
+    /// @return body of the response
+    /// @throws std::runtime_error if the request fails
+    std::string get(const std::string& path);
+
+    /// @return status code of the last response
+    int status() const;
+};
+
+} // namespace dice
@@ -2,6 +2,9 @@
 
 #include "tokenizer.hpp"
 
+#include <cctype>
+#include <cstddef>
+#include <experimental/string_view>
 #include <string>
 
 namespace dice {
@@ -26,4 +29,150 @@ inline bool hasHttpValue(const std::string& contents, const std::string& value)
     return true;
 }
 
+/// Check if the http Content-Type header field is MessagePack, i.e.,
+/// application/msgpack or application/x-msgpack, with any parameters.
+/// @param contents [in] contents of the header field without the name
+/// @return whether the content type is MessagePack
+inline bool isMsgPack(const std::string& contents)
+{
+    static const std::string delim{" ;"};
+    Tokenizer tok(contents.c_str(), delim.c_str());
+    const auto type = tok.nextStringView();
+    return type == "application/msgpack" || type == "application/x-msgpack";
+}
+
+/// Content codings of the responses
+enum class Encoding
+{
+    IDENTITY,
+    BR,
+    GZIP,
+    ZSTD
+};
+
+/// Number of Encodings
+constexpr std::size_t ENCODINGS = 4;
+
+/// @return bit of the encoding in a set of encodings
+constexpr unsigned encodingBit(Encoding e)
+{
+    return 1u << static_cast<unsigned>(e);
+}
+
+/// @return name of the encoding in Content-Encoding
+inline const char* encodingName(Encoding e)
+{
+    static const char* const names[ENCODINGS] = {"identity", "br", "gzip", "zstd"};
+    return names[static_cast<std::size_t>(e)];
+}
+
+/// Accept-Encoding http header field parsed into the q-values of the
+/// encodings this server knows, e.g., "br;q=0, gzip" accepts gzip and
+/// identity but not brotli.
+class AcceptEncoding
+{
+    // q-values in thousandths, -1 if the coding is not listed
+    int q_[ENCODINGS];
+    int any_;
+
+    static bool equals(std::experimental::string_view a, const char* b)
+    {
+        std::size_t i = 0;
+        for (; i < a.size() && b[i]; ++i)
+        {
+            if (std::tolower(static_cast<unsigned char>(a[i])) != b[i]) return false;
+        }
+        return i == a.size() && !b[i];
+    }
+
+    /// @return q-value in thousandths or -1 if the value is invalid
+    static int parseQ(std::experimental::string_view v)
+    {
+        if (v.empty() || v.size() > 5 || (v[0] != '0' && v[0] != '1')) return -1;
+        int q = (v[0] - '0') * 1000;
+        if (v.size() == 1) return q;
+        if (v[1] != '.') return -1;
+        int scale = 100;
+        for (std::size_t i = 2; i < v.size(); ++i, scale /= 10)
+        {
+            if (!std::isdigit(static_cast<unsigned char>(v[i]))) return -1;
+            q += (v[i] - '0') * scale;
+        }
+        return q <= 1000 ? q : -1;
+    }
+
+    void add(std::experimental::string_view element)
+    {
+        Tokenizer tok(element, " \t;");
+        const auto coding = tok.nextStringView();
+        if (coding.empty()) return;
+        int q = 1000;
+        for (auto param = tok.nextStringView(); !param.empty(); param = tok.nextStringView())
+        {
+            if (param.size() >= 2 && (param[0] == 'q' || param[0] == 'Q') && param[1] == '=')
+            {
+                q = parseQ(param.substr(2));
+            }
+        }
+        if (q < 0) return;
+
+        if (coding == "*") any_ = q;
+        else if (equals(coding, "identity")) q_[static_cast<std::size_t>(Encoding::IDENTITY)] = q;
+        else if (equals(coding, "br")) q_[static_cast<std::size_t>(Encoding::BR)] = q;
+        else if (equals(coding, "gzip") || equals(coding, "x-gzip")) q_[static_cast<std::size_t>(Encoding::GZIP)] = q;
+        else if (equals(coding, "zstd")) q_[static_cast<std::size_t>(Encoding::ZSTD)] = q;
+    }
+public:
+    /// Construct AcceptEncoding for a request without the header field, which
+    /// accepts only identity
+    AcceptEncoding() : q_{-1, -1, -1, -1}, any_{-1} {}
+
+    /// Construct AcceptEncoding
+    /// @param contents [in] contents of the header field without the name
+    explicit AcceptEncoding(const std::string& contents) : AcceptEncoding()
+    {
+        Tokenizer tok(contents.c_str(), ",");
+        for (auto element = tok.nextStringView(); !element.empty(); element = tok.nextStringView())
+        {
+            add(element);
+        }
+    }
+
+    /// @return q-value of the encoding in thousandths, 0 if not acceptable
+    int q(Encoding e) const
+    {
+        const auto q = q_[static_cast<std::size_t>(e)];
+        if (q >= 0) return q;
+        if (any_ >= 0) return any_;
+        // Identity is acceptable unless excluded
+        return e == Encoding::IDENTITY ? 1 : 0;
+    }
+
+    /// @return whether the encoding is acceptable
+    bool accepts(Encoding e) const { return q(e) > 0; }
+
+    /// Select the encoding for the response. Of the equally weighted
+    /// encodings the one compressing best is chosen.
+    /// @param available [in] bits of the encodings there are for the
+    ///     response. Identity is used if none of them is acceptable.
+    /// @return the encoding
+    Encoding select(unsigned available) const
+    {
+        static const Encoding preference[] = {Encoding::BR, Encoding::ZSTD, Encoding::GZIP, Encoding::IDENTITY};
+        auto best = Encoding::IDENTITY;
+        int bestQ = 0;
+        for (const auto e : preference)
+        {
+            if (!(available & encodingBit(e))) continue;
+            const auto q = this->q(e);
+            if (q > bestQ)
+            {
+                best = e;
+                bestQ = q;
+            }
+        }
+        return best;
+    }
+};
+
 } // namespace dice
@@ -4,6 +4,7 @@
 #include "rapidjson/stringbuffer.h"
 #include "rapidjson/document.h"
 
+#include <cstdint>
 #include <iostream>
 #include <string>
 
@@ -189,6 +190,13 @@ inline void KeyValue(Writer& w, const std::string& k, int v)
     w.Int(v);
 }
 
+template<typename Writer>
+inline void KeyValue(Writer& w, const std::string& k, std::uint64_t v)
+{
+    w.Key(k.c_str());
+    w.Uint64(v);
+}
+
 template<typename Writer, typename F>
 inline void KeyValueF(Writer& w, const std::string& k, F&& v)
 {
@@ -251,6 +259,15 @@ inline auto getInt(const rapidjson::Value& v, const char* k, int defaultValue)
     return defaultValue;
 }
 
+inline auto getUint64(const rapidjson::Value& v, const char* k)
+{
+    if (v.IsObject() && v.HasMember(k) && v[k].IsUint64())
+    {
+        return v[k].GetUint64();
+    }
+    throw ParseError{};
+}
+
 inline auto getInt(const rapidjson::Value& v)
 {
     if (v.IsInt())
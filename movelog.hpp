@@ -0,0 +1,183 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace dice {
+
+/// Entry of the move log of a game. Players are referred to by their index
+/// in the name table of the log so that the entries are fixed-size and no
+/// strings are copied per move.
+struct Move
+{
+    /// The commands change the game, the outcomes are the effects of the
+    /// command that follows them and are skipped when replaying
+    enum Type : std::uint8_t
+    {
+        /// Game created by the player
+        CREATE,
+        /// Player joined
+        JOIN,
+        /// Player logged out, the dice are rolled again if in a round
+        LEAVE,
+        /// Player removed, e.g., when loading
+        REMOVE,
+        START_GAME,
+        START_ROUND,
+        /// Player bid value times face
+        BID,
+        /// Player challenged, value is the count of the bid face minus
+        /// the bid
+        CHALLENGE,
+        /// Outcome: value dice rolled
+        ROLL,
+        /// Outcome: player loses value dice when the next round starts
+        RESULT
+    };
+
+    Type type;
+    std::uint8_t face;
+    std::uint16_t player;
+    std::int32_t value;
+
+    /// @return name of the type for the API
+    static const char* toString(Type type)
+    {
+        switch (type)
+        {
+        case CREATE: return "create";
+        case JOIN: return "join";
+        case LEAVE: return "leave";
+        case REMOVE: return "remove";
+        case START_GAME: return "startGame";
+        case START_ROUND: return "startRound";
+        case BID: return "bid";
+        case CHALLENGE: return "challenge";
+        case ROLL: return "roll";
+        case RESULT: return "result";
+        }
+        return "";
+    }
+
+    /// @return whether the entry is an outcome rather than a command
+    bool outcome() const { return type == ROLL || type == RESULT; }
+};
+
+static_assert(sizeof(Move) == 8, "Move is a fixed-size record");
+
+/// Append-only log of the moves of a game. The entries are stored in
+/// chunks that are allocated as the log grows, starting small so that idle
+/// games stay cheap, and never move once written. Past MAX_MOVES the oldest
+/// chunk is dropped. Entries are numbered from the creation of the log.
+class MoveLog
+{
+public:
+    /// Entries in the first chunk, every chunk doubles the capacity up to
+    /// MAX_CHUNK
+    static constexpr std::size_t FIRST_CHUNK = 16;
+    static constexpr std::size_t MAX_CHUNK = 1024;
+    /// Entries kept
+    static constexpr std::size_t MAX_MOVES = 16 * MAX_CHUNK;
+
+    /// Construct MoveLog
+    /// @param complete [in] whether the log starts at the creation of the
+    ///     game, false for games loaded from a snapshot without the log
+    /// @param first [in] number of the first entry, for restoring a saved
+    ///     log that had dropped its oldest chunks
+    explicit MoveLog(bool complete = true, std::uint64_t first = 0)
+      : chunks_{},
+        names_{},
+        begin_{first},
+        end_{first},
+        complete_{complete}
+    {
+    }
+
+    /// @param name [in] name of a player
+    /// @return index of the name in the name table, added if not there
+    std::uint16_t intern(const std::string& name)
+    {
+        const auto it = std::find(names_.begin(), names_.end(), name);
+        if (it != names_.end()) return static_cast<std::uint16_t>(it - names_.begin());
+        names_.push_back(name);
+        return static_cast<std::uint16_t>(names_.size() - 1);
+    }
+
+    /// @return name of the player of an entry
+    const std::string& name(std::uint16_t player) const { return names_[player]; }
+
+    /// @return the name table in the order of the indices
+    const std::vector<std::string>& names() const { return names_; }
+
+    /// Append an entry
+    /// @param move [in] the entry
+    void push(const Move& move)
+    {
+        if (chunks_.empty() || chunks_.back().size == chunks_.back().capacity)
+        {
+            while (end_ - begin_ >= MAX_MOVES)
+            {
+                begin_ += chunks_.front().size;
+                chunks_.erase(chunks_.begin());
+            }
+            const auto size = static_cast<std::size_t>(end_ - begin_);
+            const auto capacity = size < FIRST_CHUNK ? FIRST_CHUNK : size > MAX_CHUNK ? MAX_CHUNK : size;
+            chunks_.push_back(Chunk{std::make_unique<Move[]>(capacity), capacity, 0});
+        }
+        auto& chunk = chunks_.back();
+        chunk.moves[chunk.size++] = move;
+        ++end_;
+    }
+
+    /// @return number of the oldest entry kept
+    std::uint64_t begin() const { return begin_; }
+
+    /// @return number of the next entry
+    std::uint64_t end() const { return end_; }
+
+    /// @return whether the log has all the moves since the creation of the
+    ///     game
+    bool complete() const { return complete_ && begin_ == 0; }
+
+    /// Call f(number, move) for the entries from the given number on
+    /// @param from [in] number of the first entry, older ones are skipped
+    /// @param f [in] called for every entry in order
+    template<typename F>
+    void forEach(std::uint64_t from, F&& f) const
+    {
+        auto n = begin_;
+        for (const auto& chunk : chunks_)
+        {
+            if (n + chunk.size <= from)
+            {
+                n += chunk.size;
+                continue;
+            }
+            for (std::size_t i = from > n ? static_cast<std::size_t>(from - n) : 0; i < chunk.size; ++i)
+            {
+                f(n + i, chunk.moves[i]);
+            }
+            n += chunk.size;
+        }
+    }
+
+private:
+    struct Chunk
+    {
+        std::unique_ptr<Move[]> moves;
+        std::size_t capacity;
+        std::size_t size;
+    };
+
+    std::vector<Chunk> chunks_;
+    std::vector<std::string> names_;
+    std::uint64_t begin_;
+    std::uint64_t end_;
+    bool complete_;
+};
+
+} // namespace dice
@@ -0,0 +1,403 @@
+#pragma once
+#include "rapidjson/reader.h"
+#include "rapidjson/stringbuffer.h"
+#include "rapidjson/writer.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+/// MessagePack encoding of the API messages. The writer has the same
+/// interface as rapidjson writers so that the json serialization code
+/// produces MessagePack when given a msgpack::Writer, and the reader emits
+/// the same SAX events as rapidjson::Reader.
+namespace msgpack {
+
+using SizeType = rapidjson::SizeType;
+
+/// Writes MessagePack. The sizes of maps and arrays are not known when they
+/// are started, so space for the largest header is reserved and the
+/// header is compacted when the map or array ends.
+class Writer
+{
+    static constexpr std::size_t RESERVED = 5;
+
+    struct Container
+    {
+        std::size_t offset;
+        std::uint32_t count;
+        bool map;
+    };
+
+    std::string out_;
+    std::vector<Container> open_;
+
+    void put(std::uint8_t b) { out_.push_back(static_cast<char>(b)); }
+
+    template<typename T>
+    void putBig(T v)
+    {
+        for (auto shift = 8 * static_cast<int>(sizeof(T) - 1); shift >= 0; shift -= 8)
+        {
+            put(static_cast<std::uint8_t>(v >> shift));
+        }
+    }
+
+    // Count a value in an array. Values in maps are counted with the key.
+    void value()
+    {
+        if (!open_.empty() && !open_.back().map) ++open_.back().count;
+    }
+
+    void start(bool map)
+    {
+        value();
+        open_.push_back({out_.size(), 0, map});
+        out_.append(RESERVED, '\0');
+    }
+
+    void end()
+    {
+        const auto c = open_.back();
+        open_.pop_back();
+        char header[RESERVED];
+        std::size_t size;
+        if (c.count < 16)
+        {
+            header[0] = static_cast<char>((c.map ? 0x80 : 0x90) | c.count);
+            size = 1;
+        }
+        else if (c.count <= 0xffff)
+        {
+            header[0] = static_cast<char>(c.map ? 0xde : 0xdc);
+            header[1] = static_cast<char>(c.count >> 8);
+            header[2] = static_cast<char>(c.count);
+            size = 3;
+        }
+        else
+        {
+            header[0] = static_cast<char>(c.map ? 0xdf : 0xdd);
+            for (std::size_t i = 0; i < 4; ++i) header[i + 1] = static_cast<char>(c.count >> (24 - 8 * i));
+            size = 5;
+        }
+        std::memcpy(&out_[c.offset], header, size);
+        out_.erase(c.offset + size, RESERVED - size);
+    }
+
+    void string(const char* str, std::size_t length)
+    {
+        if (length < 32)
+        {
+            put(static_cast<std::uint8_t>(0xa0 | length));
+        }
+        else if (length <= 0xff)
+        {
+            put(0xd9);
+            put(static_cast<std::uint8_t>(length));
+        }
+        else if (length <= 0xffff)
+        {
+            put(0xda);
+            putBig(static_cast<std::uint16_t>(length));
+        }
+        else
+        {
+            put(0xdb);
+            putBig(static_cast<std::uint32_t>(length));
+        }
+        out_.append(str, length);
+    }
+
+public:
+    /// @return the encoded bytes
+    const std::string& str() const { return out_; }
+
+    /// Start writing a new document
+    void Reset() { out_.clear(); open_.clear(); }
+
+    bool Null() { value(); put(0xc0); return true; }
+    bool Bool(bool b) { value(); put(b ? 0xc3 : 0xc2); return true; }
+    bool Int(int i) { return Int64(i); }
+    bool Uint(unsigned u) { return Uint64(u); }
+
+    bool Int64(std::int64_t i)
+    {
+        if (i >= 0) return Uint64(static_cast<std::uint64_t>(i));
+        value();
+        if (i >= -32)
+        {
+            put(static_cast<std::uint8_t>(i));
+        }
+        else if (i >= INT8_MIN)
+        {
+            put(0xd0);
+            put(static_cast<std::uint8_t>(i));
+        }
+        else if (i >= INT16_MIN)
+        {
+            put(0xd1);
+            putBig(static_cast<std::uint16_t>(i));
+        }
+        else if (i >= INT32_MIN)
+        {
+            put(0xd2);
+            putBig(static_cast<std::uint32_t>(i));
+        }
+        else
+        {
+            put(0xd3);
+            putBig(static_cast<std::uint64_t>(i));
+        }
+        return true;
+    }
+
+    bool Uint64(std::uint64_t u)
+    {
+        value();
+        if (u < 128)
+        {
+            put(static_cast<std::uint8_t>(u));
+        }
+        else if (u <= UINT8_MAX)
+        {
+            put(0xcc);
+            put(static_cast<std::uint8_t>(u));
+        }
+        else if (u <= UINT16_MAX)
+        {
+            put(0xcd);
+            putBig(static_cast<std::uint16_t>(u));
+        }
+        else if (u <= UINT32_MAX)
+        {
+            put(0xce);
+            putBig(static_cast<std::uint32_t>(u));
+        }
+        else
+        {
+            put(0xcf);
+            putBig(u);
+        }
+        return true;
+    }
+
+    bool Double(double d)
+    {
+        value();
+        put(0xcb);
+        std::uint64_t bits;
+        std::memcpy(&bits, &d, sizeof(bits));
+        putBig(bits);
+        return true;
+    }
+
+    bool RawNumber(const char* str, SizeType length, bool copy = false)
+    {
+        return String(str, length, copy);
+    }
+
+    bool String(const char* str) { return String(str, static_cast<SizeType>(std::strlen(str))); }
+
+    bool String(const char* str, SizeType length, bool = false)
+    {
+        value();
+        string(str, length);
+        return true;
+    }
+
+    bool StartObject() { start(true); return true; }
+
+    bool Key(const char* str) { return Key(str, static_cast<SizeType>(std::strlen(str))); }
+
+    bool Key(const char* str, SizeType length, bool = false)
+    {
+        ++open_.back().count;
+        string(str, length);
+        return true;
+    }
+
+    bool EndObject(SizeType = 0) { end(); return true; }
+    bool StartArray() { start(false); return true; }
+    bool EndArray(SizeType = 0) { end(); return true; }
+};
+
+namespace detail {
+
+class Parser
+{
+    static constexpr int MAX_DEPTH = 32;
+
+    const std::uint8_t* p_;
+    const std::uint8_t* const end_;
+
+    bool has(std::size_t n) const { return static_cast<std::size_t>(end_ - p_) >= n; }
+
+    template<typename T>
+    bool getBig(T& v)
+    {
+        if (!has(sizeof(T))) return false;
+        v = 0;
+        for (std::size_t i = 0; i < sizeof(T); ++i) v = static_cast<T>((v << 8) | *p_++);
+        return true;
+    }
+
+    template<typename Handler>
+    bool string(Handler& h, std::uint32_t length, bool key)
+    {
+        if (!has(length)) return false;
+        const auto str = reinterpret_cast<const char*>(p_);
+        p_ += length;
+        return key ? h.Key(str, length, false) : h.String(str, length, false);
+    }
+
+    template<typename T>
+    bool length(std::uint32_t& n)
+    {
+        T v;
+        if (!getBig(v)) return false;
+        n = v;
+        return true;
+    }
+
+    template<typename Handler>
+    bool map(Handler& h, std::uint32_t n, int depth)
+    {
+        if (!h.StartObject()) return false;
+        for (std::uint32_t i = 0; i < n; ++i)
+        {
+            if (!key(h) || !value(h, depth + 1)) return false;
+        }
+        return h.EndObject(n);
+    }
+
+    template<typename Handler>
+    bool array(Handler& h, std::uint32_t n, int depth)
+    {
+        if (!h.StartArray()) return false;
+        for (std::uint32_t i = 0; i < n; ++i)
+        {
+            if (!value(h, depth + 1)) return false;
+        }
+        return h.EndArray(n);
+    }
+
+    // Only string keys are supported like in json
+    template<typename Handler>
+    bool key(Handler& h)
+    {
+        if (!has(1)) return false;
+        const auto b = *p_++;
+        std::uint32_t n = 0;
+        if ((b & 0xe0) == 0xa0) n = b & 0x1fu;
+        else if (b == 0xd9) { if (!length<std::uint8_t>(n)) return false; }
+        else if (b == 0xda) { if (!length<std::uint16_t>(n)) return false; }
+        else if (b == 0xdb) { if (!length<std::uint32_t>(n)) return false; }
+        else return false;
+        return string(h, n, true);
+    }
+
+public:
+    Parser(const char* data, std::size_t size)
+      : p_{reinterpret_cast<const std::uint8_t*>(data)},
+        end_{p_ + size}
+    {
+    }
+
+    bool done() const { return p_ == end_; }
+
+    template<typename Handler>
+    bool value(Handler& h, int depth)
+    {
+        if (depth > MAX_DEPTH || !has(1)) return false;
+        const auto b = *p_++;
+        std::uint32_t n = 0;
+        if (b < 0x80) return h.Uint(b);
+        if (b >= 0xe0) return h.Int(static_cast<std::int8_t>(b));
+        if ((b & 0xf0) == 0x80) return map(h, b & 0x0fu, depth);
+        if ((b & 0xf0) == 0x90) return array(h, b & 0x0fu, depth);
+        if ((b & 0xe0) == 0xa0) return string(h, b & 0x1fu, false);
+        switch (b)
+        {
+        case 0xc0: return h.Null();
+        case 0xc2: return h.Bool(false);
+        case 0xc3: return h.Bool(true);
+        case 0xca:
+        {
+            std::uint32_t bits;
+            float f;
+            if (!getBig(bits)) return false;
+            std::memcpy(&f, &bits, sizeof(f));
+            return h.Double(static_cast<double>(f));
+        }
+        case 0xcb:
+        {
+            std::uint64_t bits;
+            double d;
+            if (!getBig(bits)) return false;
+            std::memcpy(&d, &bits, sizeof(d));
+            return h.Double(d);
+        }
+        case 0xcc: { std::uint8_t v; return getBig(v) && h.Uint(v); }
+        case 0xcd: { std::uint16_t v; return getBig(v) && h.Uint(v); }
+        case 0xce: { std::uint32_t v; return getBig(v) && h.Uint(v); }
+        case 0xcf: { std::uint64_t v; return getBig(v) && h.Uint64(v); }
+        case 0xd0: { std::uint8_t v; return getBig(v) && h.Int(static_cast<std::int8_t>(v)); }
+        case 0xd1: { std::uint16_t v; return getBig(v) && h.Int(static_cast<std::int16_t>(v)); }
+        case 0xd2: { std::uint32_t v; return getBig(v) && h.Int(static_cast<std::int32_t>(v)); }
+        case 0xd3: { std::uint64_t v; return getBig(v) && h.Int64(static_cast<std::int64_t>(v)); }
+        case 0xd9: return length<std::uint8_t>(n) && string(h, n, false);
+        case 0xda: return length<std::uint16_t>(n) && string(h, n, false);
+        case 0xdb: return length<std::uint32_t>(n) && string(h, n, false);
+        case 0xdc: return length<std::uint16_t>(n) && array(h, n, depth);
+        case 0xdd: return length<std::uint32_t>(n) && array(h, n, depth);
+        case 0xde: return length<std::uint16_t>(n) && map(h, n, depth);
+        case 0xdf: return length<std::uint32_t>(n) && map(h, n, depth);
+        default:
+            // Binary and extension types are not used
+            return false;
+        }
+    }
+};
+
+} // namespace detail
+
+/// Parse MessagePack emitting the same events as rapidjson::Reader. The
+/// strings given to the handler are not null terminated.
+/// @tparam Handler rapidjson SAX handler
+/// @param data [in] encoded document
+/// @param size [in] size of data in bytes
+/// @param h [in] handler for the events
+/// @return whether data was a single valid document accepted by the handler
+template<typename Handler>
+inline bool parse(const char* data, std::size_t size, Handler& h)
+{
+    detail::Parser p{data, size};
+    return p.value(h, 0) && p.done();
+}
+
+/// Convert json to MessagePack
+/// @param json [in] json document
+/// @return MessagePack or empty string if json is not valid
+inline std::string fromJson(const std::string& json)
+{
+    Writer w;
+    rapidjson::Reader reader;
+    rapidjson::StringStream s{json.c_str()};
+    if (!reader.Parse(s, w)) return "";
+    return w.str();
+}
+
+/// Convert MessagePack to json
+/// @param data [in] MessagePack document
+/// @return json or empty string if data is not valid
+inline std::string toJson(const std::string& data)
+{
+    rapidjson::StringBuffer s;
+    rapidjson::Writer<rapidjson::StringBuffer> w{s};
+    if (!parse(data.data(), data.size(), w)) return "";
+    return s.GetString();
+}
+
+} // namespace msgpack
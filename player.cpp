@@ -1,7 +1,7 @@
 #include "player.hpp"
 
 #include "bid.hpp"
-#include "dice.hpp"
+#include "msgpack.hpp"
 
 #include <rapidjson/document.h>
 #include <rapidjson/prettywriter.h>
@@ -10,13 +10,14 @@
 
 namespace dice {
 
-void Player::roll()
+const int* Player::roll(const int* faces)
 {
     for (auto& d : hand_)
     {
-        d = Dice::instance().roll();
+        d = *faces++;
     }
     bid_ = {};
+    return faces;
 }
 
 void Player::bid(const Bid& bid)
@@ -30,19 +31,21 @@ void Player::remove(std::size_t adjustment)
     hand_.resize(size - std::min(size, adjustment));
 }
 
-void Player::serialize(rapidjson::PrettyWriter<rapidjson::StringBuffer>& w, const std::string& player) const
+template<typename Writer>
+void Player::serialize(Writer& w, const std::string& player) const
 {
     doSerialize(w, player.empty() ? nullptr : &player, nullptr);
 }
     
-void Player::serialize(rapidjson::PrettyWriter<rapidjson::StringBuffer>& w,
-                const std::tuple<int, bool, bool>& result) const
+template<typename Writer>
+void Player::serialize(Writer& w, const std::tuple<int, bool, bool>& result) const
 {
     doSerialize(w, nullptr, &result);
 }
 
+template<typename Writer>
 void Player::doSerialize(
-    rapidjson::PrettyWriter<rapidjson::StringBuffer>& w,
+    Writer& w,
     const std::string* player,
     const std::tuple<int, bool, bool>* result) const
 {
@@ -84,4 +87,9 @@ Player Player::fromJson(const rapidjson::Value& v)
     return player;
 }
 
+template void Player::serialize(json::Writer&, const std::string&) const;
+template void Player::serialize(msgpack::Writer&, const std::string&) const;
+template void Player::serialize(json::Writer&, const std::tuple<int, bool, bool>&) const;
+template void Player::serialize(msgpack::Writer&, const std::tuple<int, bool, bool>&) const;
+
 } // namespace dice
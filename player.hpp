@@ -6,8 +6,6 @@
 
 namespace dice {
 
-class IDice;
-
 class Player
 {
     std::string name_;
@@ -55,8 +53,11 @@ public:
     /// @return if the player is still in the game
     bool isPlaying() const { return !hand_.empty(); }
 
-    /// Roll the dice
-    void roll();
+    /// Roll the dice, i.e., take new faces for all the dice in hand and
+    /// clear the bid
+    /// @param faces [in] new faces, at least as many as there are dice
+    /// @return pointer to the first face not used
+    const int* roll(const int* faces);
 
     /// Make a bid
     void bid(const Bid& bid);
@@ -67,13 +68,14 @@ public:
     /// Serailize given player
     /// @param w [out] serialized here
     /// @param player [in] player whose dice are shown
-    void serialize(rapidjson::PrettyWriter<rapidjson::StringBuffer>& w, const std::string& player) const;
+    template<typename Writer>
+    void serialize(Writer& w, const std::string& player) const;
 
     /// Serialize players taking into accout result of the round
     /// @param w [out] seriliazed here
     /// @param result [in] results of the round
-    void serialize(rapidjson::PrettyWriter<rapidjson::StringBuffer>& w,
-                   const std::tuple<int, bool, bool>& result) const;
+    template<typename Writer>
+    void serialize(Writer& w, const std::tuple<int, bool, bool>& result) const;
 
     /// Read player from json
     /// @param v [in] where to read from
@@ -82,8 +84,9 @@ public:
     static Player fromJson(const rapidjson::Value& v);
 
 private:
+    template<typename Writer>
     void doSerialize(
-        rapidjson::PrettyWriter<rapidjson::StringBuffer>& w,
+        Writer& w,
         const std::string* player,
         const std::tuple<int, bool, bool>* result) const;
 };
@@ -0,0 +1,96 @@
+#include "playerid.hpp"
+
+#include <unistd.h>
+#ifdef __APPLE__
+#include <sys/random.h> // getentropy
+#endif
+
+#include <cerrno>
+#include <system_error>
+
+namespace dice {
+
+namespace {
+
+constexpr char HEX[] = "0123456789abcdef";
+
+bool isDash(std::size_t i) { return i == 8 || i == 13 || i == 18 || i == 23; }
+
+int hexValue(char c)
+{
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+} // unnamed namespace
+
+PlayerId PlayerId::generate()
+{
+    // The ids are the credentials of the players, so they come from the
+    // kernel CSPRNG. A fast generator could be recovered from a few ids
+    // and predict the ids of the other players.
+    // getentropy is on both glibc and macOS and fills up to 256 bytes in
+    // one call.
+    std::uint64_t bits[2];
+    static_assert(sizeof(bits) <= 256, "getentropy limit");
+    if (::getentropy(bits, sizeof(bits)) != 0)
+    {
+        throw std::system_error{errno, std::generic_category(), "getentropy"};
+    }
+    // Version 4 (random) and variant 1
+    return PlayerId{(bits[0] & ~std::uint64_t{0xf000}) | 0x4000,
+                    (bits[1] & ~(std::uint64_t{3} << 62)) | (std::uint64_t{2} << 62)};
+}
+
+PlayerId PlayerId::fromString(std::experimental::string_view str)
+{
+    if (str.size() != LENGTH) return PlayerId{};
+    std::uint64_t halves[2] = {0, 0};
+    std::size_t digits = 0;
+    for (std::size_t i = 0; i < LENGTH; ++i)
+    {
+        if (isDash(i))
+        {
+            if (str[i] != '-') return PlayerId{};
+            continue;
+        }
+        const auto v = hexValue(str[i]);
+        if (v < 0) return PlayerId{};
+        auto& half = halves[digits / 16];
+        half = (half << 4) | static_cast<std::uint64_t>(v);
+        ++digits;
+    }
+    return PlayerId{halves[0], halves[1]};
+}
+
+void PlayerId::format(char* out) const
+{
+    int shift = 60;
+    const std::uint64_t* half = &hi_;
+    for (std::size_t i = 0; i < LENGTH; ++i)
+    {
+        if (isDash(i))
+        {
+            out[i] = '-';
+            continue;
+        }
+        out[i] = HEX[(*half >> shift) & 0xf];
+        shift -= 4;
+        if (shift < 0)
+        {
+            shift = 60;
+            half = &lo_;
+        }
+    }
+}
+
+std::string PlayerId::str() const
+{
+    std::string s(LENGTH, '\0');
+    format(&s[0]);
+    return s;
+}
+
+} // namespace dice
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <experimental/string_view>
+#include <functional>
+#include <string>
+
+namespace dice {
+
+/// 128-bit player id. The id is formatted as a version 4 UUID, e.g.,
+/// 6a4bd0c5-7a4c-4b0c-9d8e-2f6e0b7c1d3a, only at the API and in the saved
+/// state. Internally it is two integers so that it is cheap to hash and
+/// compare.
+class PlayerId
+{
+    std::uint64_t hi_;
+    std::uint64_t lo_;
+public:
+    /// Length of the formatted id
+    static constexpr std::size_t LENGTH = 36;
+
+    /// Construct nil id that never identifies a player
+    PlayerId() : hi_{}, lo_{} {}
+
+    /// Construct PlayerId
+    /// @param hi [in] the first 64 bits
+    /// @param lo [in] the last 64 bits
+    PlayerId(std::uint64_t hi, std::uint64_t lo) : hi_{hi}, lo_{lo} {}
+
+    /// Generate a new random id from the kernel CSPRNG. Thread-safe.
+    /// @return version 4 UUID
+    /// @throws std::system_error if the kernel has no random bytes to give
+    static PlayerId generate();
+
+    /// Parse the formatted id. Both lower and upper case hex digits are
+    /// accepted.
+    /// @param str [in] UUID with the dashes
+    /// @return the id or nil id if str is not a UUID
+    static PlayerId fromString(std::experimental::string_view str);
+
+    /// Format the id as lower case UUID
+    /// @param out [out] LENGTH characters are written here, no terminating
+    ///     null
+    void format(char* out) const;
+
+    /// @return the id formatted as UUID
+    std::string str() const;
+
+    /// @return whether this is the nil id
+    bool nil() const { return hi_ == 0 && lo_ == 0; }
+
+    auto hi() const { return hi_; }
+    auto lo() const { return lo_; }
+
+    bool operator==(const PlayerId& other) const { return hi_ == other.hi_ && lo_ == other.lo_; }
+    bool operator!=(const PlayerId& other) const { return !(*this == other); }
+    /// Same order as the formatted ids
+    bool operator<(const PlayerId& other) const
+    {
+        return hi_ < other.hi_ || (hi_ == other.hi_ && lo_ < other.lo_);
+    }
+};
+
+} // namespace dice
+
+namespace std {
+
+template<>
+struct hash<dice::PlayerId>
+{
+    std::size_t operator()(const dice::PlayerId& id) const
+    {
+        // The bits are random so mixing the halves is enough
+        return static_cast<std::size_t>(id.hi() ^ (id.lo() * 0x9e3779b97f4a7c15ull));
+    }
+};
+
+} // namespace std
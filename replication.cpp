@@ -0,0 +1,349 @@
+#include "replication.hpp"
+
+#include "engine.hpp"
+#include "frame.hpp"
+
+#include <boost/asio.hpp>
+
+#include <sys/socket.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace dice {
+
+namespace asio = boost::asio;
+using asio::local::stream_protocol;
+
+namespace {
+
+// Entries queued for a follower before it is considered lost
+constexpr std::size_t MAX_BACKLOG = 100000;
+
+// Wake up the threads blocked on the socket. Closing the socket from another
+// thread is not safe, shutting it down is.
+template<typename Socket>
+void shutdown(Socket& socket)
+{
+    ::shutdown(socket.native_handle(), SHUT_RDWR);
+}
+
+} // unnamed namespace
+
+struct Replicator::Impl
+{
+    struct Connection
+    {
+        explicit Connection(stream_protocol::socket s)
+          : socket{std::move(s)}, queue{}, closed{false}, thread{}
+        {
+        }
+
+        stream_protocol::socket socket;
+        // Guarded by Impl::mutex_
+        std::deque<std::string> queue;
+        bool closed;
+        std::thread thread;
+    };
+
+    Engine& engine_;
+    const std::string path_;
+    asio::io_service io_;
+    stream_protocol::acceptor acceptor_;
+    mutable std::mutex mutex_;
+    std::condition_variable cv_;
+    std::vector<std::unique_ptr<Connection>> connections_;
+    bool stop_;
+    std::uint64_t entries_;
+    std::thread acceptor_thread_;
+
+    Impl(Engine& engine, const std::string& path)
+      : engine_{engine},
+        path_{path},
+        io_{},
+        acceptor_{io_},
+        mutex_{},
+        cv_{},
+        connections_{},
+        stop_{false},
+        entries_{0},
+        acceptor_thread_{}
+    {
+        std::remove(path.c_str());
+        try {
+            acceptor_.open(stream_protocol{});
+            acceptor_.bind(stream_protocol::endpoint{path});
+            acceptor_.listen();
+        }
+        catch (const boost::system::system_error& e) {
+            throw std::runtime_error(path + ": " + e.what());
+        }
+    }
+
+    void accept()
+    {
+        for (;;)
+        {
+            stream_protocol::socket socket{io_};
+            boost::system::error_code ec;
+            acceptor_.accept(socket, ec);
+            std::unique_lock<std::mutex> lock{mutex_};
+            if (stop_) return;
+            if (ec) continue;
+            reap();
+            connections_.push_back(std::make_unique<Connection>(std::move(socket)));
+            auto* c = connections_.back().get();
+            lock.unlock();
+
+            // The snapshot has the changes pushed so far, the ones pushed
+            // after it follow it in the queue
+            engine_.snapshot([this, c](std::string state)
+            {
+                std::lock_guard<std::mutex> guard{mutex_};
+                c->queue.clear();
+                c->queue.push_back(std::move(state));
+            });
+            c->thread = std::thread{[this, c] { send(*c); }};
+        }
+    }
+
+    void send(Connection& c)
+    {
+        std::unique_lock<std::mutex> lock{mutex_};
+        for (;;)
+        {
+            cv_.wait(lock, [&c] { return c.closed || !c.queue.empty(); });
+            if (c.closed) return;
+            const auto entry = std::move(c.queue.front());
+            c.queue.pop_front();
+            lock.unlock();
+            try {
+                writeFrame(c.socket, entry);
+                lock.lock();
+            }
+            catch (const boost::system::system_error&) {
+                lock.lock();
+                c.closed = true;
+                c.queue.clear();
+                return;
+            }
+        }
+    }
+
+    // Join the threads of the lost followers. Called with the mutex locked.
+    void reap()
+    {
+        for (auto it = connections_.begin(); it != connections_.end();)
+        {
+            auto& c = **it;
+            if (!c.closed || !c.thread.joinable())
+            {
+                ++it;
+                continue;
+            }
+            c.thread.join();
+            it = connections_.erase(it);
+        }
+    }
+};
+
+Replicator::Replicator(Engine& engine, const std::string& path)
+  : impl_{std::make_unique<Impl>(engine, path)}
+{
+    engine.setReplicator(this);
+    impl_->acceptor_thread_ = std::thread{[this] { impl_->accept(); }};
+}
+
+Replicator::~Replicator()
+{
+    impl_->engine_.setReplicator(nullptr);
+    {
+        std::lock_guard<std::mutex> lock{impl_->mutex_};
+        impl_->stop_ = true;
+        for (auto& c : impl_->connections_)
+        {
+            c->closed = true;
+            shutdown(c->socket);
+        }
+    }
+    impl_->cv_.notify_all();
+    // Wake the accept with a connection, shutting down a listening socket
+    // only interrupts it on Linux. The shutdown is kept for when the socket
+    // file has been removed.
+    try {
+        stream_protocol::socket wake{impl_->io_};
+        wake.connect(stream_protocol::endpoint{impl_->path_});
+    }
+    catch (const boost::system::system_error&) {}
+    shutdown(impl_->acceptor_);
+    impl_->acceptor_thread_.join();
+    for (auto& c : impl_->connections_)
+    {
+        if (c->thread.joinable()) c->thread.join();
+    }
+}
+
+void Replicator::push(std::string entry)
+{
+    {
+        std::lock_guard<std::mutex> lock{impl_->mutex_};
+        ++impl_->entries_;
+        for (auto& c : impl_->connections_)
+        {
+            if (c->closed) continue;
+            if (c->queue.size() >= MAX_BACKLOG)
+            {
+                // Too far behind, it gets a new snapshot when it reconnects
+                c->closed = true;
+                c->queue.clear();
+                shutdown(c->socket);
+                continue;
+            }
+            c->queue.push_back(entry);
+        }
+    }
+    impl_->cv_.notify_all();
+}
+
+std::size_t Replicator::followers() const
+{
+    std::lock_guard<std::mutex> lock{impl_->mutex_};
+    std::size_t n = 0;
+    for (const auto& c : impl_->connections_) n += c->closed ? 0u : 1u;
+    return n;
+}
+
+std::uint64_t Replicator::entries() const
+{
+    std::lock_guard<std::mutex> lock{impl_->mutex_};
+    return impl_->entries_;
+}
+
+struct Follower::Impl
+{
+    Engine& engine_;
+    const std::string path_;
+    asio::io_service io_;
+    mutable std::mutex mutex_;
+    std::condition_variable cv_;
+    // The current connection, for promote to interrupt the read
+    stream_protocol::socket* socket_;
+    bool promoted_;
+    bool connected_;
+    std::uint64_t applied_;
+    std::thread thread_;
+
+    Impl(Engine& engine, const std::string& path)
+      : engine_{engine},
+        path_{path},
+        io_{},
+        mutex_{},
+        cv_{},
+        socket_{},
+        promoted_{false},
+        connected_{false},
+        applied_{0},
+        thread_{}
+    {
+    }
+
+    void run()
+    {
+        std::unique_lock<std::mutex> lock{mutex_};
+        while (!promoted_)
+        {
+            stream_protocol::socket socket{io_};
+            lock.unlock();
+            try {
+                socket.connect(stream_protocol::endpoint{path_});
+                if (attach(socket)) follow(socket);
+            }
+            catch (const std::exception&) {
+                // Lost the primary, retry until promoted
+            }
+            lock.lock();
+            socket_ = nullptr;
+            connected_ = false;
+            cv_.wait_for(lock, std::chrono::milliseconds{100}, [this] { return promoted_; });
+        }
+    }
+
+    // Make the connection interruptible by promote
+    bool attach(stream_protocol::socket& socket)
+    {
+        std::lock_guard<std::mutex> lock{mutex_};
+        if (promoted_) return false;
+        socket_ = &socket;
+        return true;
+    }
+
+    void follow(stream_protocol::socket& socket)
+    {
+        for (bool snapshot = true;; snapshot = false)
+        {
+            const auto frame = readFrame(socket);
+            std::lock_guard<std::mutex> lock{mutex_};
+            if (promoted_) return;
+            const auto ok = snapshot ? engine_.restore(frame) : engine_.apply(frame);
+            if (!ok) throw std::runtime_error("INVALID_ENTRY");
+            connected_ = true;
+            ++applied_;
+        }
+    }
+};
+
+Follower::Follower(Engine& engine, const std::string& path)
+  : impl_{std::make_unique<Impl>(engine, path)}
+{
+    impl_->thread_ = std::thread{[this] { impl_->run(); }};
+}
+
+Follower::~Follower()
+{
+    {
+        std::lock_guard<std::mutex> lock{impl_->mutex_};
+        impl_->promoted_ = true;
+        if (impl_->socket_) shutdown(*impl_->socket_);
+    }
+    impl_->cv_.notify_all();
+    if (impl_->thread_.joinable()) impl_->thread_.join();
+}
+
+void Follower::promote()
+{
+    {
+        std::lock_guard<std::mutex> lock{impl_->mutex_};
+        if (impl_->promoted_) return;
+        impl_->promoted_ = true;
+        if (impl_->socket_) shutdown(*impl_->socket_);
+    }
+    impl_->cv_.notify_all();
+    impl_->thread_.join();
+    impl_->engine_.promote();
+}
+
+bool Follower::promoted() const
+{
+    std::lock_guard<std::mutex> lock{impl_->mutex_};
+    return impl_->promoted_;
+}
+
+bool Follower::connected() const
+{
+    std::lock_guard<std::mutex> lock{impl_->mutex_};
+    return impl_->connected_;
+}
+
+std::uint64_t Follower::applied() const
+{
+    std::lock_guard<std::mutex> lock{impl_->mutex_};
+    return impl_->applied_;
+}
+
+} // namespace dice
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace dice {
+
+class Engine;
+
+/// Streams the changes of a primary engine to hot-standby followers over a
+/// Unix domain socket. A follower that connects gets a snapshot of the
+/// whole state followed by the log of the changes, as frames (see
+/// frame.hpp) of json in the format of the saved state: every entry holds
+/// the players and games changed by one call in full, and the removed ones
+/// with "removed": true. Entries are sent as soon as the call returns, so
+/// a follower is behind by the network round trip. A follower that falls
+/// too far behind is disconnected and gets a new snapshot when it
+/// reconnects.
+class Replicator
+{
+    struct Impl;
+    std::unique_ptr<Impl> impl_;
+public:
+    /// Start listening and attach to the engine
+    /// @param engine [in,out] the primary engine
+    /// @param path [in] path of the socket, an old socket file is removed
+    /// @throws std::runtime_error if the socket cannot be set up
+    Replicator(Engine& engine, const std::string& path);
+
+    /// Detach from the engine and disconnect the followers
+    ~Replicator();
+
+    Replicator(Replicator&&) = delete;
+
+    /// Queue an entry for the followers. Called by the engine with its
+    /// mutex locked, so the entries are in the order of the changes.
+    /// @param entry [in] the changes of one call
+    void push(std::string entry);
+
+    /// @return number of connected followers
+    std::size_t followers() const;
+
+    /// @return number of entries pushed
+    std::uint64_t entries() const;
+};
+
+/// Keeps a standby engine up to date with a primary served by Replicator
+/// until promoted. Reconnects when the connection is lost.
+class Follower
+{
+    struct Impl;
+    std::unique_ptr<Impl> impl_;
+public:
+    /// Start following
+    /// @param engine [in,out] the standby engine, its state is replaced
+    /// @param path [in] path of the socket of the Replicator
+    Follower(Engine& engine, const std::string& path);
+
+    /// Stop following
+    ~Follower();
+
+    Follower(Follower&&) = delete;
+
+    /// Stop following so that the engine can take the writes. Entries not
+    /// received yet are lost. Thread-safe.
+    void promote();
+
+    /// @return whether promote() has been called
+    bool promoted() const;
+
+    /// @return whether a snapshot has been received on the current
+    ///     connection
+    bool connected() const;
+
+    /// @return number of entries applied, the snapshots included
+    std::uint64_t applied() const;
+};
+
+} // namespace dice
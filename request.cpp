@@ -0,0 +1,174 @@
+#include "request.hpp"
+
+#include "json.hpp"
+#include "msgpack.hpp"
+
+#include <rapidjson/reader.h>
+
+#include <climits>
+#include <cstring>
+#include <vector>
+
+namespace dice {
+
+namespace {
+
+// Per-thread state reused by every decode
+struct Decoder
+{
+    // Copy of the body. Parsing in situ writes the decoded strings here.
+    std::vector<char> buffer;
+    rapidjson::Reader reader;
+};
+
+thread_local Decoder decoder;
+
+// Field for the key or 0 if the key is not known
+unsigned field(const char* key, rapidjson::SizeType length)
+{
+    switch (length)
+    {
+    case 1:
+        return key[0] == 'n' ? Request::N : 0;
+    case 2:
+        return std::memcmp(key, "id", 2) == 0 ? Request::ID : 0;
+    case 4:
+        if (std::memcmp(key, "game", 4) == 0) return Request::GAME;
+        if (std::memcmp(key, "name", 4) == 0) return Request::NAME;
+        if (std::memcmp(key, "face", 4) == 0) return Request::FACE;
+        if (std::memcmp(key, "hash", 4) == 0) return Request::HASH;
+        return 0;
+    case 5:
+        return std::memcmp(key, "since", 5) == 0 ? Request::SINCE : 0;
+    default:
+        return 0;
+    }
+}
+
+// Fills Request with the given fields from the members of the root object.
+// Returning false stops the parsing.
+template<unsigned Fields>
+class Handler : public rapidjson::BaseReaderHandler<rapidjson::UTF8<>, Handler<Fields>>
+{
+    static constexpr unsigned STRINGS = Fields & (Request::ID | Request::GAME | Request::NAME);
+    static constexpr unsigned INTS = Fields & (Request::N | Request::FACE | Request::HASH | Request::SINCE);
+
+    Request& r_;
+    unsigned depth_;
+    // Field of the current member of the root object, 0 if not wanted
+    unsigned current_;
+
+    bool nested()
+    {
+        // The wanted fields are scalars
+        if (depth_ == 0 || current_ != 0) return false;
+        ++depth_;
+        return true;
+    }
+
+    bool setInt(int i)
+    {
+        if (depth_ == 0 || (current_ & STRINGS)) return false;
+        if (current_ & INTS)
+        {
+            if (current_ == Request::N) r_.n = i;
+            else if (current_ == Request::FACE) r_.face = i;
+            else if (current_ == Request::HASH) r_.hash = i;
+            else r_.since = i;
+            r_.fields |= current_;
+        }
+        return true;
+    }
+
+public:
+    explicit Handler(Request& r) : r_(r), depth_{}, current_{} {}
+
+    // null, bool, doubles and 64-bit integers
+    bool Default() { return depth_ > 0 && current_ == 0; }
+
+    bool Int(int i) { return setInt(i); }
+    bool Uint(unsigned u) { return u <= INT_MAX ? setInt(static_cast<int>(u)) : Default(); }
+
+    bool String(const char* str, rapidjson::SizeType length, bool)
+    {
+        if (depth_ == 0 || (current_ & INTS)) return false;
+        if (current_ & STRINGS)
+        {
+            const std::experimental::string_view v{str, length};
+            if (current_ == Request::ID) r_.id = v;
+            else if (current_ == Request::GAME) r_.game = v;
+            else r_.name = v;
+            r_.fields |= current_;
+        }
+        return true;
+    }
+
+    bool Key(const char* str, rapidjson::SizeType length, bool)
+    {
+        current_ = depth_ == 1 ? field(str, length) & Fields : 0;
+        return true;
+    }
+
+    bool StartObject()
+    {
+        if (depth_ == 0)
+        {
+            depth_ = 1;
+            return true;
+        }
+        return nested();
+    }
+
+    bool EndObject(rapidjson::SizeType)
+    {
+        --depth_;
+        current_ = 0;
+        return true;
+    }
+
+    bool StartArray() { return nested(); }
+
+    bool EndArray(rapidjson::SizeType)
+    {
+        --depth_;
+        current_ = 0;
+        return true;
+    }
+};
+
+} // unnamed namespace
+
+void Request::require(unsigned f) const
+{
+    if (!has(f)) throw json::ParseError{};
+}
+
+template<unsigned Fields>
+Request decodeRequest(const std::string& body, Format format)
+{
+    auto& d = decoder;
+    d.buffer.assign(body.begin(), body.end());
+    d.buffer.push_back('\0');
+
+    Request r;
+    Handler<Fields> handler{r};
+    if (format == Format::MSGPACK)
+    {
+        if (!msgpack::parse(d.buffer.data(), body.size(), handler)) throw json::ParseError{};
+        return r;
+    }
+    rapidjson::InsituStringStream s{d.buffer.data()};
+    if (!d.reader.Parse<rapidjson::kParseInsituFlag>(s, handler)) throw json::ParseError{};
+    return r;
+}
+
+template Request decodeRequest<Request::LOGIN>(const std::string&, Format);
+template Request decodeRequest<Request::SHARD_LOGIN>(const std::string&, Format);
+template Request decodeRequest<Request::PLAYER>(const std::string&, Format);
+template Request decodeRequest<Request::JOIN>(const std::string&, Format);
+template Request decodeRequest<Request::BID>(const std::string&, Format);
+template Request decodeRequest<Request::STATUS>(const std::string&, Format);
+template Request decodeRequest<Request::HISTORY>(const std::string&, Format);
+template Request decodeRequest<Request::ALL>(const std::string&, Format);
+
+} // namespace dice
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <experimental/string_view>
+#include <string>
+
+namespace dice {
+
+/// Encoding of request and response bodies
+enum class Format
+{
+    JSON,
+    /// MessagePack with the same keys and values as json
+    MSGPACK
+};
+
+/// Fields of an API request body. The strings point to the calling
+/// thread's decoding buffer and are valid until the next call to
+/// decodeRequest on the same thread.
+struct Request
+{
+    /// Bits for the fields
+    enum Field : unsigned
+    {
+        ID = 1 << 0,
+        GAME = 1 << 1,
+        NAME = 1 << 2,
+        N = 1 << 3,
+        FACE = 1 << 4,
+        HASH = 1 << 5,
+        SINCE = 1 << 6
+    };
+
+    /// Fields read by the API routes
+    enum Schema : unsigned
+    {
+        LOGIN = NAME,
+        /// Login from the shard Router, which picks the id
+        SHARD_LOGIN = NAME | ID,
+        PLAYER = ID,
+        JOIN = ID | GAME,
+        BID = ID | N | FACE,
+        STATUS = ID | HASH,
+        HISTORY = ID | SINCE,
+        ALL = ID | GAME | NAME | N | FACE | HASH | SINCE
+    };
+
+    std::experimental::string_view id;
+    std::experimental::string_view game;
+    std::experimental::string_view name;
+    int n = 0;
+    int face = 0;
+    int hash = -1;
+    int since = 0;
+    /// Fields present in the request
+    unsigned fields = 0;
+
+    /// @return whether all the given fields are present
+    bool has(unsigned f) const { return (fields & f) == f; }
+
+    /// Check that the given fields are present
+    /// @param f [in] the fields
+    /// @throws json::ParseError if any of the fields is missing
+    void require(unsigned f) const;
+};
+
+/// Decode a request body in a single pass. The body is parsed in place in
+/// a per-thread buffer with a SAX handler generated for the given fields so
+/// that decoding doesn't allocate memory once the buffer has grown to the
+/// size of typical requests. Other keys are skipped.
+/// @tparam Fields the fields to extract
+/// @param body [in] json or MessagePack object
+/// @param format [in] encoding of body
+/// @return the fields found in the body
+/// @throws json::ParseError if body is not an object or any of the
+///     fields has an unexpected type
+template<unsigned Fields = Request::ALL>
+Request decodeRequest(const std::string& body, Format format = Format::JSON);
+
+extern template Request decodeRequest<Request::LOGIN>(const std::string&, Format);
+extern template Request decodeRequest<Request::SHARD_LOGIN>(const std::string&, Format);
+extern template Request decodeRequest<Request::PLAYER>(const std::string&, Format);
+extern template Request decodeRequest<Request::JOIN>(const std::string&, Format);
+extern template Request decodeRequest<Request::BID>(const std::string&, Format);
+extern template Request decodeRequest<Request::STATUS>(const std::string&, Format);
+extern template Request decodeRequest<Request::HISTORY>(const std::string&, Format);
+extern template Request decodeRequest<Request::ALL>(const std::string&, Format);
+
+} // namespace dice
@@ -0,0 +1,146 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <random>
+
+namespace dice {
+
+/// xoshiro256** by David Blackman and Sebastiano Vigna. Small, fast and
+/// statistically strong generator. Satisfies UniformRandomBitGenerator so
+/// it can be used with the standard distributions, too.
+class Xoshiro256
+{
+    std::uint64_t s_[4];
+
+    static std::uint64_t rotl(std::uint64_t x, int k)
+    {
+        return (x << k) | (x >> (64 - k));
+    }
+
+    static std::uint64_t splitmix64(std::uint64_t& x)
+    {
+        std::uint64_t z = (x += 0x9e3779b97f4a7c15ULL);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+        return z ^ (z >> 31);
+    }
+
+public:
+    using result_type = std::uint64_t;
+
+    /// Construct generator. The state is expanded from the seed with
+    /// splitmix64 so that similar seeds give unrelated sequences.
+    /// @param value [in] seed
+    explicit Xoshiro256(std::uint64_t value = 0) { seed(value); }
+
+    /// Reset the state
+    /// @param value [in] seed
+    void seed(std::uint64_t value)
+    {
+        for (auto& s : s_) s = splitmix64(value);
+    }
+
+    static constexpr result_type min() { return 0; }
+    static constexpr result_type max() { return std::numeric_limits<result_type>::max(); }
+
+    /// @return next 64 random bits
+    result_type operator()()
+    {
+        const auto result = rotl(s_[1] * 5, 7) * 9;
+        const auto t = s_[1] << 17;
+        s_[2] ^= s_[0];
+        s_[3] ^= s_[1];
+        s_[1] ^= s_[2];
+        s_[0] ^= s_[3];
+        s_[2] ^= t;
+        s_[3] = rotl(s_[3], 45);
+        return result;
+    }
+
+    /// Skip the given number of outputs
+    /// @param n [in] number of outputs to skip
+    void discard(std::uint64_t n)
+    {
+        for (; n > 0; --n) (*this)();
+    }
+
+    /// Advance the state by 2^128 steps. Calling jump() k times on copies
+    /// of the same generator gives k non-overlapping streams for threads.
+    void jump()
+    {
+        static const std::uint64_t JUMP[] = {
+            0x180ec6d33cfd0abaULL, 0xd5a61266f0c9392cULL,
+            0xa9582618e03fc9aaULL, 0x39abdc4529b1661cULL
+        };
+        std::uint64_t s[4] = {};
+        for (auto j : JUMP)
+        {
+            for (int b = 0; b < 64; ++b)
+            {
+                if (j & (std::uint64_t{1} << b))
+                {
+                    for (int i = 0; i < 4; ++i) s[i] ^= s_[i];
+                }
+                (*this)();
+            }
+        }
+        for (int i = 0; i < 4; ++i) s_[i] = s[i];
+    }
+
+    /// Equality operator
+    bool operator==(const Xoshiro256& other) const
+    {
+        return s_[0] == other.s_[0] && s_[1] == other.s_[1] &&
+               s_[2] == other.s_[2] && s_[3] == other.s_[3];
+    }
+};
+
+/// @return generator owned by the calling thread, seeded from
+///     std::random_device on first use
+inline Xoshiro256& threadRng()
+{
+    thread_local Xoshiro256 rng{(std::uint64_t{std::random_device{}()} << 32) ^
+                                std::random_device{}()};
+    return rng;
+}
+
+/// Fill the given range with dice faces [1, 6]. Every 64-bit output gives
+/// two dice using Lemire's multiply-shift with rejection so the faces are
+/// exactly uniform. The loop has no division and no distribution object.
+/// @tparam T integral type of the faces
+/// @param rng [in,out] the generator
+/// @param first [out] where to store the faces
+/// @param n [in] number of dice
+/// @return number of 64-bit outputs consumed from the generator
+template<typename T>
+inline std::uint64_t fillDice(Xoshiro256& rng, T* first, std::size_t n)
+{
+    // 2^32 % 6: products whose low half falls below this are biased
+    constexpr std::uint32_t threshold = 4;
+    std::uint64_t outputs = 0;
+    std::size_t i = 0;
+    while (i < n)
+    {
+        const auto r = rng();
+        ++outputs;
+        const std::uint64_t m0 = (r & 0xffffffffULL) * 6;
+        const std::uint64_t m1 = (r >> 32) * 6;
+        if (static_cast<std::uint32_t>(m0) >= threshold)
+            first[i++] = static_cast<T>((m0 >> 32) + 1);
+        if (i < n && static_cast<std::uint32_t>(m1) >= threshold)
+            first[i++] = static_cast<T>((m1 >> 32) + 1);
+    }
+    return outputs;
+}
+
+/// @return single dice face [1, 6]
+inline int rollDie(Xoshiro256& rng)
+{
+    int face;
+    fillDice(rng, &face, 1);
+    return face;
+}
+
+} // namespace dice
@@ -0,0 +1,296 @@
+#include "router.hpp"
+
+#include "hashring.hpp"
+#include "helpers.hpp"
+#include "json.hpp"
+#include "msgpack.hpp"
+#include "playerid.hpp"
+#include "shard.hpp"
+
+#include <rapidjson/document.h>
+#include <rapidjson/prettywriter.h>
+#include <rapidjson/stringbuffer.h>
+
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace dice {
+
+namespace {
+
+class RouteError : public std::runtime_error
+{
+public:
+    RouteError(const std::string& what) : std::runtime_error{what} {}
+};
+
+std::string reply(const std::string& json, Format format)
+{
+    return format == Format::MSGPACK ? msgpack::fromJson(json) : json;
+}
+
+// The response as a json document
+rapidjson::Document decode(const std::string& response, Format format)
+{
+    return parse(format == Format::MSGPACK ? msgpack::toJson(response) : response);
+}
+
+// Error of the response, empty if it succeeded
+std::string errorOf(const std::string& response, Format format)
+{
+    const auto doc = decode(response, format);
+    if (!doc.IsObject()) return "INVALID_RESPONSE";
+    if (doc.HasMember("success") && doc["success"].IsBool() && doc["success"].GetBool()) return {};
+    if (doc.HasMember("error") && doc["error"].IsString()) return doc["error"].GetString();
+    return "INVALID_RESPONSE";
+}
+
+// Whether the route finds the player by the id in the body
+bool isPlayerRoute(const std::string& route)
+{
+    static const std::unordered_set<std::string> routes{
+        "/api/status",
+        "/api/history",
+        "/api/startGame",
+        "/api/startRound",
+        "/api/bid",
+        "/api/challenge",
+        "/api/addBot",
+        "/api/batch",
+        "/api/logout",
+    };
+    return routes.count(route) > 0;
+}
+
+} // unnamed namespace
+
+struct Router::Impl
+{
+    struct Player
+    {
+        std::string name;
+        std::size_t shard;
+        // Whether the player is in a game on the shard
+        bool joined;
+    };
+
+    const HashRing ring_;
+    std::vector<std::unique_ptr<ShardClient>> shards_;
+    mutable std::mutex mutex_;
+    std::unordered_map<PlayerId, Player> players_;
+
+    explicit Impl(const std::vector<std::string>& shards)
+      : ring_{shards.size()},
+        shards_{},
+        mutex_{},
+        players_{}
+    {
+        for (const auto& path : shards) shards_.push_back(std::make_unique<ShardClient>(path));
+    }
+
+    std::string ask(std::size_t shard, const std::string& route, const std::string& body, Format format)
+    {
+        try {
+            return shards_.at(shard)->call(route, body, format);
+        }
+        catch (const std::runtime_error&) {
+            throw RouteError{"SHARD_UNAVAILABLE"};
+        }
+    }
+
+    std::string loginBody(const PlayerId& id, const std::string& name, Format format)
+    {
+        return reply(json::Json({
+            {"name", name},
+            {"id", id.str()}
+        }).str(), format);
+    }
+
+    // Shard of the player. Players the router doesn't know, e.g., after a
+    // restart, are looked for on all the shards, preferring the shard where
+    // they are in a game.
+    Player find(const PlayerId& id)
+    {
+        {
+            std::lock_guard<std::mutex> lock{mutex_};
+            const auto it = players_.find(id);
+            if (it != players_.end()) return it->second;
+        }
+        if (id.nil()) throw RouteError{"NO_PLAYER"};
+
+        const auto body = json::Json({"id", id.str()}).str();
+        bool found = false;
+        Player player{};
+        for (std::size_t s = 0; s < shards_.size() && !player.joined; ++s)
+        {
+            std::string response;
+            try {
+                response = ask(s, "/api/status", body, Format::JSON);
+            }
+            catch (const RouteError&) {
+                continue;
+            }
+            if (!errorOf(response, Format::JSON).empty()) continue;
+            const auto doc = decode(response, Format::JSON);
+            found = true;
+            player = Player{json::getString(doc, "name"), s, doc.HasMember("game")};
+        }
+        if (!found) throw RouteError{"NO_PLAYER"};
+
+        std::lock_guard<std::mutex> lock{mutex_};
+        return players_.emplace(id, player).first->second;
+    }
+
+    std::string login(const std::string& body, Format format)
+    {
+        const auto req = decodeRequest<Request::LOGIN>(body, format);
+        req.require(Request::NAME);
+        if (req.name.empty()) throw RouteError{"INVALID_NAME"};
+        const auto name = req.name.to_string();
+        const auto id = PlayerId::generate();
+        const auto shard = ring_.shard(name);
+
+        auto response = ask(shard, "/api/login", loginBody(id, name, format), format);
+        if (errorOf(response, format).empty())
+        {
+            std::lock_guard<std::mutex> lock{mutex_};
+            players_[id] = Player{name, shard, false};
+        }
+        return response;
+    }
+
+    // newGame and join: the player follows the game to its shard
+    std::string join(const std::string& route, const std::string& body, Format format)
+    {
+        const auto req = decodeRequest<Request::JOIN>(body, format);
+        req.require(Request::ID | Request::GAME);
+        const auto id = PlayerId::fromString(req.id);
+        const auto shard = ring_.shard(req.game.to_string());
+        const auto player = find(id);
+
+        if (player.shard != shard)
+        {
+            if (player.joined) throw RouteError{"ALREADY_JOINED"};
+            const auto response = ask(shard, "/api/login", loginBody(id, player.name, format), format);
+            if (!errorOf(response, format).empty()) return response;
+        }
+
+        auto response = ask(shard, route, body, format);
+        if (errorOf(response, format).empty())
+        {
+            std::lock_guard<std::mutex> lock{mutex_};
+            players_[id] = Player{player.name, shard, true};
+        }
+        return response;
+    }
+
+    std::string forward(const std::string& route, const std::string& body, Format format)
+    {
+        const auto req = decodeRequest<Request::PLAYER>(body, format);
+        req.require(Request::ID);
+        const auto id = PlayerId::fromString(req.id);
+        const auto player = find(id);
+
+        auto response = ask(player.shard, route, body, format);
+        const auto error = errorOf(response, format);
+        std::lock_guard<std::mutex> lock{mutex_};
+        // Expired on the shard
+        if (error == "NO_PLAYER") players_.erase(id);
+        if (route == "/api/logout" && error.empty())
+        {
+            const auto it = players_.find(id);
+            if (it != players_.end()) it->second.joined = false;
+        }
+        return response;
+    }
+
+    // Games of the reachable shards
+    std::string games()
+    {
+        rapidjson::StringBuffer s;
+        rapidjson::PrettyWriter<rapidjson::StringBuffer> w{s};
+        json::ArrayW(w, [this](auto& w)
+        {
+            for (std::size_t shard = 0; shard < shards_.size(); ++shard)
+            {
+                try {
+                    const auto doc = parse(ask(shard, "/api/games", "", Format::JSON));
+                    if (!doc.IsArray()) continue;
+                    for (const auto& game : doc.GetArray()) game.Accept(w);
+                }
+                catch (const RouteError&) {
+                }
+            }
+        });
+        return s.GetString();
+    }
+
+    // Sums of the counters of the shards
+    std::string metrics()
+    {
+        std::map<std::string, std::uint64_t> sums;
+        int unavailable = 0;
+        for (std::size_t shard = 0; shard < shards_.size(); ++shard)
+        {
+            try {
+                const auto doc = parse(ask(shard, "/api/metrics", "", Format::JSON));
+                if (!doc.IsObject()) continue;
+                for (const auto& kv : doc.GetObject())
+                {
+                    if (kv.value.IsUint64()) sums[kv.name.GetString()] += kv.value.GetUint64();
+                }
+            }
+            catch (const RouteError&) {
+                ++unavailable;
+            }
+        }
+        std::size_t routed = 0;
+        {
+            std::lock_guard<std::mutex> lock{mutex_};
+            routed = players_.size();
+        }
+
+        rapidjson::StringBuffer s;
+        rapidjson::PrettyWriter<rapidjson::StringBuffer> w{s};
+        json::Object(w, [&](auto& w)
+        {
+            for (const auto& kv : sums) json::KeyValue(w, kv.first, kv.second);
+            json::KeyValue(w, "shards", static_cast<int>(shards_.size()));
+            json::KeyValue(w, "unavailableShards", unavailable);
+            json::KeyValue(w, "routedPlayers", static_cast<std::uint64_t>(routed));
+        });
+        return s.GetString();
+    }
+};
+
+Router::Router(const std::vector<std::string>& shards)
+  : impl_{std::make_unique<Impl>(shards)}
+{
+}
+
+Router::~Router() = default;
+
+std::string Router::call(const std::string& route, const std::string& body, Format format) noexcept
+{
+    try {
+        if (route == "/api/login") return impl_->login(body, format);
+        if (route == "/api/newGame" || route == "/api/join") return impl_->join(route, body, format);
+        if (route == "/api/games") return impl_->games();
+        if (route == "/api/metrics") return impl_->metrics();
+        if (isPlayerRoute(route)) return impl_->forward(route, body, format);
+        return reply(Error{"UNKNOWN_ROUTE"}, format);
+    } catch (const std::exception& e) {
+        return reply(Error{e.what()}, format);
+    }
+}
+
+std::size_t Router::shard(const std::string& game) const
+{
+    return impl_->ring_.shard(game);
+}
+
+} // namespace dice
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "request.hpp" // Format
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace dice {
+
+/// Forwards the API calls to engine processes (shards) each holding a part
+/// of the games. A game lives on the shard given by a consistent hash of its
+/// name, see HashRing.
+///
+/// The router picks the player ids and remembers the shard of every player.
+/// A player is logged in on the shard of their name and, when they create
+/// or join a game on another shard, logged in there with the same id and
+/// followed. After a restart of the router the shard of a player is found
+/// by asking the shards. Names are unique within a shard, not globally.
+///
+/// A shard can be restarted independently: the calls to it fail with
+/// SHARD_UNAVAILABLE until it is back. Thread-safe.
+class Router
+{
+    struct Impl;
+    std::unique_ptr<Impl> impl_;
+public:
+    /// Construct Router
+    /// @param shards [in] paths of the sockets of the shards, see
+    ///     serveShard. The order decides the placement of the games.
+    explicit Router(const std::vector<std::string>& shards);
+
+    /// Destructor
+    ~Router();
+
+    /// Call the API route on the shard of the game or the player, like
+    /// dispatch does on a single engine. /api/games and /api/metrics
+    /// combine the answers of all the shards.
+    /// @param route [in] path of the url, e.g., /api/bid
+    /// @param body [in] body of the request in the given format
+    /// @param format [in] format of the body and the response
+    /// @return the response or an error
+    std::string call(const std::string& route, const std::string& body, Format format) noexcept;
+
+    /// @return index of the shard of the game
+    std::size_t shard(const std::string& game) const;
+};
+
+} // namespace dice
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <algorithm>
+#include <tuple>
+
+namespace dice {
+
+/// Maximum number of players in a game
+constexpr int MAX_PLAYERS = 8;
+
+/// Number of dice each player starts with
+constexpr int MAX_DICE = 5;
+
+/// Result of a challenge for a single player.
+/// @param offset [in] actual number of dice minus the challenged bid
+///     (@see Bid::challenge)
+/// @param isBidder [in] whether the player made the challenged bid
+/// @param isChallenger [in] whether the player challenged the bid
+/// @return tuple (adjustment, winner, loser), where adjustment is the
+///     (non-positive) change in the number of the player's dice
+inline std::tuple<int, bool, bool> roundResult(int offset, bool isBidder, bool isChallenger)
+{
+    if (isBidder)
+        return std::make_tuple(offset < 0 ? offset : 0, offset >= 0, offset < 0);
+    if (isChallenger)
+        return std::make_tuple(offset >= 0 ? std::min(-1, -offset) : 0, offset < 0, offset >= 0);
+    return std::make_tuple(offset == 0 ? -1 : 0, false, false);
+}
+
+} // namespace dice
@@ -0,0 +1,142 @@
+#include "shard.hpp"
+
+#include "engine.hpp"
+#include "frame.hpp"
+#include "traffic.hpp"
+
+#include <boost/asio.hpp>
+
+#include <cstdio>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace dice {
+
+namespace asio = boost::asio;
+using asio::local::stream_protocol;
+
+namespace {
+
+void serveConnection(Engine& engine, stream_protocol::socket socket)
+{
+    try {
+        for (;;)
+        {
+            const auto request = readFrame(socket);
+            if (request.size() < 2) throw std::runtime_error("INVALID_FRAME");
+            const auto format = request[0] == 1 ? Format::MSGPACK : Format::JSON;
+            const auto routeLength = static_cast<unsigned char>(request[1]);
+            if (request.size() < 2u + routeLength) throw std::runtime_error("INVALID_FRAME");
+            const auto route = request.substr(2, routeLength);
+            const auto body = request.substr(2u + routeLength);
+            // Only the router may choose the ids of the players
+            writeFrame(socket, route == "/api/login" ?
+                engine.shardLogin(body, format) : dispatch(engine, route, body, format));
+        }
+    }
+    catch (const std::exception&) {
+        // The router closed the connection or broke the protocol
+    }
+}
+
+} // unnamed namespace
+
+void serveShard(Engine& engine, const std::string& path)
+{
+    asio::io_service io;
+    std::remove(path.c_str());
+    stream_protocol::acceptor acceptor{io};
+    try {
+        acceptor.open(stream_protocol{});
+        acceptor.bind(stream_protocol::endpoint{path});
+        acceptor.listen();
+    }
+    catch (const boost::system::system_error& e) {
+        throw std::runtime_error(path + ": " + e.what());
+    }
+    for (;;)
+    {
+        stream_protocol::socket socket{io};
+        boost::system::error_code ec;
+        acceptor.accept(socket, ec);
+        if (ec) continue;
+        std::thread{serveConnection, std::ref(engine), std::move(socket)}.detach();
+    }
+}
+
+struct ShardClient::Impl
+{
+    const std::string path_;
+    asio::io_service io_;
+    std::mutex mutex_;
+    // Idle connections
+    std::vector<std::unique_ptr<stream_protocol::socket>> pool_;
+
+    explicit Impl(const std::string& path)
+      : path_{path}, io_{}, mutex_{}, pool_{}
+    {
+    }
+
+    std::unique_ptr<stream_protocol::socket> take()
+    {
+        std::lock_guard<std::mutex> lock{mutex_};
+        if (pool_.empty()) return nullptr;
+        auto socket = std::move(pool_.back());
+        pool_.pop_back();
+        return socket;
+    }
+
+    std::unique_ptr<stream_protocol::socket> connect()
+    {
+        auto socket = std::make_unique<stream_protocol::socket>(io_);
+        socket->connect(stream_protocol::endpoint{path_});
+        return socket;
+    }
+
+    void give(std::unique_ptr<stream_protocol::socket> socket)
+    {
+        std::lock_guard<std::mutex> lock{mutex_};
+        pool_.push_back(std::move(socket));
+    }
+};
+
+ShardClient::ShardClient(const std::string& path)
+  : impl_{std::make_unique<Impl>(path)}
+{
+}
+
+ShardClient::~ShardClient() = default;
+
+std::string ShardClient::call(const std::string& route, const std::string& body, Format format)
+{
+    if (route.size() > 255) throw std::runtime_error("INVALID_ROUTE");
+    std::string request;
+    request.reserve(2 + route.size() + body.size());
+    request += format == Format::MSGPACK ? '\1' : '\0';
+    request += static_cast<char>(route.size());
+    request += route;
+    request += body;
+
+    auto socket = impl_->take();
+    // Only a pooled connection is retried: a fresh one failing means the
+    // shard is down, and the request may have been handled already
+    const bool pooled = socket != nullptr;
+    for (int attempt = 0;; ++attempt)
+    {
+        try {
+            if (!socket) socket = impl_->connect();
+            writeFrame(*socket, request);
+            auto response = readFrame(*socket);
+            impl_->give(std::move(socket));
+            return response;
+        }
+        catch (const std::exception& e) {
+            socket.reset();
+            if (!pooled || attempt > 0) throw std::runtime_error(impl_->path_ + ": " + e.what());
+        }
+    }
+}
+
+} // namespace dice
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "request.hpp" // Format
+
+#include <memory>
+#include <string>
+
+namespace dice {
+
+class Engine;
+
+/// Serve the API of the engine on a Unix domain socket for a Router. Each
+/// request is a frame of
+///     uint32 length, uint8 format, uint8 route length, route, body
+/// and each response a frame of
+///     uint32 length, body
+/// in host byte order. Every connection is served by its own thread.
+/// /api/login is served by Engine::shardLogin so that the Router can pick
+/// the ids. Does not return unless the socket cannot be set up.
+/// @param engine [in,out] the engine of the shard
+/// @param path [in] path of the socket, an old socket file is removed
+/// @throws std::runtime_error if the socket cannot be set up
+void serveShard(Engine& engine, const std::string& path);
+
+/// Client of a shard served with serveShard. Keeps a pool of connections
+/// so it can be shared by the threads of the Router. Thread-safe.
+class ShardClient
+{
+    struct Impl;
+    std::unique_ptr<Impl> impl_;
+public:
+    /// Construct ShardClient. Connects on the first call.
+    /// @param path [in] path of the socket of the shard
+    explicit ShardClient(const std::string& path);
+
+    /// Destructor
+    ~ShardClient();
+
+    /// Call an API route of the shard. A pooled connection that has been
+    /// closed, e.g., by a restart of the shard, is replaced once.
+    /// @param route [in] path of the url, e.g., /api/bid
+    /// @param body [in] body of the request in the given format
+    /// @param format [in] format of the body and the response
+    /// @return the response
+    /// @throws std::runtime_error if the shard can't be reached
+    std::string call(const std::string& route, const std::string& body, Format format);
+};
+
+} // namespace dice
@@ -0,0 +1,387 @@
+#include "sim.hpp"
+
+#include "threadpool.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+namespace dice {
+namespace sim {
+
+namespace {
+
+std::array<int, 7> faceCounts(const std::uint8_t* hand, int handSize)
+{
+    std::array<int, 7> counts{};
+    for (int i = 0; i < handSize; ++i) ++counts[hand[i]];
+    return counts;
+}
+
+// Expected number of dice with the given face on the whole table
+double expected(const std::array<int, 7>& own, int unknown, int face)
+{
+    if (face == STAR) return own[STAR] + unknown / 6.0;
+    return own[static_cast<std::size_t>(face)] + own[STAR] + unknown / 3.0;
+}
+
+// Apply the decision of the seat in turn the way playGame does
+// @return whether the round ended with a challenge
+bool play(GameState& game, const View& view, Bid bid)
+{
+    if (view.bid.valid() &&
+        (!(view.bid < bid) || Bid{view.totalDice, STAR} < bid))
+    {
+        // Challenging is the only sensible response to a bid that
+        // can't be raised or when the raise can't possibly be true
+        game.challenge();
+        return true;
+    }
+    // The opening bid of the round is mandatory
+    if (!(view.bid < bid)) bid = Bid::fromScore(view.bid.score() + 1);
+    game.bid(bid);
+    return false;
+}
+
+// The minimal raise and the raise by one for every face, and challenging
+std::vector<Bid> candidates(const View& view)
+{
+    std::vector<Bid> moves;
+    const Bid highest{view.totalDice, STAR};
+    for (int face = 1; face <= STAR; ++face)
+    {
+        int n = 1;
+        while (!(view.bid < Bid{n, face})) ++n;
+        for (const auto m : {n, n + 1})
+        {
+            if (Bid{m, face} <= highest) moves.emplace_back(m, face);
+        }
+    }
+    if (view.bid.valid()) moves.emplace_back();
+    return moves;
+}
+
+// Play the rest of the round after the move with sampled hidden dice
+// @return dice lost by the others (per other seat) minus own dice lost
+double rollout(const View& view, const Bid& move, const IStrategy& model, Rng& rng)
+{
+    GameState game{view, rng};
+    bool done = play(game, view, move);
+    while (!done)
+    {
+        const auto v = game.view();
+        done = play(game, v, model.decide(v, rng));
+    }
+
+    int others = 0;
+    int othersLost = 0;
+    for (int i = 0; i < view.numPlayers; ++i)
+    {
+        const int before = view.diceLeft[i];
+        if (i == view.seat || before == 0) continue;
+        ++others;
+        othersLost += before - game.diceLeft(i);
+    }
+    const int lost = view.handSize - game.diceLeft(view.seat);
+    return double(othersLost) / std::max(1, others) - lost;
+}
+
+} // unnamed namespace
+
+IStrategy::~IStrategy() {}
+
+Bid RandomStrategy::decide(const View& view, Rng& rng) const
+{
+    std::uniform_real_distribution<double> p(0.0, 1.0);
+    if (view.bid.valid() && p(rng) < challengeProbability_) return Bid{};
+    std::uniform_int_distribution<int> step(1, 3);
+    return Bid::fromScore(view.bid.score() + step(rng));
+}
+
+Bid ProbabilityStrategy::decide(const View& view, Rng&) const
+{
+    const auto own = faceCounts(view.hand, view.handSize);
+    const int unknown = view.totalDice - view.handSize;
+    if (view.bid.valid() &&
+        view.bid.n() > expected(own, unknown, view.bid.face()) + margin_)
+    {
+        return Bid{};
+    }
+
+    // Pick the face that leaves the most slack after the minimal raise
+    Bid best;
+    double bestSlack = -1e9;
+    for (int face = 1; face <= STAR; ++face)
+    {
+        int n = 1;
+        while (!(view.bid < Bid{n, face})) ++n;
+        const double e = expected(own, unknown, face);
+        if (!view.bid.valid()) n = std::max(n, static_cast<int>(e));
+        const double slack = e - n;
+        if (slack > bestSlack)
+        {
+            bestSlack = slack;
+            best = Bid{n, face};
+        }
+    }
+    if (view.bid.valid() && bestSlack < -margin_) return Bid{};
+    return best;
+}
+
+Bid MonteCarloStrategy::decide(const View& view, Rng& rng) const
+{
+    return decide(view, rng, Clock::now() + budget_);
+}
+
+Bid MonteCarloStrategy::decide(const View& view, Rng& rng, Clock::time_point deadline) const
+{
+    // Rollouts per candidate between the deadline checks
+    constexpr int BATCH = 16;
+    static const ProbabilityStrategy model;
+
+    const auto moves = candidates(view);
+    const auto n = moves.size();
+    std::vector<double> sums(n);
+    std::vector<int> counts(n);
+    std::vector<Rng> rngs;
+    for (std::size_t c = 0; c < n; ++c) rngs.emplace_back(rng());
+    std::mutex mutex;
+
+    // Sample the candidate once more. @return whether more samples are needed.
+    auto batch = [&](std::size_t c, Rng& r)
+    {
+        double sum = 0.0;
+        for (int i = 0; i < BATCH; ++i) sum += rollout(view, moves[c], model, r);
+        std::lock_guard<std::mutex> lock{mutex};
+        sums[c] += sum;
+        counts[c] += BATCH;
+        return counts[c] < samples_;
+    };
+
+    if (pool_)
+    {
+        // One chain of batches per candidate. The next batch goes to the
+        // worker's own queue and idle workers steal from there.
+        TaskGroup group{*pool_};
+        std::function<void(std::size_t)> run = [&](std::size_t c)
+        {
+            if (Clock::now() < deadline && batch(c, rngs[c])) group.run([&run, c] { run(c); });
+        };
+        for (std::size_t c = 0; c < n; ++c) group.run([&run, c] { run(c); });
+        group.wait();
+    }
+    else
+    {
+        bool more = true;
+        while (more && Clock::now() < deadline)
+        {
+            more = false;
+            for (std::size_t c = 0; c < n; ++c)
+            {
+                if (counts[c] < samples_ && batch(c, rngs[c])) more = true;
+            }
+        }
+    }
+
+    std::size_t best = n;
+    for (std::size_t c = 0; c < n; ++c)
+    {
+        if (counts[c] == 0) continue;
+        if (best == n || sums[c] / counts[c] > sums[best] / counts[best]) best = c;
+    }
+    return best < n ? moves[best] : model.decide(view, rng);
+}
+
+GameState::GameState(int numPlayers, int firstSeat)
+  : hands_{},
+    diceLeft_{},
+    numPlayers_{numPlayers},
+    turn_{firstSeat},
+    bidder_{-1},
+    bid_{}
+{
+    assert(numPlayers >= 2 && numPlayers <= MAX_PLAYERS);
+    assert(firstSeat >= 0 && firstSeat < numPlayers);
+    for (int i = 0; i < numPlayers_; ++i) diceLeft_[static_cast<std::size_t>(i)] = MAX_DICE;
+}
+
+GameState::GameState(const View& view, Rng& rng)
+  : hands_{},
+    diceLeft_{},
+    numPlayers_{view.numPlayers},
+    turn_{view.seat},
+    bidder_{-1},
+    bid_{view.bid}
+{
+    assert(numPlayers_ >= 2 && numPlayers_ <= MAX_PLAYERS);
+    for (int i = 0; i < numPlayers_; ++i)
+    {
+        const auto seat = static_cast<std::size_t>(i);
+        diceLeft_[seat] = view.diceLeft[seat];
+        if (i == view.seat) std::copy(view.hand, view.hand + view.handSize, hands_[seat].begin());
+        else fillDice(rng, hands_[seat].data(), diceLeft_[seat]);
+    }
+    if (bid_.valid())
+    {
+        // The bid was made by the previous seat with dice
+        bidder_ = turn_;
+        do
+        {
+            bidder_ = (bidder_ + numPlayers_ - 1) % numPlayers_;
+        } while (diceLeft_[static_cast<std::size_t>(bidder_)] == 0);
+    }
+}
+
+int GameState::playersLeft() const
+{
+    int n = 0;
+    for (int i = 0; i < numPlayers_; ++i)
+    {
+        if (diceLeft_[static_cast<std::size_t>(i)] > 0) ++n;
+    }
+    return n;
+}
+
+int GameState::winner() const
+{
+    if (playersLeft() != 1) return -1;
+    for (int i = 0; i < numPlayers_; ++i)
+    {
+        if (diceLeft_[static_cast<std::size_t>(i)] > 0) return i;
+    }
+    return -1;
+}
+
+void GameState::startRound(Rng& rng)
+{
+    for (int i = 0; i < numPlayers_; ++i)
+    {
+        const auto seat = static_cast<std::size_t>(i);
+        fillDice(rng, hands_[seat].data(), diceLeft_[seat]);
+    }
+    bid_ = Bid{};
+    bidder_ = -1;
+}
+
+View GameState::view() const
+{
+    int total = 0;
+    for (int i = 0; i < numPlayers_; ++i) total += diceLeft_[static_cast<std::size_t>(i)];
+    const auto seat = static_cast<std::size_t>(turn_);
+    return View{turn_, numPlayers_, hands_[seat].data(), diceLeft_[seat],
+                diceLeft_.data(), total, bid_};
+}
+
+void GameState::nextPlayer()
+{
+    do
+    {
+        turn_ = (turn_ + 1) % numPlayers_;
+    } while (diceLeft_[static_cast<std::size_t>(turn_)] == 0);
+}
+
+bool GameState::bid(const Bid& bid)
+{
+    if (!bid.valid() || !(bid_ < bid)) return false;
+    bid_ = bid;
+    bidder_ = turn_;
+    nextPlayer();
+    return true;
+}
+
+bool GameState::challenge()
+{
+    if (!bid_.valid()) return false;
+    std::array<int, 7> counts{};
+    for (int i = 0; i < numPlayers_; ++i)
+    {
+        const auto seat = static_cast<std::size_t>(i);
+        for (int d = 0; d < diceLeft_[seat]; ++d) ++counts[hands_[seat][static_cast<std::size_t>(d)]];
+    }
+    const auto offset = bid_.challenge(counts);
+    for (int i = 0; i < numPlayers_; ++i)
+    {
+        const auto seat = static_cast<std::size_t>(i);
+        const auto result = roundResult(offset, i == bidder_, i == turn_);
+        const int left = std::max(0, diceLeft_[seat] + std::get<0>(result));
+        diceLeft_[seat] = static_cast<std::uint8_t>(left);
+    }
+    if (offset >= 0) turn_ = bidder_;
+    bid_ = Bid{};
+    return true;
+}
+
+int playGame(const std::vector<const IStrategy*>& seats, int firstSeat, Rng& rng, Stats& stats)
+{
+    GameState game{static_cast<int>(seats.size()), firstSeat};
+    while (game.playersLeft() > 1)
+    {
+        game.startRound(rng);
+        ++stats.rounds;
+        for (;;)
+        {
+            const auto view = game.view();
+            const auto bid = seats[static_cast<std::size_t>(view.seat)]->decide(view, rng);
+            ++stats.moves;
+            if (play(game, view, bid)) break;
+        }
+    }
+    const auto winner = game.winner();
+    assert(winner >= 0);
+    ++stats.games;
+    ++stats.wins[static_cast<std::size_t>(winner)];
+    return winner;
+}
+
+Stats run(const std::vector<const IStrategy*>& seats, const Config& config)
+{
+    const auto numSeats = seats.size();
+    unsigned numThreads = config.threads ? config.threads : std::thread::hardware_concurrency();
+    if (numThreads == 0) numThreads = 1;
+
+    std::vector<Stats> perThread(numThreads);
+    std::vector<std::thread> threads;
+    const auto t0 = std::chrono::steady_clock::now();
+    for (unsigned t = 0; t < numThreads; ++t)
+    {
+        threads.emplace_back([&, t]
+        {
+            Rng rng{config.seed};
+            for (unsigned j = 0; j < t; ++j) rng.jump();
+            auto& stats = perThread[t];
+            stats.wins.assign(numSeats, 0);
+            for (auto i = static_cast<long long>(t); i < config.games; i += numThreads)
+            {
+                playGame(seats, static_cast<int>(i % static_cast<long long>(numSeats)), rng, stats);
+            }
+        });
+    }
+    for (auto& t : threads) t.join();
+    const std::chrono::duration<double> duration = std::chrono::steady_clock::now() - t0;
+
+    Stats total;
+    total.wins.assign(numSeats, 0);
+    for (const auto& s : perThread)
+    {
+        total.games += s.games;
+        total.rounds += s.rounds;
+        total.moves += s.moves;
+        for (std::size_t i = 0; i < numSeats; ++i) total.wins[i] += s.wins[i];
+    }
+    total.seconds = duration.count();
+    return total;
+}
+
+std::unique_ptr<IStrategy> makeStrategy(const std::string& name)
+{
+    if (name == "random") return std::make_unique<RandomStrategy>();
+    if (name == "probability") return std::make_unique<ProbabilityStrategy>();
+    if (name == "montecarlo") return std::make_unique<MonteCarloStrategy>();
+    return nullptr;
+}
+
+} // namespace sim
+} // namespace dice
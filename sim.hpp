@@ -0,0 +1,234 @@
+#pragma once
+
+#include "bid.hpp"
+#include "rng.hpp"
+#include "rules.hpp"
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace dice {
+
+class ThreadPool;
+
+namespace sim {
+
+/// Random number generator used by the simulator. Each thread owns one.
+using Rng = Xoshiro256;
+
+/// What a strategy is allowed to see when it's its turn to act
+struct View
+{
+    /// Seat whose turn it is
+    int seat;
+    /// Number of seats in the game
+    int numPlayers;
+    /// Dice of the acting seat
+    const std::uint8_t* hand;
+    /// Number of dice in hand
+    int handSize;
+    /// Number of dice left per seat
+    const std::uint8_t* diceLeft;
+    /// Total number of dice on the table
+    int totalDice;
+    /// Current bid. Not valid if this is the opening bid of the round.
+    Bid bid;
+};
+
+/// Pluggable decision making for a simulated seat. Strategies are shared
+/// between threads so decide() must not modify the strategy.
+class IStrategy
+{
+public:
+    /// Destructor
+    virtual ~IStrategy();
+    /// @return name of the strategy for reporting
+    virtual const char* name() const = 0;
+    /// Decide what to do
+    /// @param view [in] the visible state of the game
+    /// @param rng [in,out] random numbers for randomized strategies
+    /// @return bid to raise to or Bid{} to challenge the current bid
+    virtual Bid decide(const View& view, Rng& rng) const = 0;
+};
+
+/// Challenges with the given probability, otherwise raises by a random
+/// small step.
+class RandomStrategy : public IStrategy
+{
+    double challengeProbability_;
+public:
+    /// Construct RandomStrategy
+    /// @param challengeProbability [in] probability of challenging a bid
+    explicit RandomStrategy(double challengeProbability = 0.3)
+      : challengeProbability_{challengeProbability}
+    {
+    }
+    const char* name() const override { return "random"; }
+    Bid decide(const View& view, Rng& rng) const override;
+};
+
+/// Bids based on the expected number of dice given own hand, challenges
+/// when the current bid exceeds the expectation.
+class ProbabilityStrategy : public IStrategy
+{
+    double margin_;
+public:
+    /// Construct ProbabilityStrategy
+    /// @param margin [in] how many dice above the expectation are tolerated
+    ///     before challenging
+    explicit ProbabilityStrategy(double margin = 0.5) : margin_{margin} {}
+    const char* name() const override { return "probability"; }
+    Bid decide(const View& view, Rng& rng) const override;
+};
+
+/// Evaluates the candidate moves (the minimal raise and the raise by one
+/// for every face, and challenging) by playing the rest of the round with
+/// the hidden dice sampled and the other seats modelled by
+/// ProbabilityStrategy. The move with the best expected dice difference
+/// wins.
+///
+/// The search is anytime: the candidates are sampled in small batches
+/// until every candidate has the configured number of samples or the
+/// deadline passes. Each candidate has its own random number stream so the
+/// result doesn't depend on the threads when the deadline isn't hit.
+class MonteCarloStrategy : public IStrategy
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    /// Construct MonteCarloStrategy
+    /// @param pool [in] threads for the search or nullptr to search on the
+    ///     calling thread. Not owned.
+    /// @param samples [in] maximum number of rollouts per candidate
+    /// @param budget [in] time per decision when no deadline is given
+    explicit MonteCarloStrategy(ThreadPool* pool = nullptr, int samples = 256,
+                                std::chrono::microseconds budget = std::chrono::milliseconds{10})
+      : pool_{pool},
+        samples_{samples},
+        budget_{budget}
+    {
+    }
+    const char* name() const override { return "montecarlo"; }
+    Bid decide(const View& view, Rng& rng) const override;
+
+    /// Decide what to do before the deadline. Falls back to
+    /// ProbabilityStrategy if no candidate could be sampled in time.
+    /// @param view [in] the visible state of the game
+    /// @param rng [in,out] random numbers for seeding the search
+    /// @param deadline [in] when the search stops
+    /// @return bid to raise to or Bid{} to challenge the current bid
+    Bid decide(const View& view, Rng& rng, Clock::time_point deadline) const;
+
+private:
+    ThreadPool* pool_;
+    int samples_;
+    std::chrono::microseconds budget_;
+};
+
+/// Compact state of a single game. Seats are identified by their index.
+class GameState
+{
+    std::array<std::array<std::uint8_t, MAX_DICE>, MAX_PLAYERS> hands_;
+    std::array<std::uint8_t, MAX_PLAYERS> diceLeft_;
+    int numPlayers_;
+    int turn_;
+    int bidder_;
+    Bid bid_;
+
+    void nextPlayer();
+public:
+    /// Construct a game where every seat has all the dice
+    /// @param numPlayers [in] number of seats [2, MAX_PLAYERS]
+    /// @param firstSeat [in] who starts the first round
+    GameState(int numPlayers, int firstSeat);
+
+    /// Construct a round in progress as the seat in turn sees it: the own
+    /// hand from the view and the dice of the others rolled
+    /// @param view [in] the visible state
+    /// @param rng [in,out] random numbers for the hidden dice
+    GameState(const View& view, Rng& rng);
+
+    /// @return number of seats that still have dice
+    int playersLeft() const;
+
+    /// @return seat of the only player with dice left or -1
+    int winner() const;
+
+    /// @return number of dice left for the seat
+    int diceLeft(int seat) const { return diceLeft_[static_cast<std::size_t>(seat)]; }
+
+    /// Roll all the dice and reset the bid. Same as Game::startRound.
+    void startRound(Rng& rng);
+
+    /// @return state visible to the seat in turn
+    View view() const;
+
+    /// Raise the bid. Same as Game::bid.
+    /// @return false if the bid is not higher than the current bid
+    bool bid(const Bid& bid);
+
+    /// Challenge the current bid and remove the dice of the losers.
+    /// Same as Game::challenge followed by removing the dice in
+    /// Game::startRound.
+    /// @return false if there is nothing to challenge
+    bool challenge();
+};
+
+/// Simulation parameters
+struct Config
+{
+    /// Number of games to play
+    long long games = 100000;
+    /// Number of worker threads. 0 = one per core.
+    unsigned threads = 0;
+    /// Seed for the per-thread random number generators
+    std::uint64_t seed = 0;
+};
+
+/// Simulation results
+struct Stats
+{
+    /// Number of games played
+    long long games = 0;
+    /// Number of rounds played
+    long long rounds = 0;
+    /// Number of bids and challenges
+    long long moves = 0;
+    /// Wins per seat
+    std::vector<long long> wins;
+    /// Wall clock time
+    double seconds = 0.0;
+
+    /// @return games played per second
+    double gamesPerSecond() const { return seconds > 0.0 ? double(games) / seconds : 0.0; }
+    /// @return fraction of games won by the given seat
+    double winRate(std::size_t seat) const { return games ? double(wins[seat]) / double(games) : 0.0; }
+};
+
+/// Play a single game to completion
+/// @param seats [in] strategy for every seat
+/// @param firstSeat [in] who starts the first round
+/// @param rng [in,out] random number generator for dice and strategies
+/// @param stats [out] rounds, moves and the win are added here
+/// @return the winning seat
+int playGame(const std::vector<const IStrategy*>& seats, int firstSeat, Rng& rng, Stats& stats);
+
+/// Play the configured number of games in parallel. The starting seat
+/// rotates between games so that no seat gets the first mover's edge.
+/// @param seats [in] strategy for every seat
+/// @param config [in] simulation parameters
+/// @return combined results of all threads
+Stats run(const std::vector<const IStrategy*>& seats, const Config& config);
+
+/// Create a strategy by name
+/// @param name [in] "random", "probability" or "montecarlo"
+/// @return the strategy or nullptr if the name is unknown
+std::unique_ptr<IStrategy> makeStrategy(const std::string& name);
+
+} // namespace sim
+} // namespace dice
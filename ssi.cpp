@@ -10,7 +10,7 @@ namespace dice {
 
 std::string readHtml(const std::string& name, const std::string& base)
 {
-    // Benchmarks
+    // Benchmarks, see BM_ReadHtml in bench/bluff_bench.cpp
     // Baseline: 53 ms
     // Whole string at once: 1630 ms (no replace)
     // Line at time, full solution: 150 ms
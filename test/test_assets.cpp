@@ -0,0 +1,36 @@
+#include "assets.hpp"
+
+#include "brotli.hpp"
+
+#include "gtest/gtest.h"
+
+namespace {
+
+using namespace std;
+using dice::Encoding;
+
+TEST(AssetsTest, Missing) {
+    dice::AssetStore assets{"../test"};
+    ASSERT_EQ(nullptr, assets.get("missing.html"));
+}
+
+TEST(AssetsTest, Cached) {
+    dice::AssetStore assets{"../test"};
+    const auto asset = assets.get("no_include.txt");
+    ASSERT_NE(nullptr, asset);
+    ASSERT_EQ("a\nb\nc\n", asset->variant(Encoding::IDENTITY));
+    ASSERT_EQ(asset, assets.get("no_include.txt"));
+}
+
+TEST(AssetsTest, Compressed) {
+    dice::AssetStore assets{"../static"};
+    const auto asset = assets.get("login.html");
+    ASSERT_NE(nullptr, asset);
+    ASSERT_EQ("text/html; charset=utf-8", asset->contentType);
+    ASSERT_TRUE(asset->available & dice::encodingBit(Encoding::BR));
+    ASSERT_EQ(asset->variant(Encoding::IDENTITY), dice::decompress(asset->variant(Encoding::BR)));
+    const dice::AcceptEncoding accept{"gzip, br"};
+    ASSERT_EQ(Encoding::BR, accept.select(asset->available));
+}
+
+} // Unnamed namespace
@@ -0,0 +1,65 @@
+#include "bots.hpp"
+#include "game.hpp"
+
+#include "gtest/gtest.h"
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using namespace std::chrono;
+using dice::BotScheduler;
+
+TEST(BotSchedulerTest, Order) {
+    std::mutex m;
+    std::vector<int> ran;
+    std::atomic<int> done{0};
+    {
+        BotScheduler s{1};
+        const auto t0 = BotScheduler::Clock::now();
+        auto task = [&](int i) { return [&, i] { { std::lock_guard<std::mutex> l{m}; ran.push_back(i); } ++done; }; };
+        s.schedule(t0 + milliseconds{30}, task(3));
+        s.schedule(t0 + milliseconds{10}, task(1));
+        s.schedule(t0 + milliseconds{10}, task(2));
+        s.schedule(t0, task(0));
+        while (done < 4) std::this_thread::sleep_for(milliseconds{1});
+        ASSERT_GE(BotScheduler::Clock::now(), t0 + milliseconds{30});
+        ASSERT_EQ(0, s.pending());
+    }
+    ASSERT_EQ((std::vector<int>{0, 1, 2, 3}), ran);
+}
+
+TEST(BotSchedulerTest, DropPending) {
+    std::atomic<int> ran{0};
+    {
+        BotScheduler s{2};
+        s.schedule(BotScheduler::Clock::now() + hours{1}, [&] { ++ran; });
+        ASSERT_EQ(1, s.pending());
+    }
+    ASSERT_EQ(0, ran);
+}
+
+TEST(BotTest, DecideMove) {
+    dice::Game game{"g"};
+    ASSERT_TRUE(game.addPlayer("a"));
+    ASSERT_TRUE(game.addPlayer("b"));
+    ASSERT_TRUE(game.startGame());
+    ASSERT_TRUE(game.startRound());
+    dice::Xoshiro256 rng{1};
+    const auto deadline = steady_clock::now() + milliseconds{100};
+
+    // Nothing to challenge yet
+    auto bid = dice::decideBotMove(game, rng, deadline);
+    ASSERT_TRUE(bid.valid());
+    const auto player = game.players()[static_cast<std::size_t>(game.turn())].name();
+    ASSERT_TRUE(game.bid(player, bid.n(), bid.face()));
+
+    bid = dice::decideBotMove(game, rng, deadline);
+    ASSERT_TRUE(bid == dice::Bid{} || game.currentBid() < bid);
+}
+
+} // Unnamed namespace
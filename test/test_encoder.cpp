@@ -0,0 +1,62 @@
+#include "encoder.hpp"
+
+#include "filehelpers.hpp"
+
+#include "gtest/gtest.h"
+
+#include <stdexcept>
+
+namespace {
+
+using namespace std;
+using dice::Encoding;
+using dice::Profile;
+
+const Encoding ENCODINGS[] = {Encoding::BR, Encoding::GZIP, Encoding::ZSTD};
+
+TEST(EncoderTest, Identity) {
+    ASSERT_EQ(nullptr, dice::getEncoder(Encoding::IDENTITY));
+    for (const auto e : ENCODINGS)
+    {
+        ASSERT_TRUE(dice::availableEncodings() & dice::encodingBit(e));
+        ASSERT_EQ(e, dice::getEncoder(e)->encoding());
+    }
+}
+
+TEST(EncoderTest, EncodeDecode) {
+    const auto orig = dice::slurp("../final.json");
+    ASSERT_FALSE(orig.empty());
+    for (const auto e : ENCODINGS)
+    {
+        const auto encoder = dice::getEncoder(e);
+        for (const auto profile : {Profile::DYNAMIC, Profile::STATIC})
+        {
+            const auto deflated = encoder->compress(orig, profile);
+            ASSERT_LT(deflated.size(), orig.size()) << dice::encodingName(e);
+            ASSERT_EQ(orig, encoder->decompress(deflated)) << dice::encodingName(e);
+        }
+    }
+}
+
+TEST(EncoderTest, Empty) {
+    for (const auto e : ENCODINGS)
+    {
+        const auto encoder = dice::getEncoder(e);
+        ASSERT_EQ("", encoder->decompress(encoder->compress("", Profile::DYNAMIC)));
+    }
+}
+
+TEST(EncoderTest, Invalid) {
+    const std::string orig(1000, 'a');
+    for (const auto e : ENCODINGS)
+    {
+        const auto encoder = dice::getEncoder(e);
+        const auto deflated = encoder->compress(orig, Profile::DYNAMIC);
+        ASSERT_THROW(encoder->decompress(deflated.substr(0, deflated.size() - 1)), std::runtime_error)
+            << dice::encodingName(e);
+        ASSERT_THROW(encoder->decompress("not compressed"), std::runtime_error)
+            << dice::encodingName(e);
+    }
+}
+
+} // Unnamed namespace
@@ -0,0 +1,138 @@
+#include "endgame.hpp"
+#include "filehelpers.hpp"
+#include "test/test_helpers.hpp"
+
+#include "gtest/gtest.h"
+
+#include <iostream>
+#include <set>
+#include <stdexcept>
+
+namespace dice {
+namespace {
+
+// Play a 1v1 game from the given dice per player like sim::playGame
+int playEndgame(const sim::IStrategy& s0, const sim::IStrategy& s1, int dice, int first, sim::Rng& rng)
+{
+    const std::uint8_t hand[MAX_DICE] = {};
+    const std::uint8_t left[2] = {std::uint8_t(dice), std::uint8_t(dice)};
+    sim::GameState game{sim::View{first, 2, hand, dice, left, 2 * dice, Bid{}}, rng};
+    const sim::IStrategy* seats[2] = {&s0, &s1};
+    while (game.playersLeft() > 1)
+    {
+        game.startRound(rng);
+        for (;;)
+        {
+            const auto view = game.view();
+            auto bid = seats[view.seat]->decide(view, rng);
+            if (view.bid.valid() && (!(view.bid < bid) || Bid{view.totalDice, STAR} < bid))
+            {
+                game.challenge();
+                break;
+            }
+            if (!(view.bid < bid)) bid = Bid::fromScore(view.bid.score() + 1);
+            game.bid(bid);
+        }
+    }
+    return game.winner();
+}
+
+TEST(EndgameTest, HandIndex) {
+    ASSERT_EQ(6, numHands(1));
+    ASSERT_EQ(21, numHands(2));
+    ASSERT_EQ(56, numHands(3));
+    std::set<int> indices;
+    for (std::uint8_t a = 1; a <= 6; ++a)
+    {
+        for (std::uint8_t b = 1; b <= 6; ++b)
+        {
+            for (std::uint8_t c = 1; c <= 6; ++c)
+            {
+                const std::uint8_t hand[] = {a, b, c};
+                const std::uint8_t reversed[] = {c, b, a};
+                const auto i = handIndex(hand, 3);
+                ASSERT_EQ(i, handIndex(reversed, 3));
+                ASSERT_TRUE(0 <= i && i < numHands(3));
+                indices.insert(i);
+            }
+        }
+    }
+    ASSERT_EQ(56, indices.size());
+    const std::uint8_t first[] = {1, 1, 1};
+    const std::uint8_t last[] = {6, 6, 6};
+    ASSERT_EQ(0, handIndex(first, 3));
+    ASSERT_EQ(55, handIndex(last, 3));
+}
+
+TEST(EndgameTest, Solve) {
+    TmpFile tmp{tmpName("./endgame")};
+    const auto values = solveEndgames(tmp.str(), 2, 500);
+    const EndgameTable table{tmp.str()};
+    ASSERT_EQ(2, table.maxDice());
+    ASSERT_TRUE(table.covers(1, 2));
+    ASSERT_FALSE(table.covers(3, 1));
+    ASSERT_FALSE(table.covers(1, 0));
+    for (int a = 1; a <= 2; ++a)
+    {
+        for (int b = 1; b <= 2; ++b) ASSERT_EQ(values[a][b], table.value(a, b));
+    }
+    EXPECT_NEAR(0.5, table.value(1, 1), 0.02);
+    EXPECT_NEAR(0.5, table.value(2, 2), 0.02);
+    EXPECT_LT(table.value(1, 2), 0.5);
+    EXPECT_GT(table.value(2, 1), 0.5);
+
+    // Every entry is a distribution over legal actions
+    const int maxScore = Bid{4, STAR}.score();
+    for (std::uint8_t a = 1; a <= 6; ++a)
+    {
+        for (std::uint8_t b = a; b <= 6; ++b)
+        {
+            const std::uint8_t hand[] = {a, b};
+            for (int s = 0; s <= maxScore; ++s)
+            {
+                const auto& e = table.lookup(hand, 2, 2, Bid::fromScore(s));
+                int sum = 0;
+                for (int i = 0; i < 4; ++i)
+                {
+                    sum += e.probability[i];
+                    if (e.probability[i] == 0) continue;
+                    ASSERT_TRUE(e.action[i] == 0 ? s > 0 : e.action[i] > s && e.action[i] <= maxScore);
+                }
+                ASSERT_EQ(255, sum);
+            }
+        }
+    }
+}
+
+TEST(EndgameTest, WinRate) {
+    TmpFile tmp{tmpName("./endgame")};
+    solveEndgames(tmp.str(), 2, 500);
+    const EndgameTable table{tmp.str()};
+    const sim::ProbabilityStrategy probability;
+    const EndgameStrategy endgame{table, probability};
+    sim::Rng rng{3};
+    int wins = 0;
+    constexpr int N = 2000;
+    for (int i = 0; i < N; ++i) wins += playEndgame(endgame, probability, 2, i % 2, rng) == 0;
+    std::cout << 100.0 * wins / N << " % of 2v2 endgames won against probability" << std::endl;
+    ASSERT_GT(wins, N * 53 / 100);
+}
+
+TEST(EndgameTest, Invalid) {
+    ASSERT_THROW(EndgameTable{"not-existing.tbl"}, std::runtime_error);
+    TmpFile tmp{tmpName("./endgame")};
+    dump(tmp.str(), std::string(1000, 'x'));
+    ASSERT_THROW(EndgameTable{tmp.str()}, std::runtime_error);
+    ASSERT_THROW(solveEndgames(tmp.str(), MAX_ENDGAME_DICE + 1, 1), std::invalid_argument);
+
+    // A damaged table fails the checksum
+    solveEndgames(tmp.str(), 1, 1);
+    ASSERT_NO_THROW(EndgameTable{tmp.str()});
+    auto data = slurp(tmp.str());
+    data[sizeof(EndgameTable::Header) + 1] ^= 1;
+    dump(tmp.str(), data);
+    ASSERT_THROW(EndgameTable{tmp.str()}, std::runtime_error);
+}
+
+} // Unnamed namespace
+} // namespace dice
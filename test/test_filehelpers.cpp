@@ -0,0 +1,137 @@
+#include "filehelpers.hpp"
+
+#include "gtest/gtest.h"
+
+#include <dirent.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+
+// Directory removed with its files at the end of the test
+class TmpDir
+{
+    std::string path_;
+public:
+    TmpDir() : path_{"./filehelpersXXXXXX"}
+    {
+        if (!::mkdtemp(&path_[0])) throw std::runtime_error{"mkdtemp"};
+    }
+    ~TmpDir()
+    {
+        for (const auto& f : files()) std::remove((path_ + "/" + f).c_str());
+        ::rmdir(path_.c_str());
+    }
+    const std::string& str() const { return path_; }
+    std::vector<std::string> files() const
+    {
+        std::vector<std::string> names;
+        if (auto* dir = ::opendir(path_.c_str()))
+        {
+            while (auto* e = ::readdir(dir))
+            {
+                const std::string name = e->d_name;
+                if (name != "." && name != "..") names.push_back(name);
+            }
+            ::closedir(dir);
+        }
+        return names;
+    }
+};
+
+std::string content(std::mt19937& rng, char c)
+{
+    return std::string(std::uniform_int_distribution<std::size_t>{1, 100000}(rng), c);
+}
+
+TEST(FileHelpersTest, Checked) {
+    TmpDir dir;
+    const auto path = dir.str() + "/db.json";
+    const std::string data = R"({"players": []})";
+    dice::dumpChecked(path, data);
+    ASSERT_EQ(data, dice::slurpChecked(path));
+    ASSERT_NE(data, dice::slurp(path));
+    // Only the target is left
+    ASSERT_EQ(1u, dir.files().size());
+
+    dice::dump(path, data);
+    ASSERT_THROW(dice::slurpChecked(path), std::runtime_error);
+    ASSERT_EQ(data, dice::slurpChecked(path, false));
+    ASSERT_EQ("", dice::slurpChecked(dir.str() + "/missing", false));
+    ASSERT_THROW(dice::slurpChecked(dir.str() + "/missing"), std::runtime_error);
+    ASSERT_THROW(dice::dump(dir.str() + "/missing/db.json", data), std::runtime_error);
+
+    ASSERT_EQ(0xcbf43926u, dice::crc32("123456789", 9));
+}
+
+TEST(FileHelpersTest, Damaged) {
+    // The checksum catches a file truncated or changed at any offset, as an
+    // in-place write interrupted by a crash would leave it
+    TmpDir dir;
+    const auto path = dir.str() + "/db.json";
+    std::mt19937 rng{1};
+    const auto data = content(rng, 'a');
+    dice::dumpChecked(path, data);
+    const auto full = dice::slurp(path);
+    for (int i = 0; i < 200; ++i)
+    {
+        const auto offset = std::uniform_int_distribution<std::size_t>{0, full.size() - 1}(rng);
+        dice::dump(path, full.substr(0, offset));
+        ASSERT_THROW(dice::slurpChecked(path), std::runtime_error) << offset;
+        auto flipped = full;
+        flipped[offset] = static_cast<char>(flipped[offset] ^ 0x10);
+        dice::dump(path, flipped);
+        ASSERT_THROW(dice::slurpChecked(path), std::runtime_error) << offset;
+    }
+}
+
+TEST(FileHelpersTest, KilledWrites) {
+    // A process killed at a random offset of the write or before the rename
+    // leaves the old content in place, one killed after commit the new one
+    TmpDir dir;
+    const auto path = dir.str() + "/db.json";
+    std::mt19937 rng{2};
+    auto old = content(rng, 'o');
+    dice::dumpChecked(path, old);
+    for (int i = 0; i < 100; ++i)
+    {
+        const auto data = content(rng, static_cast<char>('a' + i % 26));
+        const auto killAt = std::uniform_int_distribution<std::size_t>{0, data.size() + 1}(rng);
+        const auto pid = ::fork();
+        ASSERT_GE(pid, 0);
+        if (pid == 0)
+        {
+            dice::AtomicFile f{path, true};
+            std::size_t offset = 0;
+            while (offset < data.size())
+            {
+                if (offset == killAt) ::raise(SIGKILL);
+                auto n = std::min(data.size() - offset, std::size_t{4096});
+                if (killAt > offset) n = std::min(n, killAt - offset);
+                f.write(data.data() + offset, n);
+                offset += n;
+            }
+            if (killAt == data.size()) ::raise(SIGKILL);
+            f.commit();
+            ::raise(SIGKILL);
+        }
+        int status = 0;
+        ASSERT_EQ(pid, ::waitpid(pid, &status, 0));
+        ASSERT_TRUE(WIFSIGNALED(status));
+
+        const auto committed = killAt > data.size();
+        ASSERT_EQ(committed ? data : old, dice::slurpChecked(path)) << killAt;
+        if (committed) old = data;
+    }
+}
+
+} // unnamed namespace
@@ -3,9 +3,20 @@
 
 #include "gtest/gtest.h"
 
+#include <string>
+#include <vector>
+
 namespace dice {
 namespace {
 
+std::string state(const Game& game)
+{
+    rapidjson::StringBuffer s;
+    json::Writer w{s};
+    game.serializeState(w);
+    return s.GetString();
+}
+
 TEST(GameTest, Save) {
     auto tmp = tmpCopy("../test-game.json", "./.json");
     auto txt0 = slurp("../final.json");
@@ -16,7 +27,7 @@ TEST(GameTest, Save) {
 
     rapidjson::StringBuffer s;
     rapidjson::PrettyWriter<rapidjson::StringBuffer> w{s};
-    game->serialize(w, "");
+    game->serializeState(w);
     ASSERT_STREQ(txt0.c_str(), s.GetString());
 }
 
@@ -37,5 +48,134 @@ TEST(GameTest, StartGameWithOnePlayer) {
     ASSERT_STREQ("NOT_ENOUGH_PLAYERS", json::getString(parse(rv), "error").c_str());
 }
 
+TEST(GameTest, SameSeedSameDice) {
+    Game a{"a", "joe", 1234};
+    Game b{"b", "joe", 1234};
+    for (auto* g : {&a, &b})
+    {
+        ASSERT_TRUE(g->addPlayer("ann"));
+        ASSERT_TRUE(g->startGame());
+        ASSERT_TRUE(g->startRound());
+    }
+    const auto da = parse(state(a));
+    const auto db = parse(state(b));
+    ASSERT_EQ(1234, da["dice"]["seed"].GetUint64());
+    ASSERT_EQ(da["dice"]["position"].GetUint64(), db["dice"]["position"].GetUint64());
+    for (int p = 0; p < 2; ++p)
+    {
+        for (int i = 0; i < 5; ++i)
+        {
+            ASSERT_EQ(da["players"][p]["hand"][i].GetInt(),
+                      db["players"][p]["hand"][i].GetInt());
+        }
+    }
+}
+
+TEST(GameTest, LoadContinuesDice) {
+    Game a{"a", "joe", 99};
+    ASSERT_TRUE(a.addPlayer("ann"));
+    ASSERT_TRUE(a.addPlayer("mary"));
+    ASSERT_TRUE(a.startGame());
+    ASSERT_TRUE(a.startRound());
+
+    auto b = Game::fromJson(parse(state(a)));
+    ASSERT_EQ(99, b->seed());
+    ASSERT_EQ(state(a), state(*b));
+
+    // Logging out rerolls the dice. The loaded game should continue
+    // from the same position in the stream.
+    a.logout("mary");
+    b->logout("mary");
+    ASSERT_EQ(state(a), state(*b));
+}
+
+TEST(GameTest, StatusHasNoDiceStream) {
+    // The stream predicts the coming rolls
+    Game game{"a", "joe", 5};
+    ASSERT_TRUE(game.addPlayer("ann"));
+    ASSERT_TRUE(game.startGame());
+    ASSERT_TRUE(game.startRound());
+    for (const auto* name : {"", "joe"})
+    {
+        ASSERT_FALSE(parse(game.getStatus(name)).HasMember("dice")) << name;
+    }
+    ASSERT_TRUE(parse(state(game)).HasMember("dice"));
+}
+
+TEST(GameTest, Moves) {
+    Game a{"a", "joe", 7};
+    ASSERT_TRUE(a.addPlayer("ann"));
+    ASSERT_TRUE(a.addPlayer("mary"));
+    ASSERT_TRUE(a.startGame());
+    ASSERT_TRUE(a.startRound());
+    ASSERT_TRUE(a.bid("joe", 2, 3));
+    ASSERT_FALSE(a.bid("ann", 1, 3));
+    ASSERT_TRUE(a.challenge("ann"));
+    ASSERT_TRUE(a.startRound());
+    a.logout("mary");
+
+    rapidjson::StringBuffer s;
+    json::Writer w{s};
+    a.serializeMoves(w, 0);
+    const auto doc = parse(s.GetString());
+    ASSERT_TRUE(doc["complete"].GetBool());
+    ASSERT_EQ(0, doc["first"].GetInt());
+    std::vector<std::string> commands;
+    int results = 0;
+    for (const auto& m : doc["moves"].GetArray())
+    {
+        const std::string move = m["move"].GetString();
+        if (move == "result") ++results;
+        else if (move != "roll") commands.push_back(move);
+    }
+    // Failed moves are not logged
+    const std::vector<std::string> expected{
+        "create", "join", "join", "startGame", "startRound", "bid", "challenge",
+        "startRound", "leave"};
+    ASSERT_EQ(expected, commands);
+    ASSERT_GE(results, 1);
+    ASSERT_EQ(doc["next"].GetUint64(), doc["moves"].Size());
+    // The outcomes precede their command
+    ASSERT_STREQ("roll", doc["moves"][4]["move"].GetString());
+    ASSERT_EQ(15, doc["moves"][4]["dice"].GetInt());
+    const auto& bid = doc["moves"][6];
+    ASSERT_STREQ("joe", bid["player"].GetString());
+    ASSERT_EQ(2, bid["n"].GetInt());
+    ASSERT_EQ(3, bid["face"].GetInt());
+
+    rapidjson::StringBuffer s2;
+    json::Writer w2{s2};
+    a.serializeMoves(w2, a.moves().end() - 2);
+    const auto last = parse(s2.GetString());
+    ASSERT_EQ(2, last["moves"].Size());
+    ASSERT_STREQ("roll", last["moves"][0]["move"].GetString());
+    ASSERT_STREQ("mary", last["moves"][1]["player"].GetString());
+
+    // The log and the seed give the same game
+    const auto b = Game::replay("a", 7, a.moves());
+    ASSERT_TRUE(b);
+    ASSERT_EQ(state(a), state(*b));
+    ASSERT_EQ(a.moves().end(), b->moves().end());
+
+    // The log is saved with the game
+    const auto c = Game::fromJson(parse(state(a)));
+    ASSERT_TRUE(c->moves().complete());
+    ASSERT_EQ(state(a), state(*c));
+    const auto d = Game::replay("a", 7, c->moves());
+    ASSERT_TRUE(d);
+    ASSERT_EQ(state(a), state(*d));
+
+    // A game saved without the log or with a damaged one only has the
+    // moves since loading
+    auto saved = parse(state(a));
+    saved["log"]["moves"].PopBack();
+    const auto e = Game::fromJson(saved);
+    ASSERT_FALSE(e->moves().complete());
+    ASSERT_EQ(e->moves().begin(), e->moves().end());
+    ASSERT_FALSE(Game::replay("a", 7, e->moves()));
+    saved.RemoveMember("log");
+    ASSERT_FALSE(Game::fromJson(saved)->moves().complete());
+}
+
 } // Unnamed namespace
 } // namespace dice
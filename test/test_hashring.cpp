@@ -0,0 +1,61 @@
+#include "hashring.hpp"
+
+#include "gtest/gtest.h"
+
+#include <string>
+#include <vector>
+
+namespace {
+
+TEST(HashRingTest, Single) {
+    dice::HashRing ring{1};
+    ASSERT_EQ(1, ring.size());
+    ASSERT_EQ(0, ring.shard(""));
+    ASSERT_EQ(0, ring.shard("game"));
+}
+
+TEST(HashRingTest, Stable) {
+    // The placement must not depend on the process
+    ASSERT_EQ(dice::HashRing::hash("game"), dice::HashRing::hash(std::string{"game"}));
+    ASSERT_NE(dice::HashRing::hash("game1"), dice::HashRing::hash("game2"));
+    dice::HashRing a{4};
+    dice::HashRing b{4};
+    for (int i = 0; i < 1000; ++i)
+    {
+        const auto key = "game" + std::to_string(i);
+        ASSERT_EQ(a.shard(key), b.shard(key));
+    }
+}
+
+TEST(HashRingTest, Balanced) {
+    const std::size_t shards = 8;
+    const int keys = 80000;
+    dice::HashRing ring{shards};
+    std::vector<int> counts(shards);
+    for (int i = 0; i < keys; ++i) ++counts[ring.shard("game" + std::to_string(i))];
+    for (const auto c : counts)
+    {
+        ASSERT_GT(c, keys / int(shards) * 8 / 10);
+        ASSERT_LT(c, keys / int(shards) * 12 / 10);
+    }
+}
+
+TEST(HashRingTest, AddShard) {
+    // Only the keys taken by the new shard move
+    dice::HashRing before{4};
+    dice::HashRing after{5};
+    const int keys = 10000;
+    int moved = 0;
+    for (int i = 0; i < keys; ++i)
+    {
+        const auto key = "game" + std::to_string(i);
+        const auto s = after.shard(key);
+        if (s == before.shard(key)) continue;
+        ASSERT_EQ(4, s);
+        ++moved;
+    }
+    ASSERT_GT(moved, keys / 5 * 8 / 10);
+    ASSERT_LT(moved, keys / 5 * 12 / 10);
+}
+
+} // unnamed namespace
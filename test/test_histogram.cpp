@@ -0,0 +1,66 @@
+#include "histogram.hpp"
+
+#include "gtest/gtest.h"
+
+#include <cstdint>
+
+namespace {
+
+TEST(HistogramTest, Empty) {
+    dice::Histogram h;
+    ASSERT_EQ(0, h.count());
+    ASSERT_EQ(0, h.min());
+    ASSERT_EQ(0, h.max());
+    ASSERT_EQ(0, h.percentile(0.5));
+    ASSERT_EQ(0.0, h.mean());
+}
+
+TEST(HistogramTest, Exact) {
+    // Small values are exact
+    dice::Histogram h;
+    for (std::uint64_t v = 1; v <= 10; ++v) h.record(v);
+    ASSERT_EQ(10, h.count());
+    ASSERT_EQ(1, h.min());
+    ASSERT_EQ(10, h.max());
+    ASSERT_EQ(5.5, h.mean());
+    ASSERT_EQ(5, h.percentile(0.5));
+    ASSERT_EQ(9, h.percentile(0.9));
+    ASSERT_EQ(10, h.percentile(1.0));
+    ASSERT_EQ(1, h.percentile(0.0));
+}
+
+TEST(HistogramTest, RelativeError) {
+    dice::Histogram h;
+    for (std::uint64_t v = 1; v <= 1000000; ++v) h.record(v);
+    for (const auto p : {0.5, 0.9, 0.99, 0.999})
+    {
+        const auto expected = p * 1000000;
+        const auto actual = static_cast<double>(h.percentile(p));
+        ASSERT_GE(actual, expected);
+        ASSERT_LE(actual, expected * 1.04);
+    }
+    ASSERT_EQ(1000000, h.percentile(1.0));
+}
+
+TEST(HistogramTest, Large) {
+    dice::Histogram h;
+    h.record(UINT64_MAX);
+    h.record(0);
+    ASSERT_EQ(UINT64_MAX, h.percentile(1.0));
+    ASSERT_EQ(0, h.percentile(0.5));
+}
+
+TEST(HistogramTest, Merge) {
+    dice::Histogram a;
+    dice::Histogram b;
+    a.record(1);
+    b.record(100);
+    b.record(3);
+    a.merge(b);
+    ASSERT_EQ(3, a.count());
+    ASSERT_EQ(1, a.min());
+    ASSERT_EQ(100, a.max());
+    ASSERT_EQ(3, a.percentile(0.5));
+}
+
+} // Unnamed namespace
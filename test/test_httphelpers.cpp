@@ -103,5 +103,71 @@ TEST(HttpHelpersTest, Benchmark) {
     // cout << "Took " << dur.count() << ", " << matches << endl;
 }
 
+TEST(HttpHelpersTest, MsgPack) {
+    ASSERT_TRUE(dice::isMsgPack("application/msgpack"));
+    ASSERT_TRUE(dice::isMsgPack("application/x-msgpack"));
+    ASSERT_TRUE(dice::isMsgPack(" application/msgpack; v=1"));
+    ASSERT_FALSE(dice::isMsgPack("application/json"));
+    ASSERT_FALSE(dice::isMsgPack("application/msgpack1"));
+    ASSERT_FALSE(dice::isMsgPack(""));
+}
+
+TEST(HttpHelpersTest, AcceptEncoding) {
+    using dice::Encoding;
+    const dice::AcceptEncoding accept{"deflate, gzip;q=1.0, br;q=0.9, *;q=0.5"};
+    ASSERT_EQ(1000, accept.q(Encoding::GZIP));
+    ASSERT_EQ(900, accept.q(Encoding::BR));
+    ASSERT_EQ(500, accept.q(Encoding::ZSTD));
+    ASSERT_EQ(500, accept.q(Encoding::IDENTITY));
+}
+
+TEST(HttpHelpersTest, AcceptEncodingZero) {
+    using dice::Encoding;
+    const dice::AcceptEncoding accept{"gzip, br;q=0"};
+    ASSERT_FALSE(accept.accepts(Encoding::BR));
+    ASSERT_TRUE(accept.accepts(Encoding::GZIP));
+    ASSERT_FALSE(accept.accepts(Encoding::ZSTD));
+    // Identity is acceptable unless excluded
+    ASSERT_TRUE(accept.accepts(Encoding::IDENTITY));
+    ASSERT_FALSE(dice::AcceptEncoding{"*;q=0"}.accepts(Encoding::IDENTITY));
+    ASSERT_FALSE(dice::AcceptEncoding{"identity;q=0, *"}.accepts(Encoding::IDENTITY));
+    ASSERT_TRUE(dice::AcceptEncoding{"identity;q=0, *"}.accepts(Encoding::BR));
+}
+
+TEST(HttpHelpersTest, AcceptEncodingNoHeader) {
+    using dice::Encoding;
+    for (const auto& accept : {dice::AcceptEncoding{}, dice::AcceptEncoding{""}})
+    {
+        ASSERT_TRUE(accept.accepts(Encoding::IDENTITY));
+        ASSERT_FALSE(accept.accepts(Encoding::BR));
+        ASSERT_FALSE(accept.accepts(Encoding::GZIP));
+    }
+}
+
+TEST(HttpHelpersTest, AcceptEncodingSyntax) {
+    using dice::Encoding;
+    const dice::AcceptEncoding accept{" BR ; Q=0.25 ,x-gzip;level=1;q=0.5,,zstd;q=2, identity;q=0.1234"};
+    ASSERT_EQ(250, accept.q(Encoding::BR));
+    ASSERT_EQ(500, accept.q(Encoding::GZIP));
+    // Invalid q-values are ignored
+    ASSERT_EQ(0, accept.q(Encoding::ZSTD));
+    ASSERT_EQ(1, accept.q(Encoding::IDENTITY));
+}
+
+TEST(HttpHelpersTest, SelectEncoding) {
+    using dice::Encoding;
+    const auto all = dice::encodingBit(Encoding::IDENTITY) | dice::encodingBit(Encoding::BR) |
+        dice::encodingBit(Encoding::GZIP) | dice::encodingBit(Encoding::ZSTD);
+    const auto plain = dice::encodingBit(Encoding::IDENTITY);
+    ASSERT_EQ(Encoding::BR, dice::AcceptEncoding{"gzip, deflate, br"}.select(all));
+    ASSERT_EQ(Encoding::ZSTD, dice::AcceptEncoding{"gzip, zstd"}.select(all));
+    ASSERT_EQ(Encoding::GZIP, dice::AcceptEncoding{"gzip, br;q=0.5"}.select(all));
+    ASSERT_EQ(Encoding::GZIP, dice::AcceptEncoding{"gzip, br;q=0"}.select(all));
+    ASSERT_EQ(Encoding::IDENTITY, dice::AcceptEncoding{"gzip"}.select(plain));
+    ASSERT_EQ(Encoding::IDENTITY, dice::AcceptEncoding{"br;q=0"}.select(all));
+    ASSERT_EQ(Encoding::IDENTITY, dice::AcceptEncoding{}.select(all));
+    // Nothing acceptable
+    ASSERT_EQ(Encoding::IDENTITY, dice::AcceptEncoding{"*;q=0"}.select(all));
+}
 
 } // Unnamed namespace
\ No newline at end of file
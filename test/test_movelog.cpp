@@ -0,0 +1,64 @@
+#include "movelog.hpp"
+
+#include "gtest/gtest.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace {
+
+using dice::Move;
+using dice::MoveLog;
+
+TEST(MoveLogTest, Names) {
+    MoveLog log;
+    ASSERT_EQ(0, log.intern("joe"));
+    ASSERT_EQ(1, log.intern("ann"));
+    ASSERT_EQ(0, log.intern("joe"));
+    ASSERT_EQ("ann", log.name(1));
+}
+
+TEST(MoveLogTest, Append) {
+    MoveLog log;
+    ASSERT_TRUE(log.complete());
+    ASSERT_FALSE(MoveLog{false}.complete());
+    constexpr int N = 5000;
+    for (int i = 0; i < N; ++i) log.push(Move{Move::BID, 2, 0, i});
+    ASSERT_EQ(0, log.begin());
+    ASSERT_EQ(N, log.end());
+
+    std::vector<std::int32_t> values;
+    log.forEach(4990, [&](std::uint64_t seq, const Move& m)
+    {
+        ASSERT_EQ(static_cast<std::int32_t>(seq), m.value);
+        values.push_back(m.value);
+    });
+    ASSERT_EQ(10, values.size());
+    ASSERT_EQ(4990, values.front());
+
+    values.clear();
+    log.forEach(0, [&](std::uint64_t, const Move& m) { values.push_back(m.value); });
+    ASSERT_EQ(N, values.size());
+    for (int i = 0; i < N; ++i) ASSERT_EQ(i, values[static_cast<std::size_t>(i)]);
+}
+
+TEST(MoveLogTest, DropOldest) {
+    MoveLog log;
+    const std::size_t max = MoveLog::MAX_MOVES;
+    const auto n = max * 3;
+    for (std::size_t i = 0; i < n; ++i) log.push(Move{Move::ROLL, 0, 0, static_cast<std::int32_t>(i)});
+    ASSERT_EQ(n, log.end());
+    ASSERT_GT(log.begin(), 0);
+    ASSERT_LE(log.end() - log.begin(), max);
+    ASSERT_FALSE(log.complete());
+
+    auto next = log.begin();
+    log.forEach(0, [&](std::uint64_t seq, const Move& m)
+    {
+        ASSERT_EQ(next++, seq);
+        ASSERT_EQ(static_cast<std::int32_t>(seq), m.value);
+    });
+    ASSERT_EQ(log.end(), next);
+}
+
+} // unnamed namespace
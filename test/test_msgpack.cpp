@@ -0,0 +1,94 @@
+#include "msgpack.hpp"
+
+#include "bid.hpp"
+#include "helpers.hpp"
+
+#include "gtest/gtest.h"
+
+#include <string>
+
+namespace {
+
+using namespace std;
+
+TEST(MsgPackTest, Scalars) {
+    msgpack::Writer w;
+    w.StartArray();
+    w.Int(1);
+    w.Int(-1);
+    w.Int(200);
+    w.Int(-200);
+    w.Uint64(70000);
+    w.Bool(true);
+    w.Null();
+    w.String("ab");
+    w.EndArray();
+    const std::string expected{
+        "\x98"
+        "\x01"
+        "\xff"
+        "\xcc\xc8"
+        "\xd1\xff\x38"
+        "\xce\x00\x01\x11\x70"
+        "\xc3"
+        "\xc0"
+        "\xa2" "ab", 18};
+    ASSERT_EQ(expected, w.str());
+}
+
+TEST(MsgPackTest, Headers) {
+    // The reserved header space is compacted to the smallest header
+    msgpack::Writer w;
+    w.StartObject();
+    w.Key("a");
+    w.StartArray();
+    for (int i = 0; i < 16; ++i) w.Int(i);
+    w.EndArray();
+    w.EndObject();
+    ASSERT_EQ(1 + 2 + 3 + 16, w.str().size());
+    ASSERT_EQ('\x81', w.str()[0]);
+    ASSERT_EQ('\xdc', w.str()[3]);
+    ASSERT_EQ(R"({"a":[0,1,2,3,4,5,6,7,8,9,10,11,12,13,14,15]})", msgpack::toJson(w.str()));
+}
+
+TEST(MsgPackTest, RoundTrip) {
+    const std::string json =
+        R"({"success":true,"id":"1234","game":{"bid":{"n":3,"face":6},)"
+        R"("hand":[1,2,0],"seed":18446744073709551615,"neg":-100000,)"
+        R"("empty":{},"none":null,"x":1.5,"s":")" + std::string(300, 's') + R"("}})";
+    const auto packed = msgpack::fromJson(json);
+    ASSERT_FALSE(packed.empty());
+    ASSERT_LT(packed.size(), json.size());
+    ASSERT_EQ(json, msgpack::toJson(packed));
+}
+
+TEST(MsgPackTest, Invalid) {
+    const auto packed = msgpack::fromJson(R"({"id":"1","n":[1,2]})");
+    // Truncated
+    for (std::size_t i = 0; i < packed.size(); ++i)
+    {
+        ASSERT_EQ("", msgpack::toJson(packed.substr(0, i)));
+    }
+    // Trailing bytes
+    ASSERT_EQ("", msgpack::toJson(packed + '\x01'));
+    // Non-string key
+    ASSERT_EQ("", msgpack::toJson("\x81\x01\x01"));
+    // Binary
+    ASSERT_EQ("", msgpack::toJson(std::string{"\xc4\x01\x00", 3}));
+    // Too deep
+    ASSERT_EQ("", msgpack::toJson(std::string(100, '\x91') + '\x01'));
+    ASSERT_EQ("", msgpack::fromJson("{"));
+}
+
+TEST(MsgPackTest, SameSchema) {
+    // The json serialization code writes MessagePack as well
+    dice::Bid bid{4, 2};
+    msgpack::Writer w;
+    bid.serialize(w);
+    rapidjson::StringBuffer s;
+    json::Writer jw{s};
+    bid.serialize(jw);
+    ASSERT_EQ(dice::parse(s.GetString()), dice::parse(msgpack::toJson(w.str())));
+}
+
+} // Unnamed namespace
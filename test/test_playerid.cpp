@@ -0,0 +1,61 @@
+#include "playerid.hpp"
+
+#include "gtest/gtest.h"
+
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+namespace {
+
+using namespace std;
+using dice::PlayerId;
+
+TEST(PlayerIdTest, Format) {
+    ASSERT_EQ("00000000-0000-0000-0000-000000000001", (PlayerId{0, 1}.str()));
+    ASSERT_EQ("01234567-89ab-cdef-fedc-ba9876543210",
+              (PlayerId{0x0123456789abcdefull, 0xfedcba9876543210ull}.str()));
+}
+
+TEST(PlayerIdTest, Parse) {
+    const auto id = PlayerId::fromString("6A4BD0C5-7a4c-4b0c-9d8e-2f6e0b7c1d3a");
+    ASSERT_FALSE(id.nil());
+    ASSERT_EQ("6a4bd0c5-7a4c-4b0c-9d8e-2f6e0b7c1d3a", id.str());
+
+    ASSERT_TRUE(PlayerId::fromString("").nil());
+    ASSERT_TRUE(PlayerId::fromString("1").nil());
+    ASSERT_TRUE(PlayerId::fromString("6a4bd0c5-7a4c-4b0c-9d8e-2f6e0b7c1d3").nil());
+    ASSERT_TRUE(PlayerId::fromString("6a4bd0c5-7a4c-4b0c-9d8e-2f6e0b7c1d3g").nil());
+    ASSERT_TRUE(PlayerId::fromString("6a4bd0c5-7a4c-4b0c-9d8e+2f6e0b7c1d3a").nil());
+    ASSERT_TRUE(PlayerId::fromString("6a4bd0c5a7a4c-4b0c-9d8e-2f6e0b7c1d3a").nil());
+}
+
+TEST(PlayerIdTest, Generate) {
+    std::unordered_set<PlayerId> ids;
+    for (int i = 0; i < 10000; ++i)
+    {
+        const auto id = PlayerId::generate();
+        const auto str = id.str();
+        // Version 4, variant 1
+        ASSERT_EQ('4', str[14]);
+        ASSERT_NE(std::string::npos, std::string{"89ab"}.find(str[19]));
+        ASSERT_EQ(id, PlayerId::fromString(str));
+        ASSERT_TRUE(ids.insert(id).second);
+    }
+}
+
+TEST(PlayerIdTest, Threads) {
+    constexpr int N = 10000;
+    std::vector<std::vector<PlayerId>> perThread(4);
+    std::vector<std::thread> threads;
+    for (auto& ids : perThread)
+    {
+        threads.emplace_back([&ids] { for (int i = 0; i < N; ++i) ids.push_back(PlayerId::generate()); });
+    }
+    for (auto& t : threads) t.join();
+    std::unordered_set<PlayerId> all;
+    for (const auto& ids : perThread) all.insert(ids.begin(), ids.end());
+    ASSERT_EQ(perThread.size() * N, all.size());
+}
+
+} // Unnamed namespace
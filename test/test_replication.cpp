@@ -0,0 +1,104 @@
+#include "replication.hpp"
+
+#include "engine.hpp"
+#include "helpers.hpp"
+#include "json.hpp"
+#include "test/test_helpers.hpp"
+
+#include "gtest/gtest.h"
+
+#include <chrono>
+#include <functional>
+#include <string>
+#include <thread>
+
+namespace {
+
+// Wait until the condition holds, at most two seconds
+bool eventually(const std::function<bool()>& condition)
+{
+    for (int i = 0; i < 200; ++i)
+    {
+        if (condition()) return true;
+        std::this_thread::sleep_for(std::chrono::milliseconds{10});
+    }
+    return condition();
+}
+
+std::string login(dice::Engine& e, const std::string& name)
+{
+    const auto doc = parse(e.login(json::Json({"name", name}).str()));
+    return json::getString(doc, "id");
+}
+
+std::string body(const std::string& id)
+{
+    return json::Json({"id", id}).str();
+}
+
+TEST(ReplicationTest, FollowAndPromote) {
+    const auto path = tmpName("/tmp/bluff-replication-");
+    dice::Engine primary{""};
+    dice::Engine standby{""};
+    // Already there for the snapshot
+    const auto a = login(primary, "a");
+    ASSERT_TRUE(parse(primary.createGame(json::Json({{"id", a}, {"game", "g"}}).str()))["success"].GetBool());
+
+    dice::Replicator replicator{primary, path};
+    dice::Follower follower{standby, path};
+    ASSERT_TRUE(eventually([&] { return follower.connected(); }));
+    ASSERT_EQ(1, replicator.followers());
+
+    // Streamed
+    const auto b = login(primary, "b");
+    ASSERT_TRUE(parse(primary.joinGame(json::Json({{"id", b}, {"game", "g"}}).str()))["success"].GetBool());
+    ASSERT_TRUE(parse(primary.startGame(body(a)))["success"].GetBool());
+    ASSERT_TRUE(eventually([&] { return standby.status(body(a)) == primary.status(body(a)); }));
+    ASSERT_TRUE(eventually([&] { return standby.status(body(b)) == primary.status(body(b)); }));
+    ASSERT_EQ(primary.getGames(), standby.getGames());
+    ASSERT_GE(replicator.entries(), 3);
+
+    // The standby takes over with the dice and the turn of the primary
+    follower.promote();
+    ASSERT_TRUE(follower.promoted());
+    const auto status = parse(standby.status(body(a)));
+    const auto turn = json::getInt(status["game"], "turn");
+    const auto& next = turn == 0 ? a : b;
+    const auto bid = json::Json({{"id", next}, {"n", 1}, {"face", 2}}).str();
+    ASSERT_TRUE(parse(standby.bid(bid))["success"].GetBool());
+
+    // Not following anymore
+    primary.logout(body(a));
+    std::this_thread::sleep_for(std::chrono::milliseconds{50});
+    ASSERT_TRUE(parse(standby.status(body(a))).HasMember("game"));
+}
+
+TEST(ReplicationTest, Removed) {
+    // Players and games removed on the primary are removed on the follower
+    const auto path = tmpName("/tmp/bluff-replication-");
+    dice::Engine primary{""};
+    dice::Engine standby{""};
+    dice::Replicator replicator{primary, path};
+    dice::Follower follower{standby, path};
+    ASSERT_TRUE(eventually([&] { return follower.connected(); }));
+
+    primary.setTimeouts(std::chrono::seconds{10}, std::chrono::seconds{10});
+    const auto a = login(primary, "a");
+    primary.createGame(json::Json({{"id", a}, {"game", "g"}}).str());
+    primary.logout(body(a));
+    ASSERT_TRUE(eventually([&] { return standby.getGames() == primary.getGames(); }));
+    ASSERT_TRUE(parse(standby.status(body(a)))["success"].GetBool());
+
+    primary.expire(std::chrono::steady_clock::now() + std::chrono::seconds{30});
+    ASSERT_TRUE(eventually([&] { return standby.getGames() == primary.getGames(); }));
+    ASSERT_STREQ("NO_PLAYER", json::getString(parse(standby.status(body(a))), "error"));
+}
+
+TEST(ReplicationTest, Invalid) {
+    dice::Engine e{""};
+    ASSERT_FALSE(e.apply("nope"));
+    ASSERT_FALSE(e.restore("{}"));
+    ASSERT_TRUE(e.apply(R"({"players": [], "games": []})"));
+}
+
+} // unnamed namespace
@@ -0,0 +1,81 @@
+#include "request.hpp"
+
+#include "helpers.hpp"
+#include "json.hpp"
+
+#include "gtest/gtest.h"
+
+#include <string>
+
+namespace {
+
+using namespace std;
+using dice::Request;
+
+TEST(RequestTest, Fields) {
+    const auto r = dice::decodeRequest(
+        R"({"id": "1234", "game": "g\"1", "name": "Joe", "n": 3, "face": 6, "hash": 42, "since": 7})");
+    ASSERT_TRUE(r.has(Request::ID | Request::GAME | Request::NAME |
+                      Request::N | Request::FACE | Request::HASH | Request::SINCE));
+    ASSERT_EQ("1234", r.id.to_string());
+    ASSERT_EQ("g\"1", r.game.to_string());
+    ASSERT_EQ("Joe", r.name.to_string());
+    ASSERT_EQ(3, r.n);
+    ASSERT_EQ(6, r.face);
+    ASSERT_EQ(42, r.hash);
+    ASSERT_EQ(7, r.since);
+}
+
+TEST(RequestTest, Missing) {
+    const auto r = dice::decodeRequest(R"({"id": "1", "other": {"face": 1, "n": [2]}})");
+    ASSERT_TRUE(r.has(Request::ID));
+    // Nested objects are not searched
+    ASSERT_FALSE(r.has(Request::N));
+    ASSERT_FALSE(r.has(Request::FACE));
+    ASSERT_EQ(-1, r.hash);
+    ASSERT_NO_THROW(r.require(Request::ID));
+    ASSERT_THROW(r.require(Request::ID | Request::N), json::ParseError);
+}
+
+TEST(RequestTest, Invalid) {
+    ASSERT_THROW(dice::decodeRequest(""), json::ParseError);
+    ASSERT_THROW(dice::decodeRequest("[1, 2]"), json::ParseError);
+    ASSERT_THROW(dice::decodeRequest(R"("id")"), json::ParseError);
+    ASSERT_THROW(dice::decodeRequest(R"({"id": "1")"), json::ParseError);
+    ASSERT_THROW(dice::decodeRequest(R"({"id": "1"} {})"), json::ParseError);
+    // Wrong types
+    ASSERT_THROW(dice::decodeRequest(R"({"id": 1})"), json::ParseError);
+    ASSERT_THROW(dice::decodeRequest(R"({"n": "3"})"), json::ParseError);
+    ASSERT_THROW(dice::decodeRequest(R"({"face": 1.5})"), json::ParseError);
+    ASSERT_THROW(dice::decodeRequest(R"({"hash": 4294967295})"), json::ParseError);
+    ASSERT_THROW(dice::decodeRequest(R"({"game": {"name": "g"}})"), json::ParseError);
+    ASSERT_THROW(dice::decodeRequest(R"({"name": null})"), json::ParseError);
+}
+
+TEST(RequestTest, Schema) {
+    // Fields outside the schema are skipped whatever their type
+    const auto r = dice::decodeRequest<Request::PLAYER>(
+        R"({"id": "1", "n": "x", "game": [1], "hash": null})");
+    ASSERT_EQ(Request::ID, r.fields);
+    ASSERT_EQ("1", r.id.to_string());
+    ASSERT_EQ(-1, r.hash);
+
+    const auto b = dice::decodeRequest<Request::BID>(R"({"n": 2, "face": -1, "id": "x"})");
+    ASSERT_TRUE(b.has(Request::BID));
+    ASSERT_EQ(2, b.n);
+    ASSERT_EQ(-1, b.face);
+}
+
+TEST(RequestTest, Large) {
+    // Many members to skip
+    std::string body = R"({"id": "1")";
+    for (int i = 0; i < 1000; ++i) body += ", \"k" + std::to_string(i) + "\": [1, 2, 3]";
+    body += R"(, "game": "g"})";
+    const auto r = dice::decodeRequest(body);
+    ASSERT_EQ("1", r.id.to_string());
+    ASSERT_EQ("g", r.game.to_string());
+    // And the next one still works
+    ASSERT_EQ("2", dice::decodeRequest(R"({"id": "2"})").id.to_string());
+}
+
+} // Unnamed namespace
@@ -0,0 +1,74 @@
+#include "rng.hpp"
+
+#include "gtest/gtest.h"
+
+#include <array>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using namespace std;
+
+TEST(RngTest, Seeded) {
+    dice::Xoshiro256 a{42};
+    dice::Xoshiro256 b{42};
+    dice::Xoshiro256 c{43};
+    for (int i = 0; i < 100; ++i)
+    {
+        const auto x = a();
+        ASSERT_EQ(x, b());
+        ASSERT_NE(x, c());
+    }
+}
+
+TEST(RngTest, Jump) {
+    dice::Xoshiro256 a{1};
+    dice::Xoshiro256 b{1};
+    b.jump();
+    ASSERT_FALSE(a == b);
+    a.jump();
+    ASSERT_TRUE(a == b);
+}
+
+TEST(RngTest, ThreadRng) {
+    // Every thread gets its own generator
+    const auto* mine = &dice::threadRng();
+    const dice::Xoshiro256* other = nullptr;
+    std::thread t{[&other]{ other = &dice::threadRng(); }};
+    t.join();
+    ASSERT_NE(mine, other);
+}
+
+TEST(RngTest, Uniform) {
+    // Pearson's chi-squared test with 5 degrees of freedom. The critical
+    // value for p = 0.001 is 20.515.
+    constexpr int N = 600000;
+    std::vector<int> faces(N);
+    dice::Xoshiro256 rng{2018};
+    dice::fillDice(rng, faces.data(), faces.size());
+
+    std::array<int, 7> counts{};
+    for (auto f : faces)
+    {
+        ASSERT_TRUE(1 <= f && f <= 6);
+        ++counts[static_cast<std::size_t>(f)];
+    }
+    const double expected = N / 6.0;
+    double chi2 = 0.0;
+    for (int f = 1; f <= 6; ++f)
+    {
+        const double d = counts[static_cast<std::size_t>(f)] - expected;
+        chi2 += d * d / expected;
+    }
+    ASSERT_LT(chi2, 20.515);
+}
+
+TEST(RngTest, FillOdd) {
+    std::array<std::uint8_t, 7> faces{};
+    dice::Xoshiro256 rng{5};
+    dice::fillDice(rng, faces.data(), faces.size());
+    for (auto f : faces) ASSERT_TRUE(1 <= f && f <= 6);
+}
+
+} // Unnamed namespace
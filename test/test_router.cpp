@@ -0,0 +1,172 @@
+#include "router.hpp"
+
+#include "engine.hpp"
+#include "helpers.hpp"
+#include "json.hpp"
+#include "msgpack.hpp"
+#include "shard.hpp"
+#include "test/test_helpers.hpp"
+
+#include "gtest/gtest.h"
+
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using dice::Format;
+
+// Shards served by this process for the lifetime of the tests
+const std::vector<std::string>& shards()
+{
+    static const std::vector<std::string> paths = []
+    {
+        std::vector<std::string> paths;
+        for (int i = 0; i < 2; ++i)
+        {
+            paths.push_back(tmpName("/tmp/bluff-shard-"));
+            auto* engine = new dice::Engine{""};
+            std::thread{[engine, path = paths.back()] { dice::serveShard(*engine, path); }}.detach();
+        }
+        // Wait until the sockets accept
+        for (const auto& path : paths)
+        {
+            dice::ShardClient client{path};
+            for (int i = 0; i < 100; ++i)
+            {
+                try {
+                    client.call("/api/metrics", "", Format::JSON);
+                    break;
+                } catch (const std::exception&) {
+                    std::this_thread::sleep_for(std::chrono::milliseconds{10});
+                }
+            }
+        }
+        return paths;
+    }();
+    return paths;
+}
+
+// Name of a new game on the given shard
+std::string gameOn(const dice::Router& router, std::size_t shard)
+{
+    static int n = 0;
+    for (;;)
+    {
+        const auto game = "game" + std::to_string(n++);
+        if (router.shard(game) == shard) return game;
+    }
+}
+
+std::string login(dice::Router& router, const std::string& name)
+{
+    const auto doc = parse(router.call("/api/login", json::Json({"name", name}).str(), Format::JSON));
+    EXPECT_TRUE(doc["success"].GetBool());
+    return json::getString(doc, "id");
+}
+
+auto call(dice::Router& router, const std::string& route, const std::string& id, const std::string& game = "")
+{
+    const auto body = game.empty() ?
+        json::Json({"id", id}).str() :
+        json::Json({{"id", id}, {"game", game}}).str();
+    return parse(router.call(route, body, Format::JSON));
+}
+
+TEST(RouterTest, Games) {
+    dice::Router router{shards()};
+    const auto a = login(router, "router-a");
+    const auto b = login(router, "router-b");
+    const auto game0 = gameOn(router, 0);
+    const auto game1 = gameOn(router, 1);
+
+    ASSERT_TRUE(call(router, "/api/newGame", a, game0)["success"].GetBool());
+    ASSERT_TRUE(call(router, "/api/newGame", b, game1)["success"].GetBool());
+
+    auto status = call(router, "/api/status", a);
+    ASSERT_STREQ("router-a", json::getString(status, "name"));
+    ASSERT_STREQ(game0.c_str(), json::getString(status["game"], "game"));
+    status = call(router, "/api/status", b);
+    ASSERT_STREQ(game1.c_str(), json::getString(status["game"], "game"));
+
+    // Listed from both shards
+    const auto games = parse(router.call("/api/games", "", Format::JSON));
+    ASSERT_TRUE(games.IsArray());
+    int found = 0;
+    for (const auto& g : games.GetArray())
+    {
+        const std::string name = json::getString(g, "game");
+        if (name == game0 || name == game1) ++found;
+    }
+    ASSERT_EQ(2, found);
+
+    const auto metrics = parse(router.call("/api/metrics", "", Format::JSON));
+    ASSERT_EQ(2, json::getInt(metrics, "shards"));
+    ASSERT_EQ(0, json::getInt(metrics, "unavailableShards"));
+    ASSERT_GE(json::getInt(metrics, "games"), 2);
+
+    ASSERT_TRUE(call(router, "/api/logout", a)["success"].GetBool());
+    ASSERT_TRUE(call(router, "/api/logout", b)["success"].GetBool());
+}
+
+TEST(RouterTest, FollowGame) {
+    // The player is logged in on the shard of the game
+    dice::Router router{shards()};
+    const auto a = login(router, "router-c");
+    const auto b = login(router, "router-d");
+    const auto game0 = gameOn(router, 0);
+    const auto game1 = gameOn(router, 1);
+
+    ASSERT_TRUE(call(router, "/api/newGame", a, game0)["success"].GetBool());
+    ASSERT_TRUE(call(router, "/api/join", b, game0)["success"].GetBool());
+    // One game at a time
+    ASSERT_STREQ("ALREADY_JOINED", json::getString(call(router, "/api/join", a, game1), "error"));
+
+    // Leave and move to the other shard
+    ASSERT_TRUE(call(router, "/api/logout", a)["success"].GetBool());
+    ASSERT_TRUE(call(router, "/api/newGame", a, game1)["success"].GetBool());
+    const auto status = call(router, "/api/status", a);
+    ASSERT_STREQ(game1.c_str(), json::getString(status["game"], "game"));
+
+    // MessagePack is forwarded as is
+    const auto packed = router.call("/api/status", msgpack::fromJson(json::Json({"id", b}).str()), Format::MSGPACK);
+    const auto doc = parse(msgpack::toJson(packed));
+    ASSERT_STREQ(game0.c_str(), json::getString(doc["game"], "game"));
+
+    ASSERT_TRUE(call(router, "/api/logout", a)["success"].GetBool());
+    ASSERT_TRUE(call(router, "/api/logout", b)["success"].GetBool());
+}
+
+TEST(RouterTest, Restart) {
+    // A new router finds the players on the shards
+    std::string id;
+    const std::string game = gameOn(dice::Router{shards()}, 1);
+    {
+        dice::Router router{shards()};
+        id = login(router, "router-e");
+        ASSERT_TRUE(call(router, "/api/newGame", id, game)["success"].GetBool());
+    }
+    dice::Router router{shards()};
+    const auto status = call(router, "/api/status", id);
+    ASSERT_STREQ("router-e", json::getString(status, "name"));
+    ASSERT_STREQ(game.c_str(), json::getString(status["game"], "game"));
+    ASSERT_TRUE(call(router, "/api/logout", id)["success"].GetBool());
+}
+
+TEST(RouterTest, Errors) {
+    dice::Router router{shards()};
+    ASSERT_STREQ("NO_PLAYER", json::getString(call(router, "/api/status", "00000000-0000-0000-0000-000000000001"), "error"));
+    ASSERT_STREQ("UNKNOWN_ROUTE", json::getString(parse(router.call("/api/nope", "{}", Format::JSON)), "error"));
+    ASSERT_STREQ("PARSE_ERROR", json::getString(parse(router.call("/api/login", "{}", Format::JSON)), "error"));
+
+    // A shard that is down
+    dice::Router down{{"/tmp/bluff-no-such-shard"}};
+    const auto doc = parse(down.call("/api/login", json::Json({"name", "x"}).str(), Format::JSON));
+    ASSERT_STREQ("SHARD_UNAVAILABLE", json::getString(doc, "error"));
+    const auto metrics = parse(down.call("/api/metrics", "", Format::JSON));
+    ASSERT_EQ(1, json::getInt(metrics, "unavailableShards"));
+}
+
+} // unnamed namespace
@@ -0,0 +1,151 @@
+#include "sim.hpp"
+#include "threadpool.hpp"
+
+#include "gtest/gtest.h"
+
+#include <chrono>
+#include <numeric>
+
+namespace dice {
+namespace sim {
+namespace {
+
+// Bids one more of the face than the current bid, never challenges
+class AlwaysRaise : public IStrategy
+{
+public:
+    const char* name() const override { return "raise"; }
+    Bid decide(const View& view, Rng&) const override
+    {
+        return Bid::fromScore(view.bid.score() + 1);
+    }
+};
+
+TEST(SimTest, Challenge) {
+    GameState game{2, 0};
+    Rng rng{1};
+    game.startRound(rng);
+    ASSERT_FALSE(game.challenge());
+    ASSERT_TRUE(game.bid({1, 1}));
+    ASSERT_FALSE(game.bid({1, 1}));
+    ASSERT_EQ(1, game.view().seat);
+    // 10 stars can't be right so seat 1 loses all of its dice
+    ASSERT_TRUE(game.bid({10, STAR}));
+    ASSERT_EQ(0, game.view().seat);
+    ASSERT_TRUE(game.challenge());
+    ASSERT_EQ(0, game.winner());
+}
+
+TEST(SimTest, PlayGame) {
+    RandomStrategy random;
+    ProbabilityStrategy probability;
+    std::vector<const IStrategy*> seats{&random, &probability, &random};
+    Rng rng{7};
+    Stats stats;
+    stats.wins.assign(seats.size(), 0);
+    for (int i = 0; i < 100; ++i)
+    {
+        const auto winner = playGame(seats, i % 3, rng, stats);
+        ASSERT_TRUE(0 <= winner && winner < 3);
+    }
+    ASSERT_EQ(100, stats.games);
+    ASSERT_EQ(100, std::accumulate(stats.wins.begin(), stats.wins.end(), 0LL));
+    ASSERT_GE(stats.rounds, 100 * 2);
+    ASSERT_GT(stats.moves, stats.rounds);
+}
+
+TEST(SimTest, RaiseForeverTerminates) {
+    AlwaysRaise raise;
+    std::vector<const IStrategy*> seats{&raise, &raise};
+    Rng rng{3};
+    Stats stats;
+    stats.wins.assign(seats.size(), 0);
+    playGame(seats, 0, rng, stats);
+    ASSERT_EQ(1, stats.games);
+}
+
+TEST(SimTest, Deterministic) {
+    ProbabilityStrategy probability;
+    RandomStrategy random;
+    std::vector<const IStrategy*> seats{&probability, &random};
+    Config config;
+    config.games = 1000;
+    config.threads = 2;
+    config.seed = 42;
+    const auto a = run(seats, config);
+    const auto b = run(seats, config);
+    ASSERT_EQ(1000, a.games);
+    ASSERT_EQ(a.wins, b.wins);
+    ASSERT_EQ(a.moves, b.moves);
+    // Expectation based play should beat random play
+    ASSERT_GT(a.winRate(0), a.winRate(1));
+}
+
+TEST(SimTest, SampledState) {
+    GameState game{3, 1};
+    Rng rng{5};
+    game.startRound(rng);
+    ASSERT_TRUE(game.bid({2, 3}));
+    const auto view = game.view();
+    GameState sampled{view, rng};
+    const auto v = sampled.view();
+    ASSERT_EQ(view.seat, v.seat);
+    ASSERT_EQ(view.totalDice, v.totalDice);
+    ASSERT_EQ(view.bid, v.bid);
+    ASSERT_TRUE(std::equal(view.hand, view.hand + view.handSize, v.hand));
+    // Seat 1 made the bid and loses all its dice if it's false
+    ASSERT_TRUE(sampled.bid({15, STAR}));
+    ASSERT_TRUE(sampled.challenge());
+    ASSERT_EQ(0, sampled.diceLeft(2));
+}
+
+TEST(SimTest, MonteCarlo) {
+    const auto far = MonteCarloStrategy::Clock::now() + std::chrono::hours{1};
+    ThreadPool pool{4};
+    const MonteCarloStrategy parallel{&pool, 64};
+    const MonteCarloStrategy single{nullptr, 64};
+    Rng rng{11};
+    for (int i = 0; i < 20; ++i)
+    {
+        GameState game{3, i % 3};
+        game.startRound(rng);
+        if (i % 2)
+        {
+            ASSERT_TRUE(game.bid(Bid::fromScore(i)));
+        }
+        const auto view = game.view();
+        Rng a{static_cast<std::uint64_t>(i)};
+        Rng b{static_cast<std::uint64_t>(i)};
+        const auto bid = parallel.decide(view, a, far);
+        // The same streams per candidate, whatever the threads
+        ASSERT_EQ(bid, single.decide(view, b, far));
+        ASSERT_TRUE(bid == Bid{} ? view.bid.valid() : view.bid < bid);
+    }
+
+    // Nothing is sampled after the deadline
+    GameState game{2, 0};
+    game.startRound(rng);
+    const auto view = game.view();
+    Rng a{1};
+    Rng b{1};
+    ASSERT_EQ(ProbabilityStrategy{}.decide(view, b),
+              parallel.decide(view, a, MonteCarloStrategy::Clock::now()));
+}
+
+TEST(SimTest, MonteCarloWinRate) {
+    // Every candidate gets all its rollouts so the outcome depends only on
+    // the seed
+    const MonteCarloStrategy montecarlo{nullptr, 32, std::chrono::hours{1}};
+    ProbabilityStrategy probability;
+    std::vector<const IStrategy*> seats{&montecarlo, &probability};
+    Config config;
+    config.games = 200;
+    config.threads = 2;
+    config.seed = 1;
+    const auto stats = run(seats, config);
+    ASSERT_GT(stats.winRate(0), 0.55);
+}
+
+} // Unnamed namespace
+} // namespace sim
+} // namespace dice
@@ -0,0 +1,89 @@
+#include "threadpool.hpp"
+
+#include "gtest/gtest.h"
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <set>
+#include <thread>
+
+namespace {
+
+using dice::TaskGroup;
+using dice::ThreadPool;
+
+TEST(ThreadPoolTest, RunAll) {
+    std::atomic<int> sum{0};
+    {
+        ThreadPool pool{4};
+        ASSERT_EQ(4, pool.size());
+        for (int i = 1; i <= 1000; ++i) pool.submit([&sum, i] { sum += i; });
+    }
+    ASSERT_EQ(500500, sum);
+}
+
+TEST(ThreadPoolTest, Nested) {
+    ThreadPool pool{3};
+    std::atomic<int> leaves{0};
+    TaskGroup group{pool};
+    // Binary tree of tasks, each level submitted from the workers
+    std::function<void(int)> split = [&](int depth)
+    {
+        if (depth == 0)
+        {
+            ++leaves;
+            return;
+        }
+        group.run([&split, depth] { split(depth - 1); });
+        group.run([&split, depth] { split(depth - 1); });
+    };
+    group.run([&split] { split(10); });
+    group.wait();
+    ASSERT_EQ(1024, leaves);
+}
+
+TEST(ThreadPoolTest, Steal) {
+    ThreadPool pool{4};
+    std::mutex mutex;
+    std::set<std::thread::id> ids;
+    TaskGroup group{pool};
+    // All the tasks go to the queue of one worker, the others steal
+    group.run([&]
+    {
+        for (int i = 0; i < 40; ++i)
+        {
+            group.run([&]
+            {
+                std::this_thread::sleep_for(std::chrono::milliseconds{1});
+                std::lock_guard<std::mutex> lock{mutex};
+                ids.insert(std::this_thread::get_id());
+            });
+        }
+    });
+    group.wait();
+    ASSERT_GT(ids.size(), 1);
+}
+
+TEST(ThreadPoolTest, WaitHelps) {
+    // The waiting thread runs the tasks itself while the only worker is busy
+    ThreadPool pool{1};
+    std::atomic<bool> started{false};
+    std::atomic<bool> release{false};
+    pool.submit([&started, &release]
+    {
+        started = true;
+        while (!release) std::this_thread::yield();
+    });
+    while (!started) std::this_thread::yield();
+    std::atomic<int> ran{0};
+    {
+        TaskGroup group{pool};
+        for (int i = 0; i < 10; ++i) group.run([&ran] { ++ran; });
+        group.wait();
+    }
+    ASSERT_EQ(10, ran);
+    release = true;
+}
+
+} // Unnamed namespace
@@ -0,0 +1,60 @@
+#include "timerwheel.hpp"
+
+#include "gtest/gtest.h"
+
+#include <string>
+#include <vector>
+
+namespace {
+
+using Fired = std::vector<std::pair<std::uint64_t, std::string>>;
+
+TEST(TimerWheelTest, Fire) {
+    dice::TimerWheel<std::string> w;
+    w.schedule("c", 5000);
+    w.schedule("a", 3);
+    w.schedule("b", 64);
+    ASSERT_EQ(3, w.size());
+
+    Fired fired;
+    auto onExpire = [&](const std::string& key) { fired.emplace_back(w.now(), key); };
+    w.advance(2, onExpire);
+    ASSERT_TRUE(fired.empty());
+    w.advance(100, onExpire);
+    ASSERT_EQ(Fired({{3, "a"}, {64, "b"}}), fired);
+    w.advance(10000, onExpire);
+    ASSERT_EQ(3, fired.size());
+    ASSERT_EQ(5000, fired[2].first);
+    ASSERT_EQ(0, w.size());
+}
+
+TEST(TimerWheelTest, Past) {
+    dice::TimerWheel<int> w{100};
+    w.schedule(1, 50);
+    int fired = 0;
+    w.advance(101, [&](int) { ++fired; });
+    ASSERT_EQ(1, fired);
+}
+
+TEST(TimerWheelTest, Reschedule) {
+    dice::TimerWheel<int> w;
+    w.schedule(1, 10);
+    int fired = 0;
+    w.advance(1000, [&](int key) {
+        ++fired;
+        if (fired < 5) w.schedule(key, w.now() + 10);
+    });
+    ASSERT_EQ(5, fired);
+}
+
+TEST(TimerWheelTest, FarFuture) {
+    // Beyond the span of the wheel
+    dice::TimerWheel<int> w;
+    const std::uint64_t far = (std::uint64_t{1} << 24) + 12345;
+    w.schedule(1, far);
+    std::uint64_t firedAt = 0;
+    w.advance(far + 10, [&](int) { firedAt = w.now(); });
+    ASSERT_EQ(far, firedAt);
+}
+
+} // Unnamed namespace
@@ -2,6 +2,9 @@
 
 #include "gtest/gtest.h"
 
+#include <chrono>
+#include <iostream>
+
 namespace {
 
 using namespace std;
@@ -76,4 +79,81 @@ TEST(TokenizerTest, MultipleDelimiters) {
     ASSERT_EQ("c", tokens[2]);
 }
 
+TEST(TokenizerTest, Long) {
+    // Tokens crossing the 16 byte chunks
+    std::string str;
+    std::vector<std::string> expected;
+    for (std::size_t i = 1; i < 40; ++i)
+    {
+        expected.push_back(std::string(i, static_cast<char>('a' + i % 26)));
+        str += expected.back() + std::string(i % 20 + 1, ',');
+    }
+    dice::Tokenizer tok{str, ","};
+    ASSERT_EQ(expected, tok.tokens());
+}
+
+TEST(TokenizerTest, ManyDelimiters) {
+    // More delimiters than compared with SIMD
+    dice::Tokenizer tok{"a b,c;d:e|f\tg", " ,;:|\t"};
+    const auto tokens = tok.tokens();
+    ASSERT_EQ(7, tokens.size());
+    ASSERT_EQ("g", tokens[6]);
+}
+
+TEST(TokenizerTest, HighBytes) {
+    dice::Tokenizer tok{"\xe4\xff\xe5\xff", "\xff"};
+    const auto tokens = tok.tokens();
+    ASSERT_EQ(2, tokens.size());
+    ASSERT_EQ("\xe4", tokens[0]);
+    ASSERT_EQ("\xe5", tokens[1]);
+}
+
+TEST(TokenizerTest, StringView) {
+    // Not null terminated
+    const std::experimental::string_view str{"a;b,c", 3};
+    dice::Tokenizer tok{str, ";"};
+    const auto tokens = tok.tokens();
+    ASSERT_EQ(2, tokens.size());
+    ASSERT_EQ("b", tokens[1]);
+}
+
+TEST(TokenizerTest, KeepEmpty) {
+    dice::Tokenizer tok{",a,,bc,", ",", dice::Tokenizer::KEEP_EMPTY};
+    const auto tokens = tok.tokenViews();
+    ASSERT_EQ(5, tokens.size());
+    ASSERT_EQ("", tokens[0]);
+    ASSERT_EQ("a", tokens[1]);
+    ASSERT_EQ("", tokens[2]);
+    ASSERT_EQ("bc", tokens[3]);
+    ASSERT_EQ("", tokens[4]);
+}
+
+TEST(TokenizerTest, KeepEmptyNext) {
+    dice::Tokenizer tok{"a,,b", ",", dice::Tokenizer::KEEP_EMPTY};
+    ASSERT_FALSE(tok.done());
+    ASSERT_EQ(tok.next(), PL(0, 1));
+    ASSERT_EQ(tok.next(), PL(2, 0));
+    ASSERT_FALSE(tok.done());
+    ASSERT_EQ(tok.next(), PL(3, 1));
+    ASSERT_TRUE(tok.done());
+    ASSERT_EQ(tok.next(), PL(0, 0));
+
+    dice::Tokenizer empty{"", ",", dice::Tokenizer::KEEP_EMPTY};
+    ASSERT_EQ(1, empty.tokens().size());
+}
+
+TEST(TokenizerTest, Benchmark) {
+    const std::string header{"deflate, gzip;q=1.0, br;q=0.9, zstd;q=0.8, identity;q=0.5, *;q=0"};
+    constexpr int N = 1000000;
+    std::size_t sum = 0;
+    const auto t0 = std::chrono::steady_clock::now();
+    for (int i = 0; i < N; ++i)
+    {
+        dice::Tokenizer tok{header.c_str(), " ,;"};
+        for (auto t = tok.nextStringView(); !t.empty(); t = tok.nextStringView()) sum += t.size();
+    }
+    std::chrono::duration<double> dur = std::chrono::steady_clock::now() - t0;
+    cout << dur.count() / N * 1e9 << " ns per Accept-Encoding header (" << sum << ")" << endl;
+}
+
 } // Unnamed namespace
\ No newline at end of file
@@ -0,0 +1,63 @@
+#include "traffic.hpp"
+
+#include "engine.hpp"
+#include "filehelpers.hpp"
+#include "helpers.hpp"
+#include "msgpack.hpp"
+#include "test/test_helpers.hpp"
+
+#include "gtest/gtest.h"
+
+#include <cstdio>
+
+namespace {
+
+using namespace std;
+
+TEST(TrafficTest, RecordAndRead) {
+    TmpFile tmp{tmpName("./.jsonl")};
+    {
+        dice::Recorder recorder{tmp.str()};
+        recorder.record(10, "/api/login", R"({"name": "joe"})", dice::Format::JSON,
+                        R"({"success": true, "id": "00000000-0000-0000-0000-000000000007"})");
+        recorder.record(20, "/api/bid", msgpack::fromJson(R"({"id":"1","n":2})"), dice::Format::MSGPACK,
+                        msgpack::fromJson(R"({"success":true})"));
+    }
+    // Appends
+    dice::Recorder{tmp.str()}.record(30, "/api/games", "", dice::Format::JSON, "[]");
+    // Garbage is skipped
+    {
+        std::FILE* f = std::fopen(tmp.str().c_str(), "a");
+        std::fputs("not json\n{\"t\": \"x\"}\n", f);
+        std::fclose(f);
+    }
+
+    const auto records = dice::readTraffic(tmp.str());
+    ASSERT_EQ(3, records.size());
+    ASSERT_EQ(10, records[0].t);
+    ASSERT_EQ("/api/login", records[0].route);
+    ASSERT_EQ(R"({"name": "joe"})", records[0].body);
+    ASSERT_EQ(dice::Format::JSON, records[0].format);
+    ASSERT_EQ("00000000-0000-0000-0000-000000000007", records[0].player);
+    ASSERT_EQ(dice::Format::MSGPACK, records[1].format);
+    ASSERT_EQ(R"({"id":"1","n":2})", records[1].body);
+    ASSERT_EQ("", records[1].player);
+    ASSERT_EQ("/api/games", records[2].route);
+}
+
+TEST(TrafficTest, Dispatch) {
+    dice::Engine e{""};
+    auto doc = dice::parse(dice::dispatch(e, "/api/login", R"({"name": "joe"})", dice::Format::JSON));
+    ASSERT_TRUE(doc["success"].GetBool());
+    const std::string id = doc["id"].GetString();
+
+    const auto game = msgpack::fromJson(R"({"id":")" + id + R"(","game":"g"})");
+    doc = dice::parse(msgpack::toJson(dice::dispatch(e, "/api/newGame", game, dice::Format::MSGPACK)));
+    ASSERT_TRUE(doc["success"].GetBool());
+    ASSERT_EQ(e.getGames(), dice::dispatch(e, "/api/games", "", dice::Format::JSON));
+
+    doc = dice::parse(dice::dispatch(e, "/api/nope", "{}", dice::Format::JSON));
+    ASSERT_STREQ("UNKNOWN_ROUTE", doc["error"].GetString());
+}
+
+} // Unnamed namespace
@@ -1,10 +1,12 @@
 #include "atend.hpp"
 #include "bid.hpp"
+#include "bots.hpp"
 #include "dice.hpp"
 #include "helpers.hpp"
 #include "engine.hpp"
 #include "json.hpp"
 #include "game.hpp"
+#include "msgpack.hpp"
 #include "test/mockdice.hpp"
 #include "test/test_helpers.hpp"
 
@@ -14,6 +16,7 @@
 
 #include <rapidjson/document.h>
 
+#include <chrono>
 #include <cstdio>
 #include <functional>
 #include <iostream>
@@ -86,11 +89,86 @@ TEST(EngineTest, LoginInvalid) {
     EXPECT_STREQ(doc["error"].GetString(), "PARSE_ERROR");
 }
 
+TEST(EngineTest, LoginEmptyName) {
+    dice::Engine e{""};
+    EXPECT_STREQ("INVALID_NAME", parse(e.login(R"({"name": ""})"))["error"].GetString());
+
+    // A player with an empty name saved before the check sees all the dice
+    // but not the dice stream of the game
+    rapidjson::StringBuffer s;
+    json::Writer w{s};
+    const std::string id = "00000000-0000-0000-0000-000000000001";
+    json::Object(w, [&](auto& w)
+    {
+        json::ArrayW(w, "players", [&](auto& w)
+        {
+            json::Object(w, [&](auto& w)
+            {
+                json::KeyValue(w, "id", id);
+                json::KeyValue(w, "name", "");
+                json::KeyValue(w, "game", "g");
+            });
+            json::Object(w, [&](auto& w)
+            {
+                json::KeyValue(w, "id", "00000000-0000-0000-0000-000000000002");
+                json::KeyValue(w, "name", "joe");
+                json::KeyValue(w, "game", "g");
+            });
+        });
+        json::ArrayW(w, "games", [&](auto& w)
+        {
+            Game g{"g", "", 1};
+            g.addPlayer("joe");
+            g.startGame();
+            g.startRound();
+            g.serializeState(w);
+        });
+    });
+    auto tmp = tmpName("./.json");
+    AtEnd ae{[tmp]{ std::remove(tmp.c_str()); }};
+    dice::dump(tmp, s.GetString());
+
+    dice::Engine loaded{tmp};
+    const auto doc = parse(loaded.status(json::Json({"id", id}).str()));
+    ASSERT_TRUE(doc["success"].GetBool());
+    ASSERT_STREQ("ROUND_STARTED", doc["game"]["state"].GetString());
+    EXPECT_FALSE(doc["game"].HasMember("dice"));
+}
+
+TEST(EngineTest, LoginWithId) {
+    // Used by the shard router
+    dice::Engine e{""};
+    const std::string id = "6a4bd0c5-7a4c-4b0c-9d8e-2f6e0b7c1d3a";
+    auto doc = parse(e.shardLogin(json::Json({{"name", "anon"}, {"id", id}}).str()));
+    EXPECT_TRUE(doc["success"].GetBool());
+    EXPECT_EQ(id, doc["id"].GetString());
+
+    // Again on the same shard
+    doc = parse(e.shardLogin(json::Json({{"name", "anon"}, {"id", id}}).str()));
+    EXPECT_TRUE(doc["success"].GetBool());
+
+    doc = parse(e.shardLogin(json::Json({{"name", "other"}, {"id", id}}).str()));
+    EXPECT_STREQ("PLAYER_EXISTS", doc["error"].GetString());
+    doc = parse(e.shardLogin(json::Json({{"name", "anon"}, {"id", "6a4bd0c5-7a4c-4b0c-9d8e-2f6e0b7c1d3b"}}).str()));
+    EXPECT_STREQ("PLAYER_EXISTS", doc["error"].GetString());
+    doc = parse(e.shardLogin(json::Json({{"name", "other"}, {"id", "nope"}}).str()));
+    EXPECT_STREQ("INVALID_ID", doc["error"].GetString());
+
+    // The public login ignores the id
+    const std::string other = "6a4bd0c5-7a4c-4b0c-9d8e-2f6e0b7c1d3c";
+    doc = parse(e.login(json::Json({{"name", "public"}, {"id", other}}).str()));
+    EXPECT_TRUE(doc["success"].GetBool());
+    EXPECT_NE(other, doc["id"].GetString());
+    doc = parse(e.login(json::Json({{"name", "anon2"}, {"id", id}}).str()));
+    EXPECT_TRUE(doc["success"].GetBool());
+    EXPECT_NE(id, doc["id"].GetString());
+}
+
 TEST(EngineTest, CreateGameInvalidId) {
     dice::Engine e{""};
     auto game = R"#(
 {
-    "id": "000",
+    "id": "00000000-0000-0000-0000-000000000000",
     "game": "game"
 }
     )#";
@@ -245,11 +323,118 @@ TEST(EngineTest, Save) {
     e.save();
     EXPECT_TRUE(fileExists(tmp));
     //cout << slurp(tmp) << endl;
-    const auto doc = dice::parse(dice::slurp(tmp));
+    const auto doc = dice::parse(dice::slurpChecked(tmp));
     EXPECT_TRUE(doc["players"].IsArray());
     EXPECT_EQ(4, doc["players"].Size());
 
-    EXPECT_EQ(origData, dice::slurp(tmp));
+    EXPECT_EQ(origData, dice::slurpChecked(tmp));
+}
+
+TEST(EngineTest, LoadManyGames) {
+    // Enough games for loading them in parallel. joe is in the first and
+    // the last game and stays in the first, ghost is not a player.
+    constexpr int N = 10000;
+    rapidjson::StringBuffer s;
+    json::Writer w{s};
+    json::Object(w, [&](auto& w)
+    {
+        int n = 0;
+        const auto player = [&](const std::string& name)
+        {
+            char id[40];
+            std::snprintf(id, sizeof(id), "00000000-0000-0000-0000-%012d", ++n);
+            json::Object(w, [&](auto& w)
+            {
+                json::KeyValue(w, "id", id);
+                json::KeyValue(w, "name", name);
+            });
+        };
+        json::ArrayW(w, "players", [&](auto&)
+        {
+            player("joe");
+            for (int i = 0; i < N; ++i) player("p" + to_string(i));
+        });
+        json::ArrayW(w, "games", [&](auto& w)
+        {
+            for (int i = 0; i < N; ++i)
+            {
+                Game g{"g" + to_string(i), "p" + to_string(i), 1};
+                if (i == 0 || i == N - 1) g.addPlayer("joe");
+                if (i == N / 2) g.addPlayer("ghost");
+                g.serializeState(w);
+            }
+        });
+    });
+    auto tmp = tmpName("./.json");
+    AtEnd ae{[tmp]{ std::remove(tmp.c_str()); }};
+    dice::dump(tmp, s.GetString());
+
+    dice::Engine e{tmp};
+    const auto doc = dice::parse(e.getGames());
+    ASSERT_EQ(N, doc.Size());
+    int players = 0;
+    for (const auto& g : doc.GetArray())
+    {
+        const std::string name = g["game"].GetString();
+        players += static_cast<int>(g["players"].Size());
+        if (name == "g0") ASSERT_EQ(2, g["players"].Size());
+        if (name == "g" + to_string(N - 1)) ASSERT_EQ(1, g["players"].Size());
+    }
+    ASSERT_EQ(N + 1, players);
+}
+
+TEST(EngineTest, LoadCorrupt) {
+    auto tmp = tmpName("./.json");
+    const auto corrupt = tmp + ".corrupt";
+    AtEnd ae{[tmp, corrupt]{ std::remove(tmp.c_str()); std::remove(corrupt.c_str()); }};
+    {
+        dice::Engine e{tmp};
+        e.login(R"({"name": "anon"})");
+        ASSERT_TRUE(e.save());
+    }
+    auto data = dice::slurp(tmp);
+    data[data.find("anon")] = 'A';
+    dice::dump(tmp, data);
+
+    // Not loaded and kept aside for recovery
+    {
+        dice::Engine e{tmp};
+        EXPECT_EQ(0, dice::parse(e.metrics())["players"].GetInt());
+        EXPECT_FALSE(fileExists(tmp));
+        EXPECT_EQ(data, dice::slurp(corrupt));
+    }
+
+    // A file saved before the checksums and truncated by a crash
+    const auto legacy = data.substr(0, data.size() / 2);
+    dice::dump(tmp, legacy);
+    dice::Engine e{tmp};
+    EXPECT_EQ(0, dice::parse(e.metrics())["players"].GetInt());
+    EXPECT_FALSE(fileExists(tmp));
+    EXPECT_EQ(legacy, dice::slurp(corrupt));
+}
+
+TEST(EngineTest, SaveInBackground) {
+    auto tmp = tmpName("./.json");
+    AtEnd ae{[tmp]{ std::remove(tmp.c_str()); }};
+    dice::Engine e{tmp};
+    e.login(R"({"name": "anon"})");
+
+    ASSERT_TRUE(e.saveInBackground());
+    // Changes after the fork are not in the snapshot
+    e.login(R"({"name": "late"})");
+    auto metrics = dice::parse(e.metrics());
+    for (int i = 0; i < 500 && metrics["snapshots"].GetInt() == 0; ++i)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds{10});
+        metrics = dice::parse(e.metrics());
+    }
+    EXPECT_EQ(1, metrics["snapshots"].GetInt());
+    EXPECT_EQ(0, metrics["failedSnapshots"].GetInt());
+    EXPECT_GE(metrics["maxSnapshotPauseUs"].GetInt(), metrics["snapshotPauseUs"].GetInt());
+
+    const auto doc = dice::parse(dice::slurpChecked(tmp));
+    ASSERT_EQ(1, doc["players"].Size());
+    EXPECT_STREQ("anon", doc["players"][0]["name"].GetString());
 }
 
 TEST(EngineTest, JoinGame) {
@@ -266,28 +451,28 @@ TEST(EngineTest, JoinGame) {
     EXPECT_STREQ("PARSE_ERROR", dice::parse(ret)["error"].GetString());
     
     ret = e.joinGame(R"#({
-        "id": "5",
+        "id": "00000000-0000-0000-0000-000000000005",
         "game": "final"
     })#");
     EXPECT_FALSE(dice::parse(ret)["success"].GetBool());
     EXPECT_STREQ("NO_PLAYER", dice::parse(ret)["error"].GetString());
         
     ret = e.joinGame(R"#({
-        "id": "4",
+        "id": "00000000-0000-0000-0000-000000000004",
         "game": "final"
     })#");
     EXPECT_FALSE(dice::parse(ret)["success"].GetBool());
     EXPECT_STREQ("ALREADY_JOINED", dice::parse(ret)["error"].GetString());
 
     ret = e.joinGame(R"#({
-        "id": "3",
+        "id": "00000000-0000-0000-0000-000000000003",
         "game": "quarterfinal"
     })#");
     EXPECT_FALSE(dice::parse(ret)["success"].GetBool());
     EXPECT_STREQ("NO_GAME", dice::parse(ret)["error"].GetString());
     
     ret = e.joinGame(R"#({
-        "id": "3",
+        "id": "00000000-0000-0000-0000-000000000003",
         "game": "semifinal"
     })#");
     EXPECT_TRUE(dice::parse(ret)["success"].GetBool());
@@ -305,12 +490,12 @@ TEST(EngineTest, TestBid) {
 
     EXPECT_EQ(2, dice::parse(e.getGames()).Size());
     
-    auto ret = e.startGame(R"#( {"id": "1"} )#");
+    auto ret = e.startGame(R"#( {"id": "00000000-0000-0000-0000-000000000001"} )#");
     ASSERT_TRUE(dice::parse(ret)["success"].GetBool());
 
     // PARSE_ERROR
     ret = e.bid(R"#({
-        "id": "1",
+        "id": "00000000-0000-0000-0000-000000000001",
         "n": 5
     })#");
     ASSERT_FALSE(parse(ret)["success"].GetBool());
@@ -318,7 +503,7 @@ TEST(EngineTest, TestBid) {
 
     // NO_PLAYER
     ret = e.bid(R"#({
-        "id": "10",
+        "id": "00000000-0000-0000-0000-000000000010",
         "n": 5,
         "face": 5
     })#");
@@ -327,7 +512,7 @@ TEST(EngineTest, TestBid) {
 
     // NO_JOINED
     ret = e.bid(R"#({
-        "id": "3",
+        "id": "00000000-0000-0000-0000-000000000003",
         "n": 5,
         "face": 5
     })#");
@@ -336,17 +521,17 @@ TEST(EngineTest, TestBid) {
 
     // SUCCESS
     ret = e.bid(R"#({
-        "id": "1",
+        "id": "00000000-0000-0000-0000-000000000001",
         "n": 4,
         "face": 5
     })#");
     ASSERT_TRUE(dice::parse(ret)["success"].GetBool());
 
-    ret = e.status(R"#( {"id": "1"} )#");
+    ret = e.status(R"#( {"id": "00000000-0000-0000-0000-000000000001"} )#");
     //cout << "Ret: " << ret << endl;
     auto doc = parse(ret);
     ASSERT_TRUE(doc["success"].GetBool());
-    ASSERT_STREQ("1", doc["id"].GetString());
+    ASSERT_STREQ("00000000-0000-0000-0000-000000000001", doc["id"].GetString());
     ASSERT_STREQ("joe", doc["name"].GetString());
     ASSERT_STREQ("final", doc["game"]["game"].GetString());
     ASSERT_STREQ("ROUND_STARTED", doc["game"]["state"].GetString());
@@ -383,12 +568,12 @@ TEST(EngineTest, TestChallenge) {
     EXPECT_EQ(2, dice::parse(e.getGames()).Size());
     
     // start game and round
-    auto ret = e.startGame(R"#( {"id": "1"} )#");
+    auto ret = e.startGame(R"#( {"id": "00000000-0000-0000-0000-000000000001"} )#");
     ASSERT_TRUE(dice::parse(ret)["success"].GetBool());
 
     // Make a bid
     ret = e.bid(R"#({
-        "id": "1",
+        "id": "00000000-0000-0000-0000-000000000001",
         "n": 5,
         "face": 5
     })#");
@@ -400,20 +585,303 @@ TEST(EngineTest, TestChallenge) {
     ASSERT_STREQ("PARSE_ERROR", parse(ret)["error"].GetString());
 
     // NO_PLAYER
-    ret = e.challenge(R"#( {"id": "10"} )#");
+    ret = e.challenge(R"#( {"id": "00000000-0000-0000-0000-000000000010"} )#");
     ASSERT_FALSE(parse(ret)["success"].GetBool());
     ASSERT_STREQ("NO_PLAYER", parse(ret)["error"].GetString());
 
     // NO_JOINED
-    ret = e.bid(R"#( {"id": "3"} )#");
+    ret = e.bid(R"#( {"id": "00000000-0000-0000-0000-000000000003"} )#");
     ASSERT_FALSE(parse(ret)["success"].GetBool());
     ASSERT_STREQ("NOT_JOINED", parse(ret)["error"].GetString());
 
     // SUCCESS
-    ret = e.challenge(R"#( {"id": "2"} )#");
+    ret = e.challenge(R"#( {"id": "00000000-0000-0000-0000-000000000002"} )#");
     ASSERT_TRUE(dice::parse(ret)["success"].GetBool());
 }
 
+TEST(EngineTest, History) {
+    auto tmp = tmpCopy("../test-game.json", "./.json");
+    dice::Engine e{tmp.str()};
+    const auto joe = R"#({"id": "00000000-0000-0000-0000-000000000001"})#";
+    ASSERT_TRUE(parse(e.startGame(joe))["success"].GetBool());
+    ASSERT_TRUE(parse(e.bid(R"#({"id": "00000000-0000-0000-0000-000000000001", "n": 2, "face": 4})#"))["success"].GetBool());
+
+    // Loaded from the file, so only the moves since loading
+    auto doc = parse(e.history(joe));
+    ASSERT_TRUE(doc["success"].GetBool());
+    const auto& history = doc["history"];
+    ASSERT_STREQ("final", history["game"].GetString());
+    ASSERT_FALSE(history["complete"].GetBool());
+    const auto next = history["next"].GetInt();
+    const auto& last = history["moves"][history["moves"].Size() - 1];
+    ASSERT_STREQ("bid", last["move"].GetString());
+    ASSERT_STREQ("joe", last["player"].GetString());
+    ASSERT_EQ(next - 1, last["seq"].GetInt());
+
+    doc = parse(e.history(json::Json({{"id", "00000000-0000-0000-0000-000000000002"}, {"since", next - 1}}).str()));
+    ASSERT_EQ(1, doc["history"]["moves"].Size());
+    ASSERT_EQ(doc, parse(msgpack::toJson(e.history(msgpack::fromJson(
+        json::Json({{"id", "00000000-0000-0000-0000-000000000002"}, {"since", next - 1}}).str()), Format::MSGPACK))));
+
+    ASSERT_STREQ("NOT_JOINED", parse(e.history(R"#({"id": "00000000-0000-0000-0000-000000000003"})#"))["error"].GetString());
+    ASSERT_STREQ("NO_PLAYER", parse(e.history(R"#({"id": "00000000-0000-0000-0000-000000000010"})#"))["error"].GetString());
+
+    // The log is saved with the game
+    const auto before = parse(e.history(joe));
+    ASSERT_TRUE(e.save());
+    dice::Engine loaded{tmp.str()};
+    ASSERT_EQ(before, parse(loaded.history(joe)));
+}
+
+TEST(EngineTest, SeedGames) {
+    std::vector<int> hands[2];
+    for (auto& hand : hands)
+    {
+        dice::Engine e{""};
+        e.seedGames(7);
+        const std::string joe = parse(e.login(R"#({"name": "joe"})#"))["id"].GetString();
+        const std::string ann = parse(e.login(R"#({"name": "ann"})#"))["id"].GetString();
+        e.createGame(json::Json({{"id", joe}, {"game", "g"}}));
+        e.joinGame(json::Json({{"id", ann}, {"game", "g"}}));
+        ASSERT_TRUE(parse(e.startGame(json::Json({"id", ann})))["success"].GetBool());
+        const auto doc = parse(e.status(json::Json({"id", joe})));
+        for (const auto& d : doc["game"]["players"][0]["hand"].GetArray())
+        {
+            hand.push_back(d.GetInt());
+        }
+    }
+    ASSERT_EQ(5, hands[0].size());
+    ASSERT_EQ(hands[0], hands[1]);
+}
+
+TEST(EngineTest, Expire) {
+    auto tmp = tmpCopy("../test-game.json", "./.json");
+    dice::Engine e{tmp.str()};
+    e.setTimeouts(std::chrono::seconds{60}, std::chrono::seconds{10});
+    const auto t0 = std::chrono::steady_clock::now();
+
+    e.expire(t0 + std::chrono::seconds{30});
+    ASSERT_TRUE(parse(e.status(R"#( {"id": "00000000-0000-0000-0000-000000000001"} )#"))["success"].GetBool());
+
+    // Everyone but joe has been idle for too long. Mary is logged out of
+    // final and semifinal is left empty.
+    e.expire(t0 + std::chrono::seconds{70});
+    auto doc = parse(e.metrics());
+    EXPECT_EQ(1, doc["players"].GetInt());
+    EXPECT_EQ(3, doc["expiredPlayers"].GetInt());
+    EXPECT_EQ(0, doc["expiredGames"].GetInt());
+    EXPECT_STREQ("NO_PLAYER", parse(e.status(R"#( {"id": "00000000-0000-0000-0000-000000000002"} )#"))["error"].GetString());
+
+    e.expire(t0 + std::chrono::seconds{85});
+    doc = parse(e.getGames());
+    ASSERT_EQ(1, doc.Size());
+    EXPECT_STREQ("final", doc[0]["game"].GetString());
+    EXPECT_EQ(1, doc[0]["players"].Size());
+    EXPECT_EQ(1, parse(e.metrics())["expiredGames"].GetInt());
+
+    e.expire(t0 + std::chrono::seconds{200});
+    doc = parse(e.metrics());
+    EXPECT_EQ(0, doc["players"].GetInt());
+    EXPECT_EQ(4, doc["expiredPlayers"].GetInt());
+
+    e.expire(t0 + std::chrono::seconds{300});
+    doc = parse(e.metrics());
+    EXPECT_EQ(0, doc["games"].GetInt());
+    EXPECT_EQ(2, doc["expiredGames"].GetInt());
+}
+
+TEST(EngineTest, Bots) {
+    dice::Engine e{""};
+    dice::BotConfig config;
+    config.delay = std::chrono::milliseconds{0};
+    e.setBotConfig(config);
+    const std::string joe = parse(e.login(R"#({"name": "joe"})#"))["id"].GetString();
+    EXPECT_STREQ("NOT_JOINED", parse(e.addBot(json::Json({"id", joe})))["error"].GetString());
+    e.createGame(json::Json({{"id", joe}, {"game", "g"}}));
+    EXPECT_STREQ("bot-1", parse(e.addBot(json::Json({"id", joe})))["name"].GetString());
+    EXPECT_STREQ("bot-2", parse(e.addBot(json::Json({"id", joe})))["name"].GetString());
+    EXPECT_EQ(2, parse(e.metrics())["bots"].GetInt());
+
+    // The bots move until it is joe's turn or one of them challenges
+    auto waitForJoe = [&]()
+    {
+        for (int i = 0; i < 1000; ++i)
+        {
+            const auto doc = parse(e.status(json::Json({"id", joe})));
+            if (doc["game"]["turn"].GetInt() == 0 ||
+                std::string{doc["game"]["state"].GetString()} != "ROUND_STARTED") return;
+            std::this_thread::sleep_for(std::chrono::milliseconds{1});
+        }
+        FAIL() << "bots did not move";
+    };
+    ASSERT_TRUE(parse(e.startGame(json::Json({"id", joe})))["success"].GetBool());
+    waitForJoe();
+    auto doc = parse(e.status(json::Json({"id", joe})));
+    if (std::string{doc["game"]["state"].GetString()} == "ROUND_STARTED")
+    {
+        ASSERT_TRUE(parse(e.bid(json::Json({{"id", joe}, {"n", 1}, {"face", 2}})))["success"].GetBool());
+        waitForJoe();
+    }
+    doc = parse(e.metrics());
+    EXPECT_LE(1, doc["botMoves"].GetInt());
+    EXPECT_EQ(0, doc["lateBotMoves"].GetInt());
+
+    // The bots leave with the last player
+    ASSERT_TRUE(parse(e.logout(json::Json({"id", joe})))["success"].GetBool());
+    doc = parse(e.metrics());
+    EXPECT_EQ(0, doc["bots"].GetInt());
+    EXPECT_EQ(1, doc["players"].GetInt());
+    EXPECT_EQ(1, doc["games"].GetInt());
+}
+
+TEST(EngineTest, BotsDoNotBlockRequests) {
+    // The bots search their moves with the engine unlocked, so the
+    // requests are served well before the budget of the search
+    dice::Engine e{""};
+    dice::BotConfig config;
+    config.delay = std::chrono::milliseconds{0};
+    config.budget = std::chrono::seconds{2};
+    e.setBotConfig(config);
+    const std::string joe = parse(e.login(R"#({"name": "joe"})#"))["id"].GetString();
+    e.createGame(json::Json({{"id", joe}, {"game", "g"}}));
+    for (int i = 0; i < 3; ++i) e.addBot(json::Json({"id", joe}));
+    ASSERT_TRUE(parse(e.startGame(json::Json({"id", joe})))["success"].GetBool());
+    ASSERT_TRUE(parse(e.bid(json::Json({{"id", joe}, {"n", 1}, {"face", 2}})))["success"].GetBool());
+
+    const auto end = std::chrono::steady_clock::now() + std::chrono::seconds{5};
+    while (std::chrono::steady_clock::now() < end)
+    {
+        const auto t0 = std::chrono::steady_clock::now();
+        const auto doc = parse(e.status(json::Json({"id", joe})));
+        EXPECT_LT(std::chrono::steady_clock::now() - t0, std::chrono::milliseconds{200});
+        if (doc["game"]["turn"].GetInt() == 0 ||
+            std::string{doc["game"]["state"].GetString()} != "ROUND_STARTED") break;
+        std::this_thread::sleep_for(std::chrono::milliseconds{1});
+    }
+}
+
+TEST(EngineTest, BotsResumeAfterLoad) {
+    // Saved with the turn at the bot
+    rapidjson::StringBuffer s;
+    json::Writer w{s};
+    const std::string joe = "00000000-0000-0000-0000-000000000001";
+    Game g{"g", "joe", 3};
+    g.addPlayer("bot-1");
+    ASSERT_TRUE(g.startGame());
+    ASSERT_TRUE(g.startRound());
+    if (g.turn() == 0)
+    {
+        ASSERT_TRUE(g.bid("joe", 1, 2));
+    }
+    ASSERT_EQ(1, g.turn());
+    json::Object(w, [&](auto& w)
+    {
+        json::ArrayW(w, "players", [&](auto& w)
+        {
+            json::Object(w, [&](auto& w)
+            {
+                json::KeyValue(w, "id", joe);
+                json::KeyValue(w, "name", "joe");
+            });
+            json::Object(w, [&](auto& w)
+            {
+                json::KeyValue(w, "id", "00000000-0000-0000-0000-000000000002");
+                json::KeyValue(w, "name", "bot-1");
+                json::KeyValue(w, "bot", true);
+            });
+        });
+        json::ArrayW(w, "games", [&](auto& w) { g.serializeState(w); });
+    });
+    auto tmp = tmpName("./.json");
+    AtEnd ae{[tmp]{ std::remove(tmp.c_str()); }};
+    dice::dump(tmp, s.GetString());
+
+    dice::Engine e{tmp};
+    for (int i = 0; i < 5000 && parse(e.metrics())["botMoves"].GetInt() == 0; ++i)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds{1});
+    }
+    EXPECT_EQ(1, parse(e.metrics())["botMoves"].GetInt());
+}
+
+TEST(EngineTest, Batch) {
+    auto tmp = tmpCopy("../test-game.json", "./.json");
+    dice::Engine e{tmp.str()};
+    ASSERT_TRUE(parse(e.startGame(R"#({"id": "00000000-0000-0000-0000-000000000001"})#"))["success"].GetBool());
+
+    auto doc = parse(e.batch(R"#({"id": "00000000-0000-0000-0000-000000000001", "ops": [
+        {"op": "bid", "n": 1, "face": 2},
+        {"op": "status"},
+        {"op": "challenge"},
+        {"op": "fly"},
+        {"n": 1}
+    ]})#"));
+    ASSERT_TRUE(doc["success"].GetBool());
+    const auto& results = doc["results"];
+    ASSERT_EQ(5, results.Size());
+    EXPECT_TRUE(results[0]["success"].GetBool());
+    EXPECT_STREQ("joe", results[1]["name"].GetString());
+    EXPECT_EQ(2, results[1]["game"]["bid"]["face"].GetInt());
+    EXPECT_STREQ("NOT_YOUR_TURN", results[2]["error"].GetString());
+    EXPECT_STREQ("UNKNOWN_OP", results[3]["error"].GetString());
+    EXPECT_STREQ("PARSE_ERROR", results[4]["error"].GetString());
+
+    doc = parse(e.batch(R"#({"id": "00000000-0000-0000-0000-000000000002", "ops": [
+        {"op": "challenge"},
+        {"op": "startRound"},
+        {"op": "status", "hash": 0}
+    ]})#"));
+    ASSERT_EQ(3, doc["results"].Size());
+    for (const auto& r : doc["results"].GetArray()) EXPECT_TRUE(r["success"].GetBool());
+    EXPECT_STREQ("ROUND_STARTED", doc["results"][2]["game"]["state"].GetString());
+
+    doc = parse(e.batch(R"#({"id": "00000000-0000-0000-0000-000000000010", "ops": [{"op": "status"}]})#"));
+    EXPECT_STREQ("NO_PLAYER", doc["results"][0]["error"].GetString());
+    doc = parse(e.batch(R"#({"id": "00000000-0000-0000-0000-000000000001"})#"));
+    EXPECT_STREQ("PARSE_ERROR", doc["error"].GetString());
+
+    // MessagePack
+    const auto packed = e.batch(msgpack::fromJson(R"#({"id": "00000000-0000-0000-0000-000000000001", "ops": [{"op": "status"}]})#"),
+                                dice::Format::MSGPACK);
+    doc = parse(msgpack::toJson(packed));
+    EXPECT_STREQ("joe", doc["results"][0]["name"].GetString());
+}
+
+TEST(EngineTest, MsgPack) {
+    auto tmp = tmpCopy("../test-game.json", "./.json");
+    dice::Engine e{tmp.str()};
+    const auto mp = dice::Format::MSGPACK;
+
+    auto ret = e.startGame(msgpack::fromJson(R"#({"id": "00000000-0000-0000-0000-000000000001"})#"), mp);
+    ASSERT_TRUE(parse(msgpack::toJson(ret))["success"].GetBool());
+
+    // Same status in both formats
+    const auto status = e.status(R"#({"id": "00000000-0000-0000-0000-000000000001"})#");
+    const auto packed = e.status(msgpack::fromJson(R"#({"id": "00000000-0000-0000-0000-000000000001"})#"), mp);
+    ASSERT_LT(packed.size(), status.size() / 2);
+    ASSERT_EQ(parse(status), parse(msgpack::toJson(packed)));
+
+    // Errors are MessagePack as well
+    ret = e.bid(R"#({"id": "00000000-0000-0000-0000-000000000001", "n": 1, "face": 2})#", mp);
+    ASSERT_STREQ("PARSE_ERROR", parse(msgpack::toJson(ret))["error"].GetString());
+    ret = e.bid(msgpack::fromJson(R"#({"id": "00000000-0000-0000-0000-000000000002", "n": 1, "face": 2})#"), mp);
+    ASSERT_STREQ("NOT_YOUR_TURN", parse(msgpack::toJson(ret))["error"].GetString());
+
+    // Benchmark status
+    constexpr int N = 10000;
+    const auto body = msgpack::fromJson(R"#({"id": "00000000-0000-0000-0000-000000000001"})#");
+    std::size_t bytes = 0;
+    auto t0 = std::chrono::steady_clock::now();
+    for (int i = 0; i < N; ++i) bytes += e.status(R"#({"id": "00000000-0000-0000-0000-000000000001"})#").size();
+    std::chrono::duration<double> jsonTime = std::chrono::steady_clock::now() - t0;
+    t0 = std::chrono::steady_clock::now();
+    for (int i = 0; i < N; ++i) bytes += e.status(body, mp).size();
+    std::chrono::duration<double> packTime = std::chrono::steady_clock::now() - t0;
+    cout << "status: json " << status.size() << " bytes " << jsonTime.count() / N * 1e6 << " us, "
+         << "MessagePack " << packed.size() << " bytes " << packTime.count() / N * 1e6 << " us "
+         << "(" << bytes << ")" << endl;
+}
+
 TEST(EngineGame, TestConstruct) {
     MockDice d;
     Dice::setInstance(&d);
@@ -592,7 +1060,7 @@ TEST(EngineGame, Save) {
 
     rapidjson::StringBuffer s;
     rapidjson::PrettyWriter<rapidjson::StringBuffer> w{s};
-    game->serialize(w, "");
+    game->serializeState(w);
     //cout << s.GetString() << endl;
     ASSERT_STREQ(txt0.c_str(), s.GetString());
 }
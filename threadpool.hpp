@@ -0,0 +1,222 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace dice {
+
+/// Thread pool with a task queue per worker. A worker pushes the tasks it
+/// submits to the back of its own queue and runs them LIFO, so a task that
+/// splits its work keeps the data hot. Idle workers steal the oldest tasks
+/// from the front of the other queues. Tasks submitted from other threads
+/// are spread round robin.
+///
+/// Tasks must not throw.
+class ThreadPool
+{
+public:
+    using Task = std::function<void()>;
+
+    /// Construct ThreadPool
+    /// @param threads [in] number of workers, 0 = one per core
+    explicit ThreadPool(unsigned threads = 0)
+      : queues_{},
+        threads_{},
+        stop_{false},
+        next_{0},
+        queued_{0},
+        mutex_{},
+        cv_{}
+    {
+        if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+        for (unsigned i = 0; i < threads; ++i) queues_.push_back(std::make_unique<Queue>());
+        for (unsigned i = 0; i < threads; ++i) threads_.emplace_back([this, i] { work(i); });
+    }
+
+    /// Run the queued tasks and stop the workers
+    ~ThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock{mutex_};
+            stop_ = true;
+        }
+        cv_.notify_all();
+        for (auto& t : threads_) t.join();
+    }
+
+    ThreadPool(ThreadPool&&) = delete;
+
+    /// @return number of workers
+    std::size_t size() const { return threads_.size(); }
+
+    /// Queue a task. Thread-safe.
+    /// @param task [in] task to run on one of the workers
+    void submit(Task task)
+    {
+        const auto self = worker();
+        const auto i = self < queues_.size() ? self : next_++ % queues_.size();
+        {
+            std::lock_guard<std::mutex> lock{queues_[i]->mutex};
+            queues_[i]->tasks.push_back(std::move(task));
+        }
+        ++queued_;
+        std::lock_guard<std::mutex> lock{mutex_};
+        cv_.notify_one();
+    }
+
+    /// Run one queued task on the calling thread, if there is any. Lets a
+    /// thread waiting for its tasks help instead of blocking.
+    /// @return whether a task was run
+    bool tryRun()
+    {
+        Task task;
+        if (!pop(worker(), task)) return false;
+        task();
+        return true;
+    }
+
+private:
+    struct Queue
+    {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    std::vector<std::unique_ptr<Queue>> queues_;
+    std::vector<std::thread> threads_;
+    bool stop_;
+    std::atomic<std::size_t> next_;
+    // Tasks in all the queues
+    std::atomic<std::size_t> queued_;
+    // For sleeping when there is nothing to do
+    std::mutex mutex_;
+    std::condition_variable cv_;
+
+    // Index of the calling worker of this pool or size() for other threads
+    std::size_t worker() const
+    {
+        const auto& w = current();
+        return w.first == this ? w.second : queues_.size();
+    }
+
+    static std::pair<const ThreadPool*, std::size_t>& current()
+    {
+        static thread_local std::pair<const ThreadPool*, std::size_t> w{nullptr, 0};
+        return w;
+    }
+
+    // Take the newest task of own queue or steal the oldest of another
+    bool pop(std::size_t self, Task& task)
+    {
+        if (queued_ == 0) return false;
+        const auto n = queues_.size();
+        if (self < n)
+        {
+            auto& q = *queues_[self];
+            std::lock_guard<std::mutex> lock{q.mutex};
+            if (!q.tasks.empty())
+            {
+                task = std::move(q.tasks.back());
+                q.tasks.pop_back();
+                --queued_;
+                return true;
+            }
+        }
+        const auto start = self < n ? self + 1 : next_.load();
+        for (std::size_t k = 0; k < n; ++k)
+        {
+            auto& q = *queues_[(start + k) % n];
+            std::lock_guard<std::mutex> lock{q.mutex};
+            if (!q.tasks.empty())
+            {
+                task = std::move(q.tasks.front());
+                q.tasks.pop_front();
+                --queued_;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void work(std::size_t self)
+    {
+        current() = std::make_pair(this, self);
+        for (;;)
+        {
+            Task task;
+            if (pop(self, task))
+            {
+                task();
+                continue;
+            }
+            std::unique_lock<std::mutex> lock{mutex_};
+            cv_.wait(lock, [this] { return stop_ || queued_ > 0; });
+            if (stop_ && queued_ == 0) return;
+        }
+    }
+};
+
+/// Tasks run on a ThreadPool that can be waited for together
+class TaskGroup
+{
+public:
+    /// Construct TaskGroup
+    /// @param pool [in] where to run the tasks
+    explicit TaskGroup(ThreadPool& pool)
+      : pool_{pool},
+        pending_{0},
+        mutex_{},
+        cv_{}
+    {
+    }
+
+    /// Waits for the tasks
+    ~TaskGroup() { wait(); }
+
+    TaskGroup(TaskGroup&&) = delete;
+
+    /// Run the task on the pool. May be called from the tasks of the group.
+    /// @param task [in] task to run
+    void run(ThreadPool::Task task)
+    {
+        ++pending_;
+        pool_.submit([this, t = std::move(task)]
+        {
+            t();
+            std::lock_guard<std::mutex> lock{mutex_};
+            if (--pending_ == 0) cv_.notify_all();
+        });
+    }
+
+    /// Wait until all the tasks of the group have run. The calling thread
+    /// runs queued tasks in the meanwhile.
+    void wait()
+    {
+        while (pending_ > 0)
+        {
+            if (pool_.tryRun()) continue;
+            std::unique_lock<std::mutex> lock{mutex_};
+            cv_.wait_for(lock, std::chrono::microseconds{100}, [this] { return pending_ == 0; });
+        }
+        // The last task may still be notifying
+        std::lock_guard<std::mutex> lock{mutex_};
+    }
+
+private:
+    ThreadPool& pool_;
+    std::atomic<std::size_t> pending_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+};
+
+} // namespace dice
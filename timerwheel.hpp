@@ -0,0 +1,134 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace dice {
+
+/// Hierarchical timer wheel. Time is measured in ticks. Scheduling is O(1)
+/// and every timer is moved between the levels at most LEVELS - 1 times
+/// before it fires, so expiry is O(1) amortized.
+///
+/// Timers can't be cancelled. Instead, the owner checks on expiry whether
+/// the timer is still relevant and schedules it again if needed.
+///
+/// @tparam Key type identifying the timer
+template<typename Key>
+class TimerWheel
+{
+    static constexpr unsigned BITS = 6;
+    static constexpr std::size_t SLOTS = 1u << BITS;
+    static constexpr std::uint64_t MASK = SLOTS - 1;
+    static constexpr unsigned LEVELS = 4;
+    /// Furthest expiry that fits in the wheel without clamping
+    static constexpr std::uint64_t SPAN = std::uint64_t{1} << (BITS * LEVELS);
+
+    struct Timer
+    {
+        Key key;
+        std::uint64_t expires;
+    };
+    using Slot = std::vector<Timer>;
+
+    std::array<std::array<Slot, SLOTS>, LEVELS> wheel_;
+    // Number of timers per level
+    std::array<std::size_t, LEVELS> counts_;
+    std::uint64_t now_;
+    std::size_t size_;
+
+    // Place the timer into the wheel, no earlier than the given tick
+    void place(Timer&& timer, std::uint64_t earliest)
+    {
+        const auto expires = std::max(timer.expires, earliest);
+        const auto delta = expires - now_;
+        unsigned level = 0;
+        while (level < LEVELS - 1 && delta >= (std::uint64_t{1} << (BITS * (level + 1)))) ++level;
+        // Too far in the future: park it at the top level, it will be
+        // placed again when the slot is cascaded
+        const auto at = delta < SPAN ? expires : now_ + SPAN - 1;
+        wheel_[level][(at >> (BITS * level)) & MASK].push_back(std::move(timer));
+        ++counts_[level];
+    }
+
+    void cascade(unsigned level)
+    {
+        Slot timers;
+        timers.swap(wheel_[level][(now_ >> (BITS * level)) & MASK]);
+        counts_[level] -= timers.size();
+        // The current tick's level 0 slot hasn't been processed yet
+        for (auto& t : timers) place(std::move(t), now_);
+    }
+
+public:
+    /// Construct TimerWheel
+    /// @param now [in] current tick
+    explicit TimerWheel(std::uint64_t now = 0)
+      : wheel_{},
+        counts_{},
+        now_{now},
+        size_{}
+    {
+    }
+
+    /// @return current tick
+    auto now() const { return now_; }
+
+    /// @return number of pending timers
+    auto size() const { return size_; }
+
+    /// Schedule a timer
+    /// @param key [in] identifies the timer when it fires
+    /// @param expires [in] tick when the timer fires
+    void schedule(Key key, std::uint64_t expires)
+    {
+        // Expired timers fire on the next tick
+        place(Timer{std::move(key), expires}, now_ + 1);
+        ++size_;
+    }
+
+    /// Move time forward and fire the timers that expire
+    /// @tparam F callable taking Key
+    /// @param now [in] new current tick
+    /// @param onExpire [in] called for every timer that fires. It may
+    ///     schedule new timers.
+    template<typename F>
+    void advance(std::uint64_t now, F&& onExpire)
+    {
+        while (now_ < now)
+        {
+            if (size_ == 0)
+            {
+                now_ = now;
+                return;
+            }
+            // Nothing happens before the next cascade of the lowest
+            // level that has timers
+            unsigned lowest = 0;
+            while (counts_[lowest] == 0) ++lowest;
+            if (lowest > 0)
+            {
+                const auto boundary = ((now_ >> (BITS * lowest)) + 1) << (BITS * lowest);
+                now_ = std::min(now, boundary - 1);
+                if (now_ == now) return;
+            }
+            ++now_;
+            // Higher levels first so that timers cascading down through
+            // several levels reach level 0 on this tick
+            for (unsigned level = LEVELS - 1; level > 0; --level)
+            {
+                if ((now_ & ((std::uint64_t{1} << (BITS * level)) - 1)) == 0) cascade(level);
+            }
+            Slot expired;
+            expired.swap(wheel_[0][now_ & MASK]);
+            counts_[0] -= expired.size();
+            size_ -= expired.size();
+            for (auto& t : expired) onExpire(t.key);
+        }
+    }
+};
+
+} // namespace dice
@@ -1,18 +1,39 @@
 #pragma once
 
+#include <cstdint>
+#include <cstring>
 #include <experimental/string_view>
 #include <memory>
 #include <string>
 #include <vector>
 #include <iostream>
 
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
 namespace dice {
 
-/// Efficient tokenizer for getting tokens from a string. Doesn't have the
-/// option of getting empty tokens so this class is not usable for splitting csv
-/// files where there can be empty tokens.
+/// Efficient tokenizer for getting tokens from a string. The delimiters are
+/// turned into a 256-bit lookup table once and, when SSE2 is available and
+/// there are only a few delimiters, the string is scanned 16 bytes at a time.
+/// By default empty tokens are skipped. Use KEEP_EMPTY mode for splitting e.g.
+/// csv lines where there can be empty tokens.
 class Tokenizer
 {
+public:
+    /// What to do with the empty tokens between adjacent delimiters
+    enum Mode
+    {
+        /// Adjacent delimiters are treated as one, the default
+        SKIP_EMPTY,
+        /// Every delimiter ends a token, "a,,b" is "a", "", "b"
+        KEEP_EMPTY
+    };
+private:
+    /// Delimiters compared with SIMD. More delimiters use the lookup table.
+    static constexpr std::size_t SIMD_DELIMS = 4;
+
     struct Impl
     {
         template<typename StrType, typename DelimType>
@@ -28,6 +49,9 @@ class Tokenizer
     const std::experimental::string_view str_;
     const std::experimental::string_view delim_;
     std::size_t pos_;
+    const Mode mode_;
+    // Bit per byte value, set for the delimiters
+    std::uint64_t table_[4];
 
     auto movePos(std::size_t len)
     {
@@ -35,18 +59,87 @@ class Tokenizer
         pos_ += len + 1;
         return prev;
     }
+
+    void init()
+    {
+        std::memset(table_, 0, sizeof(table_));
+        for (const auto c : delim_)
+        {
+            const auto b = static_cast<unsigned char>(c);
+            table_[b >> 6] |= std::uint64_t{1} << (b & 63);
+        }
+    }
+
+    bool isDelim(char c) const
+    {
+        const auto b = static_cast<unsigned char>(c);
+        return ((table_[b >> 6] >> (b & 63)) & 1) != 0;
+    }
+
+    /// @param pos [in] where to start
+    /// @param delim [in] whether to find a delimiter or a non-delimiter
+    /// @return position of the first (non-)delimiter at or after pos or
+    ///     the size of the string if there is none
+    std::size_t find(std::size_t pos, bool delim) const
+    {
+        const auto size = str_.size();
+        const auto data = str_.data();
+#ifdef __SSE2__
+        if (delim_.size() <= SIMD_DELIMS)
+        {
+            __m128i d[SIMD_DELIMS];
+            for (std::size_t i = 0; i < delim_.size(); ++i) d[i] = _mm_set1_epi8(delim_[i]);
+            const unsigned flip = delim ? 0 : 0xffff;
+            for (; size >= 16 && pos <= size - 16; pos += 16)
+            {
+                __m128i chunk;
+                std::memcpy(&chunk, data + pos, sizeof(chunk));
+                __m128i eq = _mm_setzero_si128();
+                for (std::size_t i = 0; i < delim_.size(); ++i)
+                {
+                    eq = _mm_or_si128(eq, _mm_cmpeq_epi8(chunk, d[i]));
+                }
+                const auto mask = static_cast<unsigned>(_mm_movemask_epi8(eq)) ^ flip;
+                if (mask) return pos + static_cast<std::size_t>(__builtin_ctz(mask));
+            }
+        }
+#endif
+        for (; pos < size; ++pos)
+        {
+            if (isDelim(data[pos]) == delim) return pos;
+        }
+        return size;
+    }
 public:
     /// Construct Tokenizer. Tokenizer will store pointers to str and delim.
     /// This version of constructor is cheaper than the one that takes
     /// std::strings.
     /// @param str [in] string to tokenize
     /// @param delim [in] delimiter by which to tokenize
-    Tokenizer(const char* str, const char* delim)
+    /// @param mode [in] whether to skip empty tokens
+    Tokenizer(const char* str, const char* delim, Mode mode = SKIP_EMPTY)
+    : impl_{},
+      str_{str},
+      delim_{delim},
+      pos_{},
+      mode_{mode}
+    {
+        init();
+    }
+
+    /// Construct Tokenizer for a part of a string. Tokenizer will store
+    /// pointers to str and delim.
+    /// @param str [in] string to tokenize, does not need to be null terminated
+    /// @param delim [in] delimiter by which to tokenize
+    /// @param mode [in] whether to skip empty tokens
+    Tokenizer(std::experimental::string_view str, const char* delim, Mode mode = SKIP_EMPTY)
     : impl_{},
       str_{str},
       delim_{delim},
-      pos_{}
+      pos_{},
+      mode_{mode}
     {
+        init();
     }
 
     /// Construct Tokenizer. Tokenizer will make copy of str and delim. If you
@@ -55,13 +148,16 @@ public:
     /// @tparam DelimType [in] type of the delimer
     /// @param str [in] string to tokenize
     /// @param delim [in] delimiter by which to tokenize
+    /// @param mode [in] whether to skip empty tokens
     template<typename StrType, typename DelimType>
-    Tokenizer(StrType&& str, DelimType&& delim)
+    Tokenizer(StrType&& str, DelimType&& delim, Mode mode = SKIP_EMPTY)
     : impl_{std::make_unique<Impl>(std::forward<StrType>(str), std::forward<DelimType>(delim))},
       str_{impl_->str_.data()},
       delim_{impl_->delim_.data()},
-      pos_{}
+      pos_{},
+      mode_{mode}
     {
+        init();
     }
 
     /// Construct Tokenizer where the strings are owned by Tokenizer. Needs
@@ -83,20 +179,31 @@ public:
 
     /// Get the next token's starting position and length of the token.
     /// @see also getNextString and getNextStringView.
-    /// @return pair (pos, len) or {0, 0} if no tokens
+    /// @return pair (pos, len) or {0, 0} if no tokens. In KEEP_EMPTY mode an
+    ///     empty token is also {pos, 0}; use done to tell them apart.
     std::pair<std::size_t, std::size_t> next()
     {
-        if (pos_ == std::string::npos) return {0, 0};
-        // Skip delimiters
-        pos_ = str_.find_first_not_of(delim_, pos_);
-        if (pos_ == std::string::npos) return {0, 0};
-        // Find next delimiters
-        auto endPos = str_.find_first_of(delim_, pos_ + 1);
-        const std::size_t len = (endPos == std::string::npos) ?
-            str_.size() - pos_ : endPos - pos_;
+        if (pos_ > str_.size()) return {0, 0};
+        if (mode_ == SKIP_EMPTY)
+        {
+            pos_ = find(pos_, false);
+            if (pos_ == str_.size())
+            {
+                pos_ = std::string::npos;
+                return {0, 0};
+            }
+        }
+        const auto len = find(pos_, true) - pos_;
         return std::make_pair(movePos(len), len);
     }
 
+    /// @return whether all the tokens have been returned. In SKIP_EMPTY mode
+    ///     trailing delimiters may leave this false until next returns {0, 0}.
+    bool done() const
+    {
+        return pos_ > str_.size();
+    }
+
     /// @return next token or empty if no more tokens
     auto nextStringView()
     {
@@ -115,10 +222,10 @@ public:
     auto tokens()
     {
         std::vector<std::string> t;
-        for (;;)
+        while (!done())
         {
             const auto str = nextString();
-            if (str.empty()) break;
+            if (str.empty() && mode_ == SKIP_EMPTY) break;
             t.push_back(std::move(str));
             //t.push_back(str);
         }
@@ -129,10 +236,10 @@ public:
     auto tokenViews()
     {
         std::vector<std::experimental::string_view> t;
-        for (;;)
+        while (!done())
         {
             const auto str = nextStringView();
-            if (str.empty()) break;
+            if (str.empty() && mode_ == SKIP_EMPTY) break;
             t.push_back(std::move(str));
         }
         return t;
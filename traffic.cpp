@@ -0,0 +1,133 @@
+#include "traffic.hpp"
+
+#include "engine.hpp"
+#include "helpers.hpp"
+#include "json.hpp"
+#include "msgpack.hpp"
+
+#include <rapidjson/document.h>
+#include <rapidjson/stringbuffer.h>
+#include <rapidjson/writer.h>
+
+#include <functional>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace dice {
+
+namespace {
+
+const char* formatName(Format format)
+{
+    return format == Format::MSGPACK ? "msgpack" : "json";
+}
+
+} // unnamed namespace
+
+Recorder::Recorder(const std::string& path)
+  : mutex_{},
+    out_{path, std::ios::app | std::ios::binary},
+    start_{std::chrono::steady_clock::now()}
+{
+    if (!out_) throw std::runtime_error("Cannot open " + path);
+}
+
+std::int64_t Recorder::now() const
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start_).count();
+}
+
+void Recorder::record(std::int64_t t, const std::string& route, const std::string& body,
+                      Format format, const std::string& response)
+{
+    // Binary bodies are not valid json strings
+    const auto jsonBody = format == Format::MSGPACK ? msgpack::toJson(body) : body;
+    std::string player;
+    if (route == "/api/login")
+    {
+        try {
+            const auto doc = parse(format == Format::MSGPACK ? msgpack::toJson(response) : response);
+            player = json::getString(doc, "id");
+        }
+        catch (const json::ParseError&) {}
+    }
+
+    rapidjson::StringBuffer s;
+    rapidjson::Writer<rapidjson::StringBuffer> w{s};
+    w.StartObject();
+    w.Key("t");
+    w.Int64(t);
+    w.Key("route");
+    w.String(route.c_str(), static_cast<rapidjson::SizeType>(route.size()));
+    w.Key("format");
+    w.String(formatName(format));
+    w.Key("body");
+    w.String(jsonBody.c_str(), static_cast<rapidjson::SizeType>(jsonBody.size()));
+    if (!player.empty())
+    {
+        w.Key("player");
+        w.String(player.c_str(), static_cast<rapidjson::SizeType>(player.size()));
+    }
+    w.EndObject();
+
+    std::lock_guard<std::mutex> lock{mutex_};
+    out_ << s.GetString() << '\n';
+    out_.flush();
+}
+
+std::vector<Record> readTraffic(const std::string& path)
+{
+    std::vector<Record> records;
+    std::ifstream in{path, std::ios::binary};
+    std::string line;
+    while (std::getline(in, line))
+    {
+        rapidjson::Document doc;
+        doc.Parse(line.c_str());
+        try {
+            const auto& t = json::getValue(doc, "t");
+            if (!t.IsInt64()) continue;
+            Record r;
+            r.t = t.GetInt64();
+            r.route = json::getString(doc, "route");
+            r.body = json::getString(doc, "body");
+            r.format = std::string{json::getString(doc, "format")} == "msgpack" ?
+                Format::MSGPACK : Format::JSON;
+            if (doc.HasMember("player") && doc["player"].IsString()) r.player = doc["player"].GetString();
+            records.push_back(std::move(r));
+        }
+        catch (const json::ParseError&) {}
+    }
+    return records;
+}
+
+std::string dispatch(Engine& engine, const std::string& route, const std::string& body, Format format)
+{
+    using Method = std::function<std::string(Engine&, const std::string&, Format)>;
+    static const std::unordered_map<std::string, Method> routes{
+        {"/api/login", [](Engine& e, const std::string& b, Format f) { return e.login(b, f); }},
+        {"/api/status", [](Engine& e, const std::string& b, Format f) { return e.status(b, f); }},
+        {"/api/history", [](Engine& e, const std::string& b, Format f) { return e.history(b, f); }},
+        {"/api/newGame", [](Engine& e, const std::string& b, Format f) { return e.createGame(b, f); }},
+        {"/api/join", [](Engine& e, const std::string& b, Format f) { return e.joinGame(b, f); }},
+        {"/api/startGame", [](Engine& e, const std::string& b, Format f) { return e.startGame(b, f); }},
+        {"/api/startRound", [](Engine& e, const std::string& b, Format f) { return e.startRound(b, f); }},
+        {"/api/bid", [](Engine& e, const std::string& b, Format f) { return e.bid(b, f); }},
+        {"/api/challenge", [](Engine& e, const std::string& b, Format f) { return e.challenge(b, f); }},
+        {"/api/addBot", [](Engine& e, const std::string& b, Format f) { return e.addBot(b, f); }},
+        {"/api/batch", [](Engine& e, const std::string& b, Format f) { return e.batch(b, f); }},
+        {"/api/logout", [](Engine& e, const std::string& b, Format f) { return e.logout(b, f); }},
+        {"/api/games", [](Engine& e, const std::string&, Format) { return e.getGames(); }},
+        {"/api/metrics", [](Engine& e, const std::string&, Format) { return e.metrics(); }},
+    };
+    const auto it = routes.find(route);
+    if (it == routes.end())
+    {
+        const std::string error = Error{"UNKNOWN_ROUTE"};
+        return format == Format::MSGPACK ? msgpack::fromJson(error) : error;
+    }
+    return it->second(engine, body, format);
+}
+
+} // namespace dice
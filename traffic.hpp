@@ -0,0 +1,72 @@
+#pragma once
+
+#include "request.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace dice {
+
+class Engine;
+
+/// One recorded API request
+struct Record
+{
+    /// Microseconds since the recording started
+    std::int64_t t;
+    /// Path of the url, e.g., /api/bid
+    std::string route;
+    /// Body of the request. MessagePack bodies are stored as json.
+    std::string body;
+    /// Format of the request
+    Format format;
+    /// Id returned by /api/login, empty for the other routes
+    std::string player;
+};
+
+/// Appends the API requests to a JSONL file, one json object per line, e.g.,
+/// {"t":1500,"route":"/api/bid","format":"json","body":"{\"id\":...}"}
+/// Thread-safe.
+class Recorder
+{
+    std::mutex mutex_;
+    std::ofstream out_;
+    const std::chrono::steady_clock::time_point start_;
+public:
+    /// Construct Recorder
+    /// @param path [in] file to append the requests to
+    /// @throws std::runtime_error if the file cannot be opened
+    explicit Recorder(const std::string& path);
+
+    /// @return microseconds since the recorder was constructed
+    std::int64_t now() const;
+
+    /// Append the request to the file
+    /// @param t [in] when the request was received, see now
+    /// @param route [in] path of the url
+    /// @param body [in] body of the request
+    /// @param format [in] format of the body and the response
+    /// @param response [in] response to the request, used for the id from
+    ///     /api/login
+    void record(std::int64_t t, const std::string& route, const std::string& body,
+                Format format, const std::string& response);
+};
+
+/// Read recorded traffic. Invalid lines are skipped.
+/// @param path [in] JSONL file written by Recorder
+/// @return the requests in the order they were recorded
+std::vector<Record> readTraffic(const std::string& path);
+
+/// Call the Engine method for the API route, like the server does
+/// @param engine [in,out] engine to call
+/// @param route [in] path of the url, e.g., /api/bid
+/// @param body [in] body of the request in the given format
+/// @param format [in] format of the body and the response
+/// @return the response or UNKNOWN_ROUTE error
+std::string dispatch(Engine& engine, const std::string& route, const std::string& body, Format format);
+
+} // namespace dice
@@ -0,0 +1,50 @@
+#include "zstd.hpp"
+
+#include "atend.hpp"
+
+#include <zstd.h>
+
+#include <new>
+#include <stdexcept>
+
+namespace dice {
+
+std::string ZstdEncoder::compress(const std::string& data, Profile profile) const
+{
+    std::string result(ZSTD_compressBound(data.size()), '\0');
+    // Level 19 is the highest level without the long window, which the
+    // browsers do not need to support
+    const auto level = profile == Profile::STATIC ? 19 : 3;
+    const auto size = ZSTD_compress(&result[0], result.size(), data.data(), data.size(), level);
+    if (ZSTD_isError(size)) throw std::runtime_error(ZSTD_getErrorName(size));
+    result.resize(size);
+    return result;
+}
+
+std::string ZstdEncoder::decompress(const std::string& data) const
+{
+    auto* ds = ZSTD_createDStream();
+    if (!ds) throw std::bad_alloc{};
+    AtEnd ae{[ds]{ ZSTD_freeDStream(ds); }};
+    ZSTD_initDStream(ds);
+
+    std::string result;
+    char outBuf[4096];
+    ZSTD_inBuffer in{data.data(), data.size(), 0};
+    for (;;)
+    {
+        ZSTD_outBuffer out{outBuf, sizeof(outBuf), 0};
+        const auto ret = ZSTD_decompressStream(ds, &out, &in);
+        if (ZSTD_isError(ret)) throw std::runtime_error("INVALID_FORMAT");
+        result.append(outBuf, out.pos);
+        if (in.pos == in.size)
+        {
+            // 0 means that the frame is complete
+            if (ret == 0) return result;
+            // More input needed but there is no more
+            if (out.pos < out.size) throw std::runtime_error("INVALID_FORMAT");
+        }
+    }
+}
+
+} // namespace dice